@@ -12,6 +12,13 @@ void cmd_print_help(const char *prog) {
     printf("  --sink h               list sinks\n");
     printf("  --sink NAME            select sink\n");
     printf("  --filter2d NAME/012345678  set 3x3 filter coefficients\n");
+    printf("                         (25 or 49 digits for 5x5 or 7x7, software only)\n");
+    printf("  --filter2d A+B         fuse chained filters, e.g. blur+sharpen\n");
+    printf("  --filter2d PRESET      select a preset, e.g. sobel_horizontal\n");
+    printf("  --norm SHIFT[:OFFSET[:clamp|abs]]  filter output stage, e.g. 3:128\n");
+    printf("  --schedule ms|frame[+lerp][+loop]:POS=F,POS=F,...\n");
+    printf("                         switch 3x3 filters (preset or 9 digits) over time,\n");
+    printf("                         e.g. ms+lerp+loop:0=blur,500=sharpen,1000=blur\n");
     printf("  --accel sw|hw          choose software or hardware filter\n");
     printf("  --pipeline SRC SINK MODE  create pipeline (mode: passthrough or processing)\n");
     printf("  --help                 show this message\n");
@@ -33,30 +40,168 @@ int cmd_select_sink(const char *name) {
     return video_cfg_set_sink(name);
 }
 
-int cmd_set_filter2d(const char *spec) {
-    char *slash = strchr(spec, '/');
+/* Parse one NAME/digits or PRESET term of a --filter2d chain */
+static int parse_filter2d_term(const char *term, size_t len, char *name,
+                               filter2d_kernel *kernel) {
+    const char *slash = memchr(term, '/', len);
     if (!slash) {
-        return -1;
+        char preset[64];
+        if (len == 0 || len >= sizeof(preset)) {
+            return -1;
+        }
+        memcpy(preset, term, len);
+        preset[len] = '\0';
+        return video_cfg_get_filter_preset(preset, kernel);
     }
-    size_t name_len = (size_t)(slash - spec);
+    size_t name_len = (size_t)(slash - term);
     if (name_len == 0 || name_len >= 64) {
         return -1;
     }
-    char name[64];
-    memcpy(name, spec, name_len);
-    name[name_len] = '\0';
+    if (name[0] == '\0') {
+        memcpy(name, term, name_len);
+        name[name_len] = '\0';
+    }
     const char *digits = slash + 1;
-    if (strlen(digits) != 9) {
-        return -1;
+    size_t count = len - name_len - 1;
+    int ksize;
+    switch (count) {
+    case 9:  ksize = 3; break;
+    case 25: ksize = 5; break;
+    case 49: ksize = 7; break;
+    default: return -1;
     }
-    short coeff[3][3];
-    for (int i = 0; i < 9; ++i) {
+    memset(kernel, 0, sizeof(*kernel));
+    kernel->ksize = ksize;
+    for (size_t i = 0; i < count; ++i) {
         if (digits[i] < '0' || digits[i] > '9') {
             return -1;
         }
-        coeff[i / 3][i % 3] = (short)(digits[i] - '0');
+        kernel->coeff[i / ksize][i % ksize] = (short)(digits[i] - '0');
+    }
+    return 0;
+}
+
+int cmd_set_filter2d(const char *spec) {
+    if (!strchr(spec, '/') && !strchr(spec, '+')) {
+        return video_cfg_set_filter_preset(spec);
+    }
+    static char name[64];
+    filter2d_kernel fused;
+    int terms = 0;
+    name[0] = '\0';
+    for (const char *term = spec; term; ) {
+        const char *plus = strchr(term, '+');
+        size_t len = plus ? (size_t)(plus - term) : strlen(term);
+        filter2d_kernel kernel;
+        if (parse_filter2d_term(term, len, name, &kernel) != 0) {
+            return -1;
+        }
+        if (terms++ == 0) {
+            fused = kernel;
+        } else if (video_cfg_fuse_filter(&fused, &kernel) != 0) {
+            fprintf(stderr, "Filter chain too large to fuse\n");
+            return -1;
+        }
+        term = plus ? plus + 1 : NULL;
+    }
+    return video_cfg_set_filter_kernel(name[0] ? name : "fused", &fused);
+}
+
+int cmd_set_filter2d_norm(const char *spec) {
+    char *end;
+    long shift = strtol(spec, &end, 10);
+    long offset = 0;
+    int abs_mode = 0;
+    if (end == spec) {
+        return -1;
+    }
+    if (*end == ':') {
+        const char *p = end + 1;
+        offset = strtol(p, &end, 10);
+        if (end == p) {
+            return -1;
+        }
+    }
+    if (*end == ':') {
+        if (strcmp(end + 1, "abs") == 0) {
+            abs_mode = 1;
+        } else if (strcmp(end + 1, "clamp") != 0) {
+            return -1;
+        }
+    } else if (*end != '\0') {
+        return -1;
+    }
+    return video_cfg_set_filter_norm((int)shift, (int)offset, abs_mode);
+}
+
+#define SCHEDULE_MAX_KEYS 32
+
+/* Parse one POS=F keyframe of a --schedule list */
+static int parse_schedule_key(const char *key, size_t len, int frames,
+                              filter2d_keyframe *kf) {
+    char term[64];
+    char *end;
+    if (len == 0 || len >= sizeof(term)) {
+        return -1;
+    }
+    memcpy(term, key, len);
+    term[len] = '\0';
+    unsigned long long pos = strtoull(term, &end, 10);
+    if (end == term || *end != '=') {
+        return -1;
+    }
+    const char *f = end + 1;
+    filter2d_kernel kernel;
+    if (strlen(f) == 9 && strspn(f, "0123456789") == 9) {
+        for (int i = 0; i < 9; ++i) {
+            kf->coeff[i / 3][i % 3] = (short)(f[i] - '0');
+        }
+    } else if (video_cfg_get_filter_preset(f, &kernel) == 0 && kernel.ksize == 3) {
+        for (int i = 0; i < 9; ++i) {
+            kf->coeff[i / 3][i % 3] = kernel.coeff[i / 3][i % 3];
+        }
+    } else {
+        return -1;
+    }
+    kf->pos = frames ? pos : pos * 1000000ULL;
+    return 0;
+}
+
+int cmd_set_filter2d_schedule(const char *spec) {
+    static filter2d_keyframe keys[SCHEDULE_MAX_KEYS];
+    const char *colon = strchr(spec, ':');
+    int frames = 0, interpolate = 0, loop = 0;
+    unsigned int count = 0;
+    if (!colon) {
+        return -1;
+    }
+    for (const char *flag = spec; flag < colon; ) {
+        const char *plus = memchr(flag, '+', (size_t)(colon - flag));
+        size_t len = plus ? (size_t)(plus - flag) : (size_t)(colon - flag);
+        if (len == 2 && strncmp(flag, "ms", 2) == 0) {
+            frames = 0;
+        } else if (len == 5 && strncmp(flag, "frame", 5) == 0) {
+            frames = 1;
+        } else if (len == 4 && strncmp(flag, "lerp", 4) == 0) {
+            interpolate = 1;
+        } else if (len == 4 && strncmp(flag, "loop", 4) == 0) {
+            loop = 1;
+        } else {
+            return -1;
+        }
+        flag = plus ? plus + 1 : colon;
+    }
+    for (const char *key = colon + 1; key; ) {
+        const char *comma = strchr(key, ',');
+        size_t len = comma ? (size_t)(comma - key) : strlen(key);
+        if (count == SCHEDULE_MAX_KEYS ||
+            parse_schedule_key(key, len, frames, &keys[count]) != 0) {
+            return -1;
+        }
+        count++;
+        key = comma ? comma + 1 : NULL;
     }
-    return video_cfg_set_filter(name, coeff);
+    return video_cfg_set_filter_schedule(keys, count, frames, interpolate, loop);
 }
 
 void cmd_set_accel(const char *mode) {
@@ -13,6 +13,8 @@ int main(int argc, char **argv) {
         {"source",    required_argument, 0, 's'},
         {"sink",      required_argument, 0, 'k'},
         {"filter2d",  required_argument, 0, 'f'},
+        {"norm",      required_argument, 0, 'n'},
+        {"schedule",  required_argument, 0, 'c'},
         {"accel",     required_argument, 0, 'a'},
         {"pipeline",  no_argument,       0, 'p'},
         {"help",      no_argument,       0, 'h'},
@@ -41,6 +43,16 @@ int main(int argc, char **argv) {
                 fprintf(stderr, "Invalid filter specification\n");
             }
             break;
+        case 'n':
+            if (cmd_set_filter2d_norm(optarg) != 0) {
+                fprintf(stderr, "Invalid output stage %s\n", optarg);
+            }
+            break;
+        case 'c':
+            if (cmd_set_filter2d_schedule(optarg) != 0) {
+                fprintf(stderr, "Invalid schedule %s\n", optarg);
+            }
+            break;
         case 'a':
             cmd_set_accel(optarg);
             break;
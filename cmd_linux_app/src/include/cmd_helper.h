@@ -7,6 +7,8 @@ void cmd_print_sinks(void);
 int  cmd_select_source(const char *name);
 int  cmd_select_sink(const char *name);
 int  cmd_set_filter2d(const char *spec);
+int  cmd_set_filter2d_norm(const char *spec);
+int  cmd_set_filter2d_schedule(const char *spec);
 void cmd_set_accel(const char *mode);
 int  cmd_create_pipeline(const char *src, const char *sink, const char *mode);
 
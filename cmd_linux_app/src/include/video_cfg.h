@@ -3,6 +3,7 @@
 
 #include <vgst_lib.h>
 #include <vgst_utils.h>
+#include <vgst_sdxfilter2d.h>
 
 void video_cfg_init(void);
 void video_cfg_list_sources(void);
@@ -10,6 +11,13 @@ void video_cfg_list_sinks(void);
 int  video_cfg_set_source(const char *name);
 int  video_cfg_set_sink(const char *name);
 int  video_cfg_set_filter(const char *name, const short coeff[3][3]);
+int  video_cfg_set_filter_preset(const char *name);
+int  video_cfg_get_filter_preset(const char *name, filter2d_kernel *kernel);
+int  video_cfg_fuse_filter(filter2d_kernel *acc, const filter2d_kernel *next);
+int  video_cfg_set_filter_kernel(const char *name, const filter2d_kernel *kernel);
+int  video_cfg_set_filter_norm(int shift, int offset, int abs_mode);
+int  video_cfg_set_filter_schedule(const filter2d_keyframe *keys, unsigned int count,
+                                   int frames, int interpolate, int loop);
 void video_cfg_set_accel(int hw);
 int  video_cfg_create_pipeline(const char *mode);
 void video_cfg_cleanup(void);
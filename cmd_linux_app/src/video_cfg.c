@@ -1,3 +1,4 @@
+#include <ctype.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -12,6 +13,7 @@ static vgst_ip_params input_param;
 static vgst_op_params output_param;
 static vgst_cmn_params cmn_param;
 static struct filter_tbl ft;
+static struct filter_s *f2d_fs;
 static struct vlib_config_data vlib_cfg;
 
 void video_cfg_init(void) {
@@ -24,6 +26,19 @@ void video_cfg_init(void) {
     filter_param.filter_name = SDX_FILTER2D_PLUGIN;
     filter_param.filter_mode = GST_FILTER_MODE_HW;
 
+    /* The software engine does not need the sdx plugin, keep a private
+     * instance around when the plugin is not registered. */
+    for (unsigned int i = 0; i < ft.size; ++i) {
+        struct filter_s *fs = filter_type_get_obj(&ft, i);
+        if (fs && strcmp(fs->dt_comp_string, SDX_FILTER2D_PLUGIN) == 0) {
+            f2d_fs = fs;
+        }
+    }
+    if (!f2d_fs) {
+        f2d_fs = filter2d_create_gst();
+    }
+    filter_param.fs = f2d_fs;
+
     cmn_param.num_src = 1;
     cmn_param.sink_type = DISPLAY;
     cmn_param.driver_type = DP;
@@ -82,12 +97,91 @@ int video_cfg_set_sink(const char *name) {
 
 int video_cfg_set_filter(const char *name, const short coeff[3][3]) {
     filter_param.filter_name = (char *)name;
-    if (is_sdx_plugin_present(&ft, SDX_FILTER2D_PLUGIN)) {
-        filter2d_set_coeff(filter_type_get_obj(&ft, 0), coeff);
+    filter2d_set_coeff(f2d_fs, coeff);
+    return 0;
+}
+
+/* Preset names match case-insensitively, '_' standing in for a space */
+static int preset_name_match(const char *preset, const char *name) {
+    for (; *preset && *name; ++preset, ++name) {
+        char c = (*name == '_') ? ' ' : *name;
+        if (tolower((unsigned char)*preset) != tolower((unsigned char)c)) {
+            return 0;
+        }
     }
+    return *preset == *name;
+}
+
+static int preset_find(const char *name) {
+    for (int i = 0; i < FILTER2D_PRESET_CNT; ++i) {
+        const char *n = filter2d_get_preset_name((filter2d_preset)i);
+        if (n && preset_name_match(n, name)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int video_cfg_set_filter_preset(const char *name) {
+    int i = preset_find(name);
+    if (i < 0) {
+        return -1;
+    }
+    filter2d_set_preset_coeff(f2d_fs, (filter2d_preset)i);
     return 0;
 }
 
+int video_cfg_get_filter_preset(const char *name, filter2d_kernel *kernel) {
+    int i = preset_find(name);
+    if (i < 0) {
+        return -1;
+    }
+    filter2d_kernel_from_coeff(kernel,
+                               *filter2d_get_preset_coeff((filter2d_preset)i));
+    return 0;
+}
+
+/* Fold next into acc so that one pass of acc applies both filters */
+int video_cfg_fuse_filter(filter2d_kernel *acc, const filter2d_kernel *next) {
+    filter2d_kernel fused;
+    if (filter2d_fuse_kernels(acc, next, &fused) != VLIB_SUCCESS) {
+        return -1;
+    }
+    *acc = fused;
+    return 0;
+}
+
+/* 3x3 kernels may run on the hardware filter, larger ones are software only */
+int video_cfg_set_filter_kernel(const char *name, const filter2d_kernel *kernel) {
+    if (kernel->ksize == KSIZE) {
+        short coeff[KSIZE][KSIZE];
+        for (int i = 0; i < KSIZE * KSIZE; ++i) {
+            coeff[i / KSIZE][i % KSIZE] = kernel->coeff[i / KSIZE][i % KSIZE];
+        }
+        return video_cfg_set_filter(name, coeff);
+    }
+    filter2d_set_kernel(f2d_fs, kernel);
+    return 0;
+}
+
+int video_cfg_set_filter_norm(int shift, int offset, int abs_mode) {
+    filter2d_norm norm;
+    if (shift < 0) {
+        return -1;
+    }
+    norm.shift = (unsigned int)shift;
+    norm.offset = offset;
+    norm.sat_mode = abs_mode ? FILTER2D_SAT_ABS : FILTER2D_SAT_CLAMP;
+    return filter2d_set_norm(f2d_fs, &norm) == VLIB_SUCCESS ? 0 : -1;
+}
+
+int video_cfg_set_filter_schedule(const filter2d_keyframe *keys, unsigned int count,
+                                  int frames, int interpolate, int loop) {
+    filter2d_schedule_unit unit = frames ? FILTER2D_SCHEDULE_FRAME : FILTER2D_SCHEDULE_PTS;
+    return filter2d_set_schedule(f2d_fs, keys, count, unit, interpolate, loop)
+           == VLIB_SUCCESS ? 0 : -1;
+}
+
 void video_cfg_set_accel(int hw) {
     filter_param.filter_mode = hw ? GST_FILTER_MODE_HW : GST_FILTER_MODE_SW;
 }
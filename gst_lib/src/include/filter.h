@@ -59,6 +59,7 @@ struct filter_s
   void *data;                 /* pointer to pass data to filter init / private data pointer */
   size_t num_modes;
   const char **modes;
+  void *schedule;             /* coefficient schedule, released by filter2d_clear_schedule */
 };
 
 #include <glib.h>
@@ -77,6 +78,8 @@ struct filter_init_data
   size_t out_width;
   size_t out_height;
   uint32_t out_fourcc;
+  unsigned int num_workers;   /* software engine threads, 0 for default */
+  uint64_t cpu_mask;          /* CPUs for the worker threads, 0 for all */
 };
 
 struct filter_ops
@@ -90,6 +93,8 @@ struct filter_ops
       unsigned short *frame_prev, unsigned short *frame_curr,
       unsigned short *frame_out, int height_in, int width_in, int stride_in,
       int height_out, int width_out, int stride_out);
+  /* release per pipeline engine state, NULL if it lives with the filter */
+  void (*deinit) (struct filter_s * fs);
 };
 
 struct filter_discovery_table
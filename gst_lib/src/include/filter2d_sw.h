@@ -0,0 +1,79 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+#ifndef ___FILTER2D_SW_H___
+#define ___FILTER2D_SW_H___
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "filter.h"
+#include "vgst_sdxfilter2d.h"
+
+/* Software 2D filter engine operating on packed YUYV frames. The 3x3, 5x5
+ * or 7x7 convolution followed by the output stage set with
+ * filter2d_sw_set_norm() is applied to luma only, chroma is passed through
+ * unchanged.
+ */
+extern struct filter_ops filter2d_sw_ops;
+
+int filter2d_sw_init (struct filter_s *fs, const struct filter_init_data *data);
+void filter2d_sw_func (struct filter_s *fs,
+    unsigned short *frm_data_in, unsigned short *frm_data_out,
+    int height_in, int width_in, int stride_in,
+    int height_out, int width_out, int stride_out);
+void filter2d_sw_deinit (struct filter_s *fs);
+void filter2d_sw_set_coeff (struct filter_s *fs, const short coeff[3][3]);
+void filter2d_sw_set_preset (struct filter_s *fs, filter2d_preset preset,
+    const short coeff[3][3]);
+int filter2d_sw_set_kernel (struct filter_s *fs,
+    const filter2d_kernel * kernel);
+int filter2d_sw_set_norm (struct filter_s *fs, const filter2d_norm * norm);
+int filter2d_sw_get_coeff (struct filter_s *fs, short coeff[3][3]);
+coeff_t *filter2d_sw_coeff (struct filter_s *fs);
+const char *filter2d_sw_get_kernel (struct filter_s *fs);
+const char *filter2d_sw_get_isa (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ___FILTER2D_SW_H___ */
@@ -0,0 +1,305 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+#ifndef ___FILTER2D_SW_INT_H___
+#define ___FILTER2D_SW_INT_H___
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "vgst_sdxfilter2d.h"
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define F2D_HAVE_NEON
+#elif defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#define F2D_HAVE_SSE2
+#define F2D_HAVE_AVX2
+#endif
+
+#define F2D_TAPS	9
+/* Output stage: right shift, offset and non-zero for FILTER2D_SAT_ABS */
+#define F2D_NORM_LEN	3
+#define F2D_NSHIFT	0
+#define F2D_NOFFSET	1
+#define F2D_NABS	2
+/* Coefficient block handed to the row kernels: the 3x3 taps, followed by
+ * the column and row vector for separable kernels and the output stage */
+#define F2D_KV		F2D_TAPS
+#define F2D_KH		(F2D_TAPS + 3)
+#define F2D_KNORM	(F2D_TAPS + 6)
+#define F2D_KLEN	(F2D_KNORM + F2D_NORM_LEN)
+/* Same for kernels above 3x3, the output stage follows the largest kernel */
+#define F2D_KNNORM	(KSIZE_MAX * KSIZE_MAX)
+#define F2D_KNLEN	(F2D_KNNORM + F2D_NORM_LEN)
+/* Widest row the separable kernels keep their intermediate row for */
+#define F2D_SEP_MAX_WIDTH	4096
+#define F2D_LUMA_MASK	0x00ff
+#define F2D_CHROMA_MASK	0xff00
+
+/* Process one output row from the three input rows around it */
+typedef void (*f2d_row_fn) (const unsigned short *r0, const unsigned short *r1,
+    const unsigned short *r2, unsigned short *dst, int width, const short *k);
+
+/* Process one output row of a ksize x ksize kernel, rows[i] being input
+ * row y - ksize / 2 + i */
+typedef void (*f2d_rown_fn) (const unsigned short *const *rows,
+    unsigned short *dst, int width, const short *k, int ksize);
+
+/* Kernel as loaded into the engine, copied at the start of every frame */
+struct f2d_sw_plan
+{
+  int ksize;
+  /* ksize 3: 3x3 coefficient block and row kernel */
+  short k[F2D_KLEN];
+  f2d_row_fn row;
+  /* ksize 5 and 7: ksize x ksize taps, row major */
+  short kn[F2D_KNLEN];
+  f2d_rown_fn rown;
+};
+
+/* Kernel specialized at build time for one preset */
+struct f2d_sw_kernel
+{
+  const char *name;
+  short coeff[F2D_TAPS];
+  f2d_row_fn row;
+};
+
+extern const struct f2d_sw_kernel f2d_sw_presets[FILTER2D_PRESET_CNT];
+
+struct filter_s;
+
+/* Copy the kernel currently loaded into the engine */
+int f2d_sw_snapshot (struct filter_s *fs, struct f2d_sw_plan *plan);
+
+/* Run one output row, rows holding plan->ksize input rows */
+static inline void
+f2d_plan_run_row (const struct f2d_sw_plan *plan,
+    const unsigned short *const *rows, unsigned short *dst, int width)
+{
+  if (plan->ksize == 3)
+    plan->row (rows[0], rows[1], rows[2], dst, width, plan->k);
+  else
+    plan->rown (rows, dst, width, plan->kn, plan->ksize);
+}
+
+/* Output stage for one pixel, norm pointing at the F2D_NORM_LEN block */
+static inline unsigned short
+f2d_clamp (int acc, unsigned short center, const short *norm)
+{
+  acc >>= norm[F2D_NSHIFT];
+  if (norm[F2D_NABS] && acc < 0)
+    acc = -acc;
+  acc += norm[F2D_NOFFSET];
+  if (acc < 0)
+    acc = 0;
+  else if (acc > 255)
+    acc = 255;
+
+  return (center & F2D_CHROMA_MASK) | acc;
+}
+
+static inline int
+f2d_norm_is_identity (const short *norm)
+{
+  return !norm[F2D_NSHIFT] && !norm[F2D_NOFFSET] && !norm[F2D_NABS];
+}
+
+/* Scalar reference for a single pixel, replicating the border columns */
+static inline unsigned short
+f2d_pixel (const unsigned short *r0, const unsigned short *r1,
+    const unsigned short *r2, int x, int width, const short *k)
+{
+  int xl = x > 0 ? x - 1 : 0;
+  int xr = x < width - 1 ? x + 1 : width - 1;
+  int acc;
+
+  acc = k[0] * (r0[xl] & F2D_LUMA_MASK) + k[1] * (r0[x] & F2D_LUMA_MASK) +
+      k[2] * (r0[xr] & F2D_LUMA_MASK) + k[3] * (r1[xl] & F2D_LUMA_MASK) +
+      k[4] * (r1[x] & F2D_LUMA_MASK) + k[5] * (r1[xr] & F2D_LUMA_MASK) +
+      k[6] * (r2[xl] & F2D_LUMA_MASK) + k[7] * (r2[x] & F2D_LUMA_MASK) +
+      k[8] * (r2[xr] & F2D_LUMA_MASK);
+
+  return f2d_clamp (acc, r1[x], k + F2D_KNORM);
+}
+
+/*
+ * Minimal vector layer for the kernels generated with constant weights.
+ * Lanes are signed 16 bit, without SIMD support it degrades to one lane.
+ * f2d_vstore_px applies the output stage set up by f2d_vnorm_init: an
+ * arithmetic shift, abs() via the sign mask, then a saturating add of the
+ * offset and the 0..255 clamp, so no lane ever takes a branch.
+ */
+#if defined(F2D_HAVE_NEON)
+typedef int16x8_t f2d_vec;
+typedef struct
+{
+  int16x8_t shift;
+  int16x8_t sign;
+  int16x8_t offset;
+} f2d_vnorm;
+#define F2D_VLANES		8
+#define f2d_vzero()		vdupq_n_s16 (0)
+#define f2d_vload_y(p)		vreinterpretq_s16_u16 (vandq_u16 (vld1q_u16 (p), \
+				    vdupq_n_u16 (F2D_LUMA_MASK)))
+#define f2d_vload_s16(p)	vld1q_s16 (p)
+#define f2d_vstore_s16(p, v)	vst1q_s16 (p, v)
+#define f2d_vadd(a, b)		vaddq_s16 (a, b)
+#define f2d_vsub(a, b)		vsubq_s16 (a, b)
+#define f2d_vshl1(a)		vshlq_n_s16 (a, 1)
+#define f2d_vmulc(a, c)		vmulq_n_s16 (a, c)
+
+static inline void
+f2d_vnorm_init (f2d_vnorm * n, const short *norm)
+{
+  n->shift = vdupq_n_s16 (-norm[F2D_NSHIFT]);
+  n->sign = vdupq_n_s16 (norm[F2D_NABS] ? -1 : 0);
+  n->offset = vdupq_n_s16 (norm[F2D_NOFFSET]);
+}
+
+/* Output stage without the shift, acc already narrowed to 16 bit */
+static inline int16x8_t
+f2d_vnorm_finish (int16x8_t acc, const f2d_vnorm * n)
+{
+  int16x8_t s = vandq_s16 (vshrq_n_s16 (acc, 15), n->sign);
+
+  acc = vqsubq_s16 (veorq_s16 (acc, s), s);
+  acc = vqaddq_s16 (acc, n->offset);
+  return vminq_s16 (vmaxq_s16 (acc, vdupq_n_s16 (0)), vdupq_n_s16 (255));
+}
+
+static inline void
+f2d_vstore_px (unsigned short *p, int16x8_t acc, const unsigned short *center,
+    const f2d_vnorm * n)
+{
+  acc = f2d_vnorm_finish (vshlq_s16 (acc, n->shift), n);
+  vst1q_u16 (p, vorrq_u16 (vreinterpretq_u16_s16 (acc),
+          vandq_u16 (vld1q_u16 (center), vdupq_n_u16 (F2D_CHROMA_MASK))));
+}
+#elif defined(F2D_HAVE_SSE2)
+typedef __m128i f2d_vec;
+typedef struct
+{
+  __m128i shift;
+  __m128i sign;
+  __m128i offset;
+} f2d_vnorm;
+#define F2D_VLANES		8
+#define f2d_vzero()		_mm_setzero_si128 ()
+#define f2d_vload_y(p)		_mm_and_si128 (_mm_loadu_si128 ((const __m128i *) (p)), \
+				    _mm_set1_epi16 (F2D_LUMA_MASK))
+#define f2d_vload_s16(p)	_mm_loadu_si128 ((const __m128i *) (p))
+#define f2d_vstore_s16(p, v)	_mm_storeu_si128 ((__m128i *) (p), v)
+#define f2d_vadd(a, b)		_mm_add_epi16 (a, b)
+#define f2d_vsub(a, b)		_mm_sub_epi16 (a, b)
+#define f2d_vshl1(a)		_mm_slli_epi16 (a, 1)
+#define f2d_vmulc(a, c)		_mm_mullo_epi16 (a, _mm_set1_epi16 (c))
+
+static inline void
+f2d_vnorm_init (f2d_vnorm * n, const short *norm)
+{
+  n->shift = _mm_cvtsi32_si128 (norm[F2D_NSHIFT]);
+  n->sign = _mm_set1_epi16 (norm[F2D_NABS] ? -1 : 0);
+  n->offset = _mm_set1_epi16 (norm[F2D_NOFFSET]);
+}
+
+/* Output stage without the shift, acc already narrowed to 16 bit */
+static inline __m128i
+f2d_vnorm_finish (__m128i acc, const f2d_vnorm * n)
+{
+  __m128i s = _mm_and_si128 (_mm_srai_epi16 (acc, 15), n->sign);
+
+  acc = _mm_subs_epi16 (_mm_xor_si128 (acc, s), s);
+  acc = _mm_adds_epi16 (acc, n->offset);
+  return _mm_min_epi16 (_mm_max_epi16 (acc, _mm_setzero_si128 ()),
+      _mm_set1_epi16 (255));
+}
+
+static inline void
+f2d_vstore_px (unsigned short *p, __m128i acc, const unsigned short *center,
+    const f2d_vnorm * n)
+{
+  acc = f2d_vnorm_finish (_mm_sra_epi16 (acc, n->shift), n);
+  _mm_storeu_si128 ((__m128i *) p, _mm_or_si128 (acc,
+          _mm_and_si128 (_mm_loadu_si128 ((const __m128i *) center),
+              _mm_set1_epi16 ((short) F2D_CHROMA_MASK))));
+}
+#else
+typedef int f2d_vec;
+typedef const short *f2d_vnorm;
+#define F2D_VLANES		1
+#define f2d_vzero()		0
+#define f2d_vload_y(p)		(*(p) & F2D_LUMA_MASK)
+#define f2d_vload_s16(p)	(*(p))
+#define f2d_vstore_s16(p, v)	(*(p) = (v))
+#define f2d_vadd(a, b)		((a) + (b))
+#define f2d_vsub(a, b)		((a) - (b))
+#define f2d_vshl1(a)		((a) << 1)
+#define f2d_vmulc(a, c)		((a) * (c))
+#define f2d_vnorm_init(n, norm)	(*(n) = (norm))
+#define f2d_vstore_px(p, acc, center, n)	(*(p) = f2d_clamp (acc, *(center), *(n)))
+#endif
+
+/*
+ * Accumulate one tap with a weight known at compile time. Zero taps vanish,
+ * +-1 and +-2 become adds/subtracts and shifts, everything else a multiply.
+ */
+#define F2D_CTAP(acc, load, p, c)					\
+  do {									\
+    if ((c) == 1)							\
+      acc = f2d_vadd (acc, load (p));					\
+    else if ((c) == -1)							\
+      acc = f2d_vsub (acc, load (p));					\
+    else if ((c) == 2)							\
+      acc = f2d_vadd (acc, f2d_vshl1 (load (p)));			\
+    else if ((c) == -2)							\
+      acc = f2d_vsub (acc, f2d_vshl1 (load (p)));			\
+    else if ((c) != 0)							\
+      acc = f2d_vadd (acc, f2d_vmulc (load (p), (c)));			\
+  } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ___FILTER2D_SW_INT_H___ */
@@ -0,0 +1,70 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+#ifndef ___OPTICAL_FLOW_SW_H___
+#define ___OPTICAL_FLOW_SW_H___
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "filter.h"
+
+/* Software dense optical flow engine operating on packed YUYV frames.
+ * Pyramidal Lucas-Kanade runs on the luma of the previous and current
+ * frame, the flow is rendered into the output frame with zero motion as
+ * mid grey, U and V carrying the horizontal and vertical motion.
+ */
+extern struct filter_ops optical_flow_sw_ops;
+
+int optical_flow_sw_init (struct filter_s *fs,
+    const struct filter_init_data *data);
+void optical_flow_sw_func2 (struct filter_s *fs,
+    unsigned short *frame_prev, unsigned short *frame_curr,
+    unsigned short *frame_out, int height_in, int width_in, int stride_in,
+    int height_out, int width_out, int stride_out);
+void optical_flow_sw_deinit (struct filter_s *fs);
+int optical_flow_sw_get_scale (struct filter_s *fs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ___OPTICAL_FLOW_SW_H___ */
@@ -0,0 +1,100 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+#ifndef INCLUDE_VGST_ABR_H_
+#define INCLUDE_VGST_ABR_H_
+
+#include "vgst_utils.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Interval the send queue is sampled at */
+#define VGST_ABR_PERIOD_MS        100
+/* Decision interval when the stream has no I frames to mark GOPs */
+#define VGST_ABR_FALLBACK_MS      1000
+/* Send queue fill (% of the socket send buffer) above which the link is congested */
+#define VGST_ABR_QUEUE_HIGH       50
+/* Send queue fill below which the link is considered clear */
+#define VGST_ABR_QUEUE_LOW        10
+/* Multiplicative decrease on congestion, in % of the current rate */
+#define VGST_ABR_DECREASE         75
+/* Additive increase per clear GOP, in % of the ceiling */
+#define VGST_ABR_INCREASE         5
+/* Clear GOPs in a row required before increasing */
+#define VGST_ABR_CLEAR_GOPS       3
+/* Lowest target bitrate in kbps */
+#define VGST_ABR_MIN_KBPS         500
+
+/* What the link looked like over one GOP */
+typedef struct
+_vgst_abr_sample {
+    guint      queue_pct;        /* peak send queue fill */
+    guint64    unsent_bytes;     /* bytes the sink failed to send */
+    guint      measured_kbps;    /* encoder output, 0 if unknown */
+} vgst_abr_sample;
+
+typedef struct
+_vgst_abr_state {
+    guint      target_kbps;
+    guint      min_kbps;
+    guint      max_kbps;
+    guint      clear_gops;
+} vgst_abr_state;
+
+/* This API is the controller decision for one GOP: updates state and returns the new target bitrate in kbps.
+ * It has no side effects besides state so it can be driven by a simulated link */
+guint vgst_abr_decide (vgst_abr_state *state, const vgst_abr_sample *sample);
+
+/* This API is to enable or disable the controller for pipelines started afterwards */
+void set_abr (gboolean enable);
+
+/* This API is to start adapting the encoder bitrate of the STREAM pipeline play_ptr */
+void vgst_abr_attach (vgst_playback *play_ptr, guint index, vgst_enc_params *enc_param);
+
+/* This API is to stop the controller of pipeline index */
+void vgst_abr_detach (guint index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INCLUDE_VGST_ABR_H_ */
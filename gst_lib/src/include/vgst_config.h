@@ -115,6 +115,10 @@ typedef enum {
 #define OPENSOURCE_KMS_SINK_NAME     "kmssink"
 #define XLNX_KMS_SINK_NAME           "xlnxvideosink"
 #define MPEG_TS_MUX_NAME             "mpegtsmux"
+#define INPUT_SELECTOR_NAME          "input-selector"
+#define SWITCHER_QUEUE_MAX_BUFFERS   2
+#define SYNC_START_DELAY_MS          100   // headroom before the shared base time
+#define SYNC_START_TIMEOUT_MS        5000
 #define MKV_MUX_NAME                 "matroskamux"
 #define DEFAULT_DEC_BUFFER_CNT       5
 #define MIN_DEC_BUFFER_CNT           2
@@ -123,6 +127,7 @@ typedef enum {
 #define MIN_PORT_NUMBER              1024
 #define QOS_DSCP_VALUE               60
 #define FPS_UPDATE_INTERVAL          1000  // 1sec
+#define VGST_STATS_MESSAGE           "vgst-stats"
 #define DP_BUS_ID                    "fd4a0000.zynqmp-display"
 #define DEFAULT_PLANE_ID             30
 #define PKT_NUMBER_PER_BUFFER        7
@@ -0,0 +1,111 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+#ifndef INCLUDE_VGST_GRAPH_H_
+#define INCLUDE_VGST_GRAPH_H_
+
+#include "vgst_utils.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Node of a graph description: an element slot of vgst_playback, filled
+ * from factory when the caller did not create a specialised element */
+typedef struct
+_vgst_graph_node {
+    const gchar        *name;
+    const gchar        *factory;
+    glong              offset;
+    /* "property=value;..." applied on every instance */
+    const gchar        *props;
+} vgst_graph_node;
+
+/* Link between two nodes, NULL pads pick any compatible pad, caps may be NULL */
+typedef struct
+_vgst_graph_edge {
+    const gchar        *src;
+    const gchar        *src_pad;
+    const gchar        *sink;
+    const gchar        *sink_pad;
+    const gchar        *caps;
+} vgst_graph_edge;
+
+typedef struct
+_vgst_graph_desc {
+    const gchar            *name;
+    const vgst_graph_node  *nodes;
+    guint                  num_nodes;
+    const vgst_graph_edge  *edges;
+    guint                  num_edges;
+} vgst_graph_desc;
+
+typedef enum {
+    VGST_GRAPH_SDX_DISPLAY,
+    VGST_GRAPH_VCU_DISPLAY,
+    VGST_GRAPH_VCU_STREAM,
+    VGST_GRAPH_VCU_RECORD,
+    VGST_GRAPH_RAW_DISPLAY,
+    VGST_GRAPH_SPLIT_SCREEN,
+    VGST_GRAPH_COUNT,
+} VGST_GRAPH_TOPOLOGY;
+
+typedef struct _vgst_graph vgst_graph;
+
+/* This API is to resolve names, factories, properties and caps of desc, NULL if desc is invalid */
+vgst_graph * vgst_graph_compile (const vgst_graph_desc *desc);
+
+/* This API is to release a compiled graph */
+void vgst_graph_free (vgst_graph *graph);
+
+/* This API is to get the compiled graph of a built-in topology, compiled on first use */
+const vgst_graph * vgst_graph_get (VGST_GRAPH_TOPOLOGY topology);
+
+/* This API is to pick the built-in topology for a source, -1 when it is linked at runtime */
+gint vgst_graph_select (const vgst_ip_params *ip_param, guint sink_type);
+
+/* This API is to create missing elements, set properties and link all edges of graph in play_ptr */
+VGST_ERROR_LOG vgst_graph_instantiate (const vgst_graph *graph, vgst_playback *play_ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INCLUDE_VGST_GRAPH_H_ */
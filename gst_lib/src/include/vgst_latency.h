@@ -0,0 +1,71 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+#ifndef INCLUDE_VGST_LATENCY_H_
+#define INCLUDE_VGST_LATENCY_H_
+
+#include "vgst_utils.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Buffers remembered per source to match later stages against, must be a power of 2 */
+#define VGST_LATENCY_STAMPS     64
+/* Histogram buckets: 1us steps up to 8us, then 4 buckets per octave up to 2^31us */
+#define VGST_LATENCY_BUCKETS    120
+
+/* This API is to install the latency probes on the stage boundaries of play_ptr and reset the stats of index */
+void vgst_latency_attach (vgst_playback *play_ptr, guint index);
+
+/* This API is to remove the latency probes of index, the pipeline must not be streaming */
+void vgst_latency_detach (guint index);
+
+/* This API is to add a sample of us measured outside the pad probes to the stage histogram of index */
+void vgst_latency_record (guint index, VGST_LATENCY_STAGE stage, gint64 us);
+
+/* This API is to summarize the latency histograms of source index into stats[VGST_STAGE_COUNT] */
+gint get_latency_stats (guint index, vgst_latency_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INCLUDE_VGST_LATENCY_H_ */
@@ -101,10 +101,18 @@ extern "C"
   } vlib_error;
 #endif
 
+struct filter_s;
+
 typedef struct
 _vgst_sdx_filter_params {
   gchar      *filter_name;
   gint       filter_mode;
+  /* filter providing the native engine used in GST_FILTER_MODE_SW */
+  struct filter_s *fs;
+  /* software engine worker threads (0 = one per CPU but one) and the CPUs
+   * they are pinned to (0 = all) */
+  guint      num_workers;
+  guint64    cpu_mask;
 } vgst_sdx_filter_params;
 
 typedef struct
@@ -228,11 +236,101 @@ typedef enum {
     EVENT_ERROR,
 } VGST_EVENT_TYPE;
 
+/* Events reported through the fd of vgst_get_event_fd */
+typedef enum {
+    VGST_EVENT_MASK_EOS           = 1 << 0,
+    VGST_EVENT_MASK_ERROR         = 1 << 1,
+    VGST_EVENT_MASK_STATE_CHANGED = 1 << 2,
+    VGST_EVENT_MASK_STATS         = 1 << 3,    /* a new second of frame statistics is available */
+    VGST_EVENT_MASK_SOURCE_CHANGED = 1 << 4,   /* a video source locked to a new input resolution */
+} VGST_EVENT_MASK;
+
 typedef enum {
   VCU,
   SDX_FILTER,
 } VGST_FILTER_TYPE;
 
+/* Pipeline boundaries buffer latency is measured at */
+typedef enum {
+    VGST_STAGE_SRC,        /* capture to source output */
+    VGST_STAGE_CAPS,       /* source output to capsfilter output */
+    VGST_STAGE_PROC,       /* source output to filter/encoder output */
+    VGST_STAGE_DEC,        /* source output to decoder output */
+    VGST_STAGE_SINK,       /* source output to sink input */
+    VGST_STAGE_ENGINE,     /* software filter engine time per frame */
+    VGST_STAGE_COUNT,
+} VGST_LATENCY_STAGE;
+
+typedef struct
+_vgst_latency_stats {
+    guint64    count;
+    guint      p50_us;
+    guint      p99_us;
+    guint      max_us;
+} vgst_latency_stats;
+
+/* Rolling windows the sink frame statistics are kept for */
+typedef enum {
+    VGST_FPS_WINDOW_1S,
+    VGST_FPS_WINDOW_10S,
+    VGST_FPS_WINDOW_60S,
+    VGST_FPS_WINDOW_COUNT,
+} VGST_FPS_WINDOW;
+
+typedef struct
+_vgst_fps_window {
+    gdouble    fps;                  /* from the mean buffer timestamp interval */
+    gdouble    interval_mean_us;
+    gdouble    interval_stddev_us;   /* frame pacing jitter */
+    guint64    frames;
+    guint64    dropped;
+    guint64    late;
+} vgst_fps_window;
+
+typedef struct
+_vgst_fps_stats {
+    guint64          frames;
+    gdouble          fps;
+    gdouble          interval_mean_us;
+    gdouble          interval_stddev_us;
+    gdouble          interval_min_us;
+    gdouble          interval_max_us;
+    guint64          dropped;        /* frames missing from the timestamp sequence */
+    guint64          late;           /* frames reaching the sink after their presentation time */
+    guint64          qos_dropped;    /* frames the sink reported dropping through QoS */
+    vgst_fps_window  window[VGST_FPS_WINDOW_COUNT];
+} vgst_fps_stats;
+
+/* Coded picture types the encoder output is split into */
+typedef enum {
+    VGST_FRAME_I,
+    VGST_FRAME_P,
+    VGST_FRAME_B,
+    VGST_FRAME_TYPE_COUNT,
+} VGST_FRAME_TYPE;
+
+typedef struct
+_vgst_frame_size_stats {
+    guint64    count;
+    guint64    bytes;
+    guint      min_bytes;
+    guint      max_bytes;
+} vgst_frame_size_stats;
+
+typedef struct
+_vgst_bitrate_stats {
+    guint                  inst_bps;         /* last frame size over its duration */
+    guint                  window_bps;       /* over the last VGST_BITRATE_WINDOW_MS */
+    guint64                frames;
+    guint64                bytes;
+    vgst_frame_size_stats  frame[VGST_FRAME_TYPE_COUNT];
+    guint64                gop_count;        /* completed GOPs (I frame to I frame) */
+    guint                  gop_length;       /* frames in the last completed GOP */
+    guint                  gop_bytes;
+    guint                  gop_bps;
+    gdouble                gop_length_mean;
+} vgst_bitrate_stats;
+
 /* This API is to initialize the library */
 gint vgst_init(void);
 
@@ -251,26 +349,64 @@ const gchar * vgst_error_to_string (VGST_ERROR_LOG error_code, gint index);
 /* This API is to get fps of the pipeline */
 void vgst_get_fps (guint index, guint *fps);
 
-/* This API is to get bitrate for file playback */
+/* This API is to get the frame interval, drop and jitter statistics of sink (0, or 1 for the raw half of split screen) of pipeline index */
+gint vgst_get_fps_stats (guint index, guint sink, vgst_fps_stats *stats);
+
+/* This API is to get bitrate for file playback, or the measured encoder output bitrate for live sources */
 guint vgst_get_bitrate (int index);
 
+/* This API is to get the encoder output bitrate, frame size and GOP statistics of pipeline index */
+gint vgst_get_bitrate_stats (guint index, vgst_bitrate_stats *stats);
+
 /* This API is to poll events */
 gint vgst_poll_event (int *arg, int index);
 
+/* This API is to get an eventfd that becomes readable whenever a pipeline has new events.
+ * It stays valid until vgst_uninit, wait on it with poll/epoll and fetch the events with vgst_get_events */
+gint vgst_get_event_fd (void);
+
+/* This API is to fetch and clear the VGST_EVENT_MASK bits pending for pipeline index.
+ * The event fd stays readable while any other pipeline still has events pending */
+guint vgst_get_events (guint index);
+
 /* This API is to un-initialize the library */
 gint vgst_uninit(void);
 
+/* This API is to get per stage buffer latency of source index, stats holds VGST_STAGE_COUNT entries */
+gint vgst_get_latency_stats (guint index, vgst_latency_stats *stats);
+
+/* This API is to let STREAM pipelines adapt the encoder target-bitrate to the link, the configured bitrate is the ceiling */
+gint vgst_set_abr (gboolean enable);
+
+/* This API is to build multi-source pipelines concurrently and start them together on one clock */
+gint vgst_set_sync_start (gboolean enable);
+
+/* This API is to get the time the last mode switch took to reach PLAYING, in microseconds (-1 if none) */
+gint64 vgst_get_switch_time (void);
+
 #ifdef BASE_TRD
+/* Number of pipelines vgst_change_mode keeps prebuilt in READY state */
+#define VGST_PIPELINE_CACHE_SIZE  4
+
 gint vgst_init_base (struct vlib_config_data *cfg,
     vgst_enc_params * enc_param, vgst_ip_params * input_param,
     vgst_op_params * output_param, vgst_cmn_params * cmn_param,
     vgst_sdx_filter_params * filter_param, struct filter_tbl *ft);
 gint vgst_video_src_init (struct vlib_config_data *cfg);
 gint vgst_stop_pipeline_base (void);
+/* When the source of the last call locks to a new input resolution the call is replayed from the
+ * default main context with the same parameter pointers, they are not copied and must stay valid
+ * until the next vgst_change_mode or vgst_stop_pipeline_base. Sources that cannot scale are only
+ * replayed once their input is back at input_param->width x height */
 gint vgst_change_mode (struct vlib_config *config, unsigned int flags,
     vgst_enc_params * enc_param, vgst_ip_params * input_param,
     vgst_op_params * output_param, vgst_cmn_params * cmn_param,
     vgst_sdx_filter_params * filter_param);
+/* Build a switcher graph on the next vgst_change_mode: every live source feeds an input-selector
+ * ahead of one long-lived sink and changing only config->vsrc becomes a pad switch */
+gint vgst_set_switcher (gboolean enable);
+/* Show vsrc on the running switcher graph */
+gint vgst_switch_source (size_t vsrc);
 int vgst_set_event_log (int state);
 int vgst_get_active_height (void);
 int vgst_get_active_width (void);
@@ -50,12 +50,15 @@ extern "C"
 /* This API is to create all the elements required for single/multi-stream pipeline */
 VGST_ERROR_LOG create_pipeline (vgst_ip_params *ip_param, vgst_enc_params *enc_param, vgst_playback *play_ptr, guint sink_type, gchar *uri, vgst_sdx_filter_params *filter_param);
 
+/* This API is to create, set up and link the switcher pipeline: every source in vsrc feeds an
+ * input-selector ahead of a single display sink */
+VGST_ERROR_LOG create_switcher_pipeline (vgst_ip_params *ip_param, vgst_cmn_params *cmn_param, vgst_playback *play_ptr,
+                                         vgst_sdx_filter_params *filter_param, const size_t *vsrc, guint num_vsrc);
+
 /* This API is to parse the tag and get the bitrate value from file */
 void fetch_tag (const GstTagList * list, const gchar * tag, gpointer user_data);
 
 
-/* This API is to measure the current fps value */
-void on_fps_measurement (GstElement *fps, gdouble fps_num, gdouble drop_rate, gdouble avg_rate, gpointer data);
 
 /* This API is to set all the required property to start playback/capture pipeline */
 void set_property (vgst_application *app, gint index);
@@ -47,15 +47,63 @@ extern "C"
 {
 #endif
 
+#include <stdint.h>
+
 /* Filter presets */
 #define FILTER2D_PRESET_CNT 11
 
 /* Kernel size */
 #define KSIZE 3
 
+/* Largest kernel size supported by the software engine */
+#define KSIZE_MAX 7
+
 /* 2D array of coefficients */
 typedef short int coeff_t[KSIZE][KSIZE];
 
+/* Kernel of ksize x ksize (3, 5 or 7) coefficients, stored in the top left
+ * corner of coeff. Only the software engine supports ksize above KSIZE. */
+typedef struct
+{
+  int ksize;
+  short int coeff[KSIZE_MAX][KSIZE_MAX];
+} filter2d_kernel;
+
+/* Saturation applied at the end of the output stage */
+typedef enum
+{
+  FILTER2D_SAT_CLAMP,
+  FILTER2D_SAT_ABS
+} filter2d_sat_mode;
+
+/* Largest shift and offset magnitude of the output stage */
+#define FILTER2D_SHIFT_MAX 15
+#define FILTER2D_OFFSET_MAX 255
+
+/* Output stage of the filter: the sum of products is shifted right by
+ * shift, replaced by its absolute value for FILTER2D_SAT_ABS, offset is
+ * added and the result clamped to 0..255. All zero leaves the sum as is. */
+typedef struct
+{
+  unsigned int shift;
+  int offset;
+  filter2d_sat_mode sat_mode;
+} filter2d_norm;
+
+/* Position unit of schedule keyframes */
+typedef enum
+{
+  FILTER2D_SCHEDULE_PTS,        /* nanoseconds after the first frame */
+  FILTER2D_SCHEDULE_FRAME       /* frames after the first frame */
+} filter2d_schedule_unit;
+
+/* Coefficients the filter runs with from pos on */
+typedef struct
+{
+  uint64_t pos;
+  coeff_t coeff;
+} filter2d_keyframe;
+
 /* Filter presets */
 typedef enum
 {
@@ -76,9 +124,23 @@ typedef enum
 struct filter_s *filter2d_create ();
 const char *filter2d_get_preset_name (filter2d_preset preset);
 void filter2d_set_coeff (struct filter_s *fs, const coeff_t coeff);
+int filter2d_set_norm (struct filter_s *fs, const filter2d_norm *norm);
+int filter2d_set_coeff_norm (struct filter_s *fs, const coeff_t coeff,
+    const filter2d_norm *norm);
+void filter2d_set_coeff_bin (struct filter_s *fs, const short *coeff);
 coeff_t *filter2d_get_coeff (struct filter_s *fs);
+int filter2d_copy_coeff (struct filter_s *fs, coeff_t coeff);
 void filter2d_set_preset_coeff (struct filter_s *fs, filter2d_preset preset);
 const coeff_t *filter2d_get_preset_coeff (filter2d_preset preset);
+void filter2d_kernel_from_coeff (filter2d_kernel *kernel, const coeff_t coeff);
+void filter2d_set_kernel (struct filter_s *fs, const filter2d_kernel *kernel);
+int filter2d_fuse_kernels (const filter2d_kernel *first,
+    const filter2d_kernel *second, filter2d_kernel *fused);
+int filter2d_set_schedule (struct filter_s *fs, const filter2d_keyframe *keys,
+    unsigned int num_keys, filter2d_schedule_unit unit, int interpolate,
+    int loop);
+/* Drops the schedule, call it before the filter object is freed */
+void filter2d_clear_schedule (struct filter_s *fs);
 
 #ifdef __cplusplus
 }
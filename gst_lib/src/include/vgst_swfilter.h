@@ -0,0 +1,75 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+#ifndef INCLUDE_VGST_SWFILTER_H_
+#define INCLUDE_VGST_SWFILTER_H_
+
+#include <gst/gst.h>
+#include "vgst_lib.h"
+#include "filter.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define VGST_SWFILTER_ELEMENT   "identity"
+#define VGST_SWFILTER_POOL_MIN  2
+#define VGST_SWFILTER_FPS_FRAMES  120
+
+typedef struct _vgst_swfilter vgst_swfilter;
+
+/* This API is to run the filter_ops of filter_param->fs on every buffer passing through element,
+ * two frame engines (func2) get the previous buffer as well */
+vgst_swfilter * vgst_swfilter_attach (GstElement *element, vgst_sdx_filter_params *filter_param);
+
+/* This API is to report the per frame engine time into the VGST_STAGE_ENGINE latency stats of index */
+void vgst_swfilter_set_latency_index (vgst_swfilter *sw, guint index);
+
+/* This API is to release the software filter state */
+void vgst_swfilter_free (vgst_swfilter *sw);
+
+/* This API is to check whether fs provides a native software engine */
+gboolean vgst_swfilter_supported (const struct filter_s *fs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INCLUDE_VGST_SWFILTER_H_ */
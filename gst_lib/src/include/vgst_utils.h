@@ -45,6 +45,7 @@
 #include "vgst_config.h"
 #include "vgst_lib.h"
 #include "video.h"
+#include "vgst_swfilter.h"
 #include <gst/video/videooverlay.h>
 
 
@@ -65,10 +66,16 @@ _vgst_playback {
     GstElement         *fpsdisplaysink, *rtppay, *fpsdisplaysink2, *videosink2;
     GstVideoOverlay    *overlay, *overlay2;
     GstPad             *pad, *pad2;
+    /* switcher graph: one selector sink pad per source, see create_switcher_pipeline */
+    GstElement         *selector;
+    GstPad             *selector_pads[MAX_SRC_NUM];
+    size_t             selector_vsrc[MAX_SRC_NUM];
+    guint              num_selector_pads;
+    vgst_swfilter      *swfilter;
     GMainLoop          *loop;
     gboolean           eos_flag, err_flag, stop_flag;
     gchar              *err_msg;
-    guint              fps_num[MAX_SPLIT_SCREEN], file_br;
+    guint              file_br;
     GstClockTime       eos_time;
 } vgst_playback;
 
@@ -123,6 +130,18 @@ guint get_bitrate (int index);
 /* This API is to poll events */
 gint poll_event (int *arg, int index);
 
+/* This API is to flag VGST_EVENT_MASK bits for pipeline index and wake up the event fd */
+void notify_event (guint index, guint mask);
+
+/* This API is to get the event fd, created on first use */
+gint get_event_fd (void);
+
+/* This API is to fetch and clear the pending events of pipeline index */
+guint take_events (guint index);
+
+/* This API is to close the event fd */
+void close_event_fd (void);
+
 /* This API is to get fps of the pipeline */
 void get_fps (guint index, guint *fps);
 
@@ -140,6 +159,33 @@ const char * vgst_get_srctype(size_t id);
 
 /* This API is to get video sink type for xilinx custom plugins */
 const char * vgst_get_sinkname(unsigned int display_id);
+
+/* This API is interface for creating the switcher pipeline, all sources in vsrc feed one sink */
+VGST_ERROR_LOG vgst_create_switcher_pipeline (const size_t *vsrc, guint num_vsrc);
+
+/* This API is to make vsrc the source shown by the switcher pipeline */
+VGST_ERROR_LOG switch_source (vgst_playback *play_ptr, size_t vsrc);
+
+/* This API is to park a pipeline in READY state so it can be resumed without rebuilding it */
+gint park_pipeline (vgst_playback *play_ptr);
+
+/* This API is to bring a parked pipeline back to PLAYING state */
+VGST_ERROR_LOG resume_pipeline (vgst_playback *play_ptr);
+
+/* This API is to tear down a pipeline which is not the active one */
+void destroy_pipeline (vgst_playback *play_ptr);
+
+/* This API is to select concurrent build and synchronized start for multi-source pipelines */
+void set_sync_start (gboolean enable);
+
+/* This API is to start timing a mode switch, the time is taken when a pipeline reaches PLAYING */
+void mark_switch_start (void);
+
+/* This API is to get the duration of the last mode switch in microseconds */
+gint64 get_switch_time (void);
+
+/* This API is to apply the filter2d coefficient schedule to every buffer entering filter */
+void filter2d_schedule_attach (GstElement *filter, struct filter_s *fs);
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,1032 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <linux/videodev2.h>
+
+#include "vgst_lib.h"
+#include "filter2d_sw.h"
+#include "filter2d_sw_int.h"
+#include "filter_band.h"
+
+/*
+ * Coefficient updates may come from any thread while a frame is running.
+ * Writers serialize on lock and compile into plan, which only they touch,
+ * then publish it: the copy goes to the slot readers are not pointed at
+ * and seq is bumped. Readers never block, they copy the slot seq points at
+ * and retry in the rare case seq moved during the copy, so a frame always
+ * runs with one consistent kernel picked up at its start.
+ */
+struct f2d_sw_data
+{
+  GMutex lock;
+  struct f2d_sw_plan plan;
+  struct f2d_sw_plan slots[2];
+  gint seq;
+  const char *kernel;
+  /* last 3x3 kernel loaded, handed out by filter2d_sw_coeff */
+  coeff_t coeff;
+  /* output stage, see F2D_NORM_LEN */
+  short norm[F2D_NORM_LEN];
+  /* held by a frame while it runs on the pool, init swaps the pool under it */
+  GMutex pool_lock;
+  struct filter_band_pool *pool;
+  unsigned int num_workers;
+  uint64_t cpu_mask;
+};
+
+/* One frame as seen by the band workers */
+struct f2d_sw_job
+{
+  struct f2d_sw_plan plan;
+  const unsigned short *in;
+  unsigned short *out;
+  int height;
+  int width;
+  int stride_in;
+  int stride_out;
+};
+
+static void
+f2d_row_c (const unsigned short *r0, const unsigned short *r1,
+    const unsigned short *r2, unsigned short *dst, int width, const short *k)
+{
+  int x;
+
+  for (x = 0; x < width; x++)
+    dst[x] = f2d_pixel (r0, r1, r2, x, width, k);
+}
+
+/* Scalar reference for one pixel of a ksize x ksize kernel */
+static inline unsigned short
+f2d_pixel_n (const unsigned short *const *rows, int x, int width,
+    const short *k, int ksize)
+{
+  int r = ksize / 2;
+  int acc = 0;
+  int i, j;
+
+  for (i = 0; i < ksize; i++) {
+    for (j = 0; j < ksize; j++) {
+      int xx = x + j - r;
+
+      xx = xx < 0 ? 0 : (xx >= width ? width - 1 : xx);
+      acc += k[i * ksize + j] * (rows[i][xx] & F2D_LUMA_MASK);
+    }
+  }
+
+  return f2d_clamp (acc, rows[r][x], k + F2D_KNNORM);
+}
+
+#if !defined(F2D_HAVE_NEON) && !defined(F2D_HAVE_SSE2)
+static void
+f2d_rown_c (const unsigned short *const *rows, unsigned short *dst, int width,
+    const short *k, int ksize)
+{
+  int x;
+
+  for (x = 0; x < width; x++)
+    dst[x] = f2d_pixel_n (rows, x, width, k, ksize);
+}
+#endif
+
+/*
+ * Kernels above 3x3 accumulate in 32 bit lanes, so any coefficient set is
+ * exact. SSE2 has no 32 bit multiply, _mm_madd_epi16 on interleaved
+ * neighbours computes two taps per lane instead. The sum is shifted while
+ * still 32 bit and narrowed with signed saturation before the rest of the
+ * output stage.
+ */
+#ifdef F2D_HAVE_SSE2
+static void
+f2d_rown_sse2 (const unsigned short *const *rows, unsigned short *dst,
+    int width, const short *k, int ksize)
+{
+  const __m128i ymask = _mm_set1_epi16 (F2D_LUMA_MASK);
+  const __m128i cmask = _mm_set1_epi16 ((short) F2D_CHROMA_MASK);
+  const __m128i zero = _mm_setzero_si128 ();
+  __m128i kp[KSIZE_MAX * ((KSIZE_MAX + 1) / 2)];
+  int pairs = (ksize + 1) / 2;
+  int r = ksize / 2;
+  int i, j, x = 0;
+  f2d_vnorm n;
+
+  f2d_vnorm_init (&n, k + F2D_KNNORM);
+
+  for (i = 0; i < ksize; i++) {
+    for (j = 0; j < pairs; j++) {
+      unsigned short k0 = k[i * ksize + 2 * j];
+      unsigned short k1 = 2 * j + 1 < ksize ? k[i * ksize + 2 * j + 1] : 0;
+
+      kp[i * pairs + j] = _mm_set1_epi32 ((int) (k0 | ((unsigned int) k1 << 16)));
+    }
+  }
+
+  for (; x < r && x < width; x++)
+    dst[x] = f2d_pixel_n (rows, x, width, k, ksize);
+
+  for (; x + 8 + r <= width; x += 8) {
+    __m128i lo = zero;
+    __m128i hi = zero;
+    __m128i acc;
+
+    for (i = 0; i < ksize; i++) {
+      const unsigned short *p = rows[i] + x - r;
+
+      for (j = 0; j < pairs; j++) {
+        __m128i a = _mm_and_si128 (_mm_loadu_si128 ((const __m128i *)
+                (p + 2 * j)), ymask);
+        __m128i b = 2 * j + 1 < ksize ? _mm_and_si128 (_mm_loadu_si128 (
+                (const __m128i *) (p + 2 * j + 1)), ymask) : zero;
+
+        lo = _mm_add_epi32 (lo,
+            _mm_madd_epi16 (_mm_unpacklo_epi16 (a, b), kp[i * pairs + j]));
+        hi = _mm_add_epi32 (hi,
+            _mm_madd_epi16 (_mm_unpackhi_epi16 (a, b), kp[i * pairs + j]));
+      }
+    }
+
+    acc = _mm_packs_epi32 (_mm_sra_epi32 (lo, n.shift),
+        _mm_sra_epi32 (hi, n.shift));
+    acc = f2d_vnorm_finish (acc, &n);
+    _mm_storeu_si128 ((__m128i *) (dst + x), _mm_or_si128 (acc,
+            _mm_and_si128 (_mm_loadu_si128 ((const __m128i *) (rows[r] + x)),
+                cmask)));
+  }
+
+  for (; x < width; x++)
+    dst[x] = f2d_pixel_n (rows, x, width, k, ksize);
+}
+#endif
+
+#ifdef F2D_HAVE_NEON
+static void
+f2d_rown_neon (const unsigned short *const *rows, unsigned short *dst,
+    int width, const short *k, int ksize)
+{
+  const uint16x8_t ymask = vdupq_n_u16 (F2D_LUMA_MASK);
+  const uint16x8_t cmask = vdupq_n_u16 (F2D_CHROMA_MASK);
+  const int32x4_t shift = vdupq_n_s32 (-k[F2D_KNNORM + F2D_NSHIFT]);
+  int r = ksize / 2;
+  int i, j, x = 0;
+  f2d_vnorm n;
+
+  f2d_vnorm_init (&n, k + F2D_KNNORM);
+
+  for (; x < r && x < width; x++)
+    dst[x] = f2d_pixel_n (rows, x, width, k, ksize);
+
+  for (; x + 8 + r <= width; x += 8) {
+    int32x4_t lo = vdupq_n_s32 (0);
+    int32x4_t hi = vdupq_n_s32 (0);
+    int16x8_t acc;
+
+    for (i = 0; i < ksize; i++) {
+      const unsigned short *p = rows[i] + x - r;
+
+      for (j = 0; j < ksize; j++) {
+        short c = k[i * ksize + j];
+        int16x8_t v;
+
+        if (!c)
+          continue;
+        v = vreinterpretq_s16_u16 (vandq_u16 (vld1q_u16 (p + j), ymask));
+        lo = vmlal_n_s16 (lo, vget_low_s16 (v), c);
+        hi = vmlal_n_s16 (hi, vget_high_s16 (v), c);
+      }
+    }
+
+    acc = vcombine_s16 (vqmovn_s32 (vshlq_s32 (lo, shift)),
+        vqmovn_s32 (vshlq_s32 (hi, shift)));
+    acc = f2d_vnorm_finish (acc, &n);
+    vst1q_u16 (dst + x, vorrq_u16 (vreinterpretq_u16_s16 (acc),
+            vandq_u16 (vld1q_u16 (rows[r] + x), cmask)));
+  }
+
+  for (; x < width; x++)
+    dst[x] = f2d_pixel_n (rows, x, width, k, ksize);
+}
+#endif
+
+/*
+ * The vector kernels accumulate in 16 bit lanes which is exact as long as
+ * sum(|k|) * 255 fits into a short. Wider kernels use the scalar path. The
+ * first and last column are always done in scalar code so the vector loop
+ * never has to deal with the replicated border.
+ */
+#ifdef F2D_HAVE_SSE2
+#define F2D_SSE_TAP(acc, r, off, kv)					\
+  acc = _mm_add_epi16 (acc, _mm_mullo_epi16 (_mm_and_si128 (		\
+          _mm_loadu_si128 ((const __m128i *) ((r) + x + (off))), ymask), kv))
+
+static void
+f2d_row_sse2 (const unsigned short *r0, const unsigned short *r1,
+    const unsigned short *r2, unsigned short *dst, int width, const short *k)
+{
+  const __m128i ymask = _mm_set1_epi16 (F2D_LUMA_MASK);
+  const __m128i zero = _mm_setzero_si128 ();
+  __m128i kv[F2D_TAPS];
+  int i, x = 0;
+  f2d_vnorm n;
+
+  for (i = 0; i < F2D_TAPS; i++)
+    kv[i] = _mm_set1_epi16 (k[i]);
+  f2d_vnorm_init (&n, k + F2D_KNORM);
+
+  if (width > 0)
+    dst[x++] = f2d_pixel (r0, r1, r2, 0, width, k);
+
+  for (; x + 8 <= width - 1; x += 8) {
+    __m128i acc = zero;
+
+    F2D_SSE_TAP (acc, r0, -1, kv[0]);
+    F2D_SSE_TAP (acc, r0, 0, kv[1]);
+    F2D_SSE_TAP (acc, r0, 1, kv[2]);
+    F2D_SSE_TAP (acc, r1, -1, kv[3]);
+    F2D_SSE_TAP (acc, r1, 0, kv[4]);
+    F2D_SSE_TAP (acc, r1, 1, kv[5]);
+    F2D_SSE_TAP (acc, r2, -1, kv[6]);
+    F2D_SSE_TAP (acc, r2, 0, kv[7]);
+    F2D_SSE_TAP (acc, r2, 1, kv[8]);
+
+    f2d_vstore_px (dst + x, acc, r1 + x, &n);
+  }
+
+  for (; x < width; x++)
+    dst[x] = f2d_pixel (r0, r1, r2, x, width, k);
+}
+#endif
+
+#ifdef F2D_HAVE_AVX2
+#define F2D_AVX_TAP(acc, r, off, kv)					\
+  acc = _mm256_add_epi16 (acc, _mm256_mullo_epi16 (_mm256_and_si256 (	\
+          _mm256_loadu_si256 ((const __m256i *) ((r) + x + (off))), ymask), kv))
+
+__attribute__ ((target ("avx2")))
+static void
+f2d_row_avx2 (const unsigned short *r0, const unsigned short *r1,
+    const unsigned short *r2, unsigned short *dst, int width, const short *k)
+{
+  const __m256i ymask = _mm256_set1_epi16 (F2D_LUMA_MASK);
+  const __m256i cmask = _mm256_set1_epi16 ((short) F2D_CHROMA_MASK);
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i max = _mm256_set1_epi16 (255);
+  const __m128i shift = _mm_cvtsi32_si128 (k[F2D_KNORM + F2D_NSHIFT]);
+  const __m256i sign = _mm256_set1_epi16 (k[F2D_KNORM + F2D_NABS] ? -1 : 0);
+  const __m256i offset = _mm256_set1_epi16 (k[F2D_KNORM + F2D_NOFFSET]);
+  __m256i kv[F2D_TAPS];
+  int i, x = 0;
+
+  for (i = 0; i < F2D_TAPS; i++)
+    kv[i] = _mm256_set1_epi16 (k[i]);
+
+  if (width > 0)
+    dst[x++] = f2d_pixel (r0, r1, r2, 0, width, k);
+
+  for (; x + 16 <= width - 1; x += 16) {
+    __m256i acc = zero;
+    __m256i center;
+    __m256i s;
+
+    F2D_AVX_TAP (acc, r0, -1, kv[0]);
+    F2D_AVX_TAP (acc, r0, 0, kv[1]);
+    F2D_AVX_TAP (acc, r0, 1, kv[2]);
+    F2D_AVX_TAP (acc, r1, -1, kv[3]);
+    F2D_AVX_TAP (acc, r1, 0, kv[4]);
+    F2D_AVX_TAP (acc, r1, 1, kv[5]);
+    F2D_AVX_TAP (acc, r2, -1, kv[6]);
+    F2D_AVX_TAP (acc, r2, 0, kv[7]);
+    F2D_AVX_TAP (acc, r2, 1, kv[8]);
+
+    /* output stage, see f2d_vstore_px */
+    acc = _mm256_sra_epi16 (acc, shift);
+    s = _mm256_and_si256 (_mm256_srai_epi16 (acc, 15), sign);
+    acc = _mm256_subs_epi16 (_mm256_xor_si256 (acc, s), s);
+    acc = _mm256_adds_epi16 (acc, offset);
+    acc = _mm256_min_epi16 (_mm256_max_epi16 (acc, zero), max);
+    center = _mm256_loadu_si256 ((const __m256i *) (r1 + x));
+    _mm256_storeu_si256 ((__m256i *) (dst + x),
+        _mm256_or_si256 (acc, _mm256_and_si256 (center, cmask)));
+  }
+
+  for (; x < width; x++)
+    dst[x] = f2d_pixel (r0, r1, r2, x, width, k);
+}
+#endif
+
+#ifdef F2D_HAVE_NEON
+#define F2D_NEON_TAP(acc, r, off, kk)					\
+  acc = vmlaq_n_s16 (acc, vreinterpretq_s16_u16 (vandq_u16 (		\
+          vld1q_u16 ((r) + x + (off)), ymask)), kk)
+
+static void
+f2d_row_neon (const unsigned short *r0, const unsigned short *r1,
+    const unsigned short *r2, unsigned short *dst, int width, const short *k)
+{
+  const uint16x8_t ymask = vdupq_n_u16 (F2D_LUMA_MASK);
+  const int16x8_t zero = vdupq_n_s16 (0);
+  int x = 0;
+  f2d_vnorm n;
+
+  f2d_vnorm_init (&n, k + F2D_KNORM);
+
+  if (width > 0)
+    dst[x++] = f2d_pixel (r0, r1, r2, 0, width, k);
+
+  for (; x + 8 <= width - 1; x += 8) {
+    int16x8_t acc = zero;
+
+    F2D_NEON_TAP (acc, r0, -1, k[0]);
+    F2D_NEON_TAP (acc, r0, 0, k[1]);
+    F2D_NEON_TAP (acc, r0, 1, k[2]);
+    F2D_NEON_TAP (acc, r1, -1, k[3]);
+    F2D_NEON_TAP (acc, r1, 0, k[4]);
+    F2D_NEON_TAP (acc, r1, 1, k[5]);
+    F2D_NEON_TAP (acc, r2, -1, k[6]);
+    F2D_NEON_TAP (acc, r2, 0, k[7]);
+    F2D_NEON_TAP (acc, r2, 1, k[8]);
+
+    f2d_vstore_px (dst + x, acc, r1 + x, &n);
+  }
+
+  for (; x < width; x++)
+    dst[x] = f2d_pixel (r0, r1, r2, x, width, k);
+}
+#endif
+
+/*
+ * Rank-1 kernel as the outer product of the column v and the row k[F2D_KH],
+ * two 1-D passes with 6 instead of 9 multiply-accumulates per pixel. The
+ * vertical pass goes to an intermediate row of shorts that stays in L1.
+ */
+static void
+f2d_row_sep (const unsigned short *r0, const unsigned short *r1,
+    const unsigned short *r2, unsigned short *dst, int width, const short *k)
+{
+  const short *v = k + F2D_KV;
+  const short *h = k + F2D_KH;
+  short tmp[F2D_SEP_MAX_WIDTH + 2];
+  f2d_vnorm n;
+  int x;
+
+  f2d_vnorm_init (&n, k + F2D_KNORM);
+  if (width <= 0 || width > F2D_SEP_MAX_WIDTH) {
+    for (x = 0; x < width; x++)
+      dst[x] = f2d_pixel (r0, r1, r2, x, width, k);
+    return;
+  }
+
+  for (x = 0; x + F2D_VLANES <= width; x += F2D_VLANES) {
+    f2d_vec acc = f2d_vmulc (f2d_vload_y (r0 + x), v[0]);
+
+    acc = f2d_vadd (acc, f2d_vmulc (f2d_vload_y (r1 + x), v[1]));
+    acc = f2d_vadd (acc, f2d_vmulc (f2d_vload_y (r2 + x), v[2]));
+    f2d_vstore_s16 (tmp + 1 + x, acc);
+  }
+  for (; x < width; x++)
+    tmp[1 + x] = v[0] * (r0[x] & F2D_LUMA_MASK) +
+        v[1] * (r1[x] & F2D_LUMA_MASK) + v[2] * (r2[x] & F2D_LUMA_MASK);
+  tmp[0] = tmp[1];
+  tmp[width + 1] = tmp[width];
+
+  for (x = 0; x + F2D_VLANES <= width; x += F2D_VLANES) {
+    f2d_vec acc = f2d_vmulc (f2d_vload_s16 (tmp + x), h[0]);
+
+    acc = f2d_vadd (acc, f2d_vmulc (f2d_vload_s16 (tmp + x + 1), h[1]));
+    acc = f2d_vadd (acc, f2d_vmulc (f2d_vload_s16 (tmp + x + 2), h[2]));
+    f2d_vstore_px (dst + x, acc, r1 + x, &n);
+  }
+  for (; x < width; x++)
+    dst[x] = f2d_clamp (h[0] * tmp[x] + h[1] * tmp[x + 1] + h[2] * tmp[x + 2],
+        r1[x], k + F2D_KNORM);
+}
+
+static int
+f2d_gcd (int a, int b)
+{
+  while (b) {
+    int t = a % b;
+
+    a = b;
+    b = t;
+  }
+
+  return a;
+}
+
+/*
+ * Check whether the 3x3 kernel k is the outer product of two integer
+ * 3-vectors and if so return them in v (column) and h (row).
+ */
+static int
+f2d_rank1 (const short *k, short *v, short *h)
+{
+  int r, c, i, g = 0;
+
+  for (r = 0; r < 3; r++) {
+    if (k[r * 3] || k[r * 3 + 1] || k[r * 3 + 2])
+      break;
+  }
+  if (r == 3)
+    return 0;
+
+  /* any row of a rank-1 integer matrix is an integer multiple of the
+   * first non-zero row divided by its gcd */
+  for (i = 0; i < 3; i++)
+    g = f2d_gcd (g, abs (k[r * 3 + i]));
+  for (i = 0; i < 3; i++)
+    h[i] = k[r * 3 + i] / g;
+
+  for (c = 0; !h[c]; c++);
+  for (i = 0; i < 3; i++)
+    v[i] = k[i * 3 + c] / h[c];
+
+  for (i = 0; i < F2D_TAPS; i++) {
+    if (k[i] != v[i / 3] * h[i % 3])
+      return 0;
+  }
+
+  return 1;
+}
+
+/* Vector row kernel for this CPU, NULL if only the scalar path is usable */
+static f2d_row_fn
+f2d_select_simd (const char **isa)
+{
+#ifdef F2D_HAVE_NEON
+  *isa = "neon";
+  return f2d_row_neon;
+#else
+#ifdef F2D_HAVE_AVX2
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2")) {
+    *isa = "avx2";
+    return f2d_row_avx2;
+  }
+#endif
+#ifdef F2D_HAVE_SSE2
+  *isa = "sse2";
+  return f2d_row_sse2;
+#endif
+#endif
+  *isa = "c";
+  return NULL;
+}
+
+/* Copy the output stage next to the taps the row kernels get */
+static void
+f2d_plan_norm (struct f2d_sw_data *d)
+{
+  memcpy (d->plan.k + F2D_KNORM, d->norm, sizeof d->norm);
+  memcpy (d->plan.kn + F2D_KNNORM, d->norm, sizeof d->norm);
+}
+
+static void
+f2d_compile (struct f2d_sw_data *d, const short coeff[3][3])
+{
+  struct f2d_sw_plan *plan = &d->plan;
+  const char *isa;
+  f2d_row_fn simd;
+  int i, sum = 0;
+
+  memcpy (d->coeff, coeff, sizeof d->coeff);
+  plan->ksize = 3;
+  for (i = 0; i < F2D_TAPS; i++) {
+    plan->k[i] = coeff[i / 3][i % 3];
+    sum += abs (plan->k[i]);
+  }
+  f2d_plan_norm (d);
+
+  /* everything but the scalar kernel accumulates in 16 bit */
+  simd = f2d_select_simd (&isa);
+  if (sum * 255 > 32767) {
+    plan->row = f2d_row_c;
+    d->kernel = "generic (scalar)";
+  } else if (f2d_rank1 (plan->k, plan->k + F2D_KV, plan->k + F2D_KH)) {
+    plan->row = f2d_row_sep;
+    d->kernel = "separable";
+  } else if (simd) {
+    plan->row = simd;
+    d->kernel = "generic";
+  } else {
+    plan->row = f2d_row_c;
+    d->kernel = "generic (scalar)";
+  }
+}
+
+/* ksize x ksize kernel, zero outer rings are stripped first */
+static void
+f2d_compile_n (struct f2d_sw_data *d, int ksize, const short *coeff)
+{
+  struct f2d_sw_plan *plan = &d->plan;
+  short k[KSIZE_MAX * KSIZE_MAX];
+  int i, j;
+
+  memcpy (k, coeff, ksize * ksize * sizeof *k);
+  while (ksize > 3) {
+    int n = ksize - 2;
+    int ring = 0;
+
+    for (i = 0; i < ksize; i++) {
+      ring |= k[i] | k[(ksize - 1) * ksize + i] | k[i * ksize] |
+          k[i * ksize + ksize - 1];
+    }
+    if (ring)
+      break;
+    for (i = 0; i < n; i++) {
+      for (j = 0; j < n; j++)
+        k[i * n + j] = k[(i + 1) * ksize + j + 1];
+    }
+    ksize = n;
+  }
+
+  if (ksize == 3) {
+    short c3[3][3];
+
+    memcpy (c3, k, sizeof c3);
+    f2d_compile (d, c3);
+    return;
+  }
+
+  plan->ksize = ksize;
+  memcpy (plan->kn, k, ksize * ksize * sizeof *k);
+  f2d_plan_norm (d);
+#if defined(F2D_HAVE_NEON)
+  plan->rown = f2d_rown_neon;
+#elif defined(F2D_HAVE_SSE2)
+  plan->rown = f2d_rown_sse2;
+#else
+  plan->rown = f2d_rown_c;
+#endif
+  d->kernel = ksize == 5 ? "generic 5x5" : "generic 7x7";
+}
+
+/* Use the build time specialized kernel if coeff really is the preset */
+static void
+f2d_compile_preset (struct f2d_sw_data *d, filter2d_preset preset,
+    const short coeff[3][3])
+{
+  const struct f2d_sw_kernel *kern;
+  int i;
+
+  if ((unsigned int) preset >= FILTER2D_PRESET_CNT) {
+    f2d_compile (d, coeff);
+    return;
+  }
+
+  kern = &f2d_sw_presets[preset];
+  for (i = 0; i < F2D_TAPS; i++) {
+    if (kern->coeff[i] != coeff[i / 3][i % 3]) {
+      f2d_compile (d, coeff);
+      return;
+    }
+  }
+
+  memcpy (d->coeff, coeff, sizeof d->coeff);
+  d->plan.ksize = 3;
+  memcpy (d->plan.k, kern->coeff, sizeof kern->coeff);
+  f2d_plan_norm (d);
+  d->plan.row = kern->row;
+  d->kernel = kern->name;
+}
+
+/* Make the compiled plan the one the next frame picks up, lock held */
+static void
+f2d_publish (struct f2d_sw_data *d)
+{
+  gint next = d->seq + 1;
+
+  d->slots[next & 1] = d->plan;
+  g_atomic_int_set (&d->seq, next);
+}
+
+/* Serializes the lazy creation of the engine state of any filter */
+static GMutex f2d_data_lock;
+
+static struct f2d_sw_data *
+f2d_get_data (struct filter_s *fs)
+{
+  static const short identity[3][3] = { {0, 0, 0}, {0, 1, 0}, {0, 0, 0} };
+  struct f2d_sw_data *d = g_atomic_pointer_get (&fs->data);
+
+  if (d)
+    return d;
+
+  /* the streaming thread and a coefficient update may race to create it */
+  g_mutex_lock (&f2d_data_lock);
+  d = fs->data;
+  if (!d) {
+    d = calloc (1, sizeof *d);
+    if (d) {
+      g_mutex_init (&d->lock);
+      g_mutex_init (&d->pool_lock);
+      f2d_compile_preset (d, FILTER2D_PRESET_IDENTITY, identity);
+      f2d_publish (d);
+      g_atomic_pointer_set (&fs->data, d);
+    }
+  }
+  g_mutex_unlock (&f2d_data_lock);
+
+  return d;
+}
+
+int
+f2d_sw_snapshot (struct filter_s *fs, struct f2d_sw_plan *plan)
+{
+  struct f2d_sw_data *d = f2d_get_data (fs);
+  gint seq;
+
+  if (!d)
+    return VLIB_ERROR_NO_MEM;
+
+  do {
+    seq = g_atomic_int_get (&d->seq);
+    *plan = d->slots[seq & 1];
+    /* keep the slot copy ahead of the re-read, the load alone is not enough */
+    __atomic_thread_fence (__ATOMIC_ACQUIRE);
+  } while (g_atomic_int_get (&d->seq) != seq);
+
+  return VLIB_SUCCESS;
+}
+
+/* Rows outside the band are only read, so bands never overlap on output */
+static void
+f2d_band (void *priv, int y_start, int y_end)
+{
+  const struct f2d_sw_job *job = priv;
+  const unsigned short *rows[KSIZE_MAX];
+  int r = job->plan.ksize / 2;
+  int last = job->height - 1;
+  int i, y;
+
+  for (y = y_start; y < y_end; y++) {
+    for (i = 0; i < job->plan.ksize; i++) {
+      int yy = y + i - r;
+
+      yy = yy < 0 ? 0 : (yy > last ? last : yy);
+      rows[i] = job->in + yy * job->stride_in;
+    }
+    f2d_plan_run_row (&job->plan, rows, job->out + y * job->stride_out,
+        job->width);
+  }
+}
+
+/**
+ * filter2d_sw_init - initialize the software 2D filter engine
+ * @fs: Pointer to filter struct
+ * @data: Frame geometry and format the filter will be run with
+ *
+ * Return: 0 on success, error code otherwise.
+ */
+int
+filter2d_sw_init (struct filter_s *fs, const struct filter_init_data *data)
+{
+  struct f2d_sw_data *d;
+  unsigned int num_workers;
+  int ret = VLIB_SUCCESS;
+
+  if (!fs || !data)
+    return VLIB_ERROR_INVALID_PARAM;
+
+  if (data->in_fourcc != V4L2_PIX_FMT_YUYV ||
+      data->out_fourcc != V4L2_PIX_FMT_YUYV ||
+      data->in_width != data->out_width || data->in_height != data->out_height)
+    return VLIB_ERROR_NOT_SUPPORTED;
+
+  d = f2d_get_data (fs);
+  if (!d)
+    return VLIB_ERROR_NO_MEM;
+
+  num_workers = data->num_workers ? data->num_workers :
+      filter_band_default_workers ();
+  g_mutex_lock (&d->pool_lock);
+  if (d->pool && (d->num_workers != num_workers ||
+          d->cpu_mask != data->cpu_mask)) {
+    filter_band_pool_free (d->pool);
+    g_atomic_pointer_set (&d->pool, NULL);
+  }
+  d->num_workers = num_workers;
+  d->cpu_mask = data->cpu_mask;
+  if (!d->pool && num_workers > 1) {
+    g_atomic_pointer_set (&d->pool,
+        filter_band_pool_new (num_workers, data->cpu_mask));
+    if (!d->pool)
+      ret = VLIB_ERROR_NO_MEM;
+  }
+  g_mutex_unlock (&d->pool_lock);
+
+  return ret;
+}
+
+/**
+ * filter2d_sw_func - run the loaded kernel on one YUYV frame
+ * @fs: Pointer to filter struct
+ * @frm_data_in: Input frame
+ * @frm_data_out: Output frame, must not alias the input
+ * @height_in: Input height in lines
+ * @width_in: Input width in pixels
+ * @stride_in: Input stride in pixels
+ * @height_out: Output height in lines
+ * @width_out: Output width in pixels
+ * @stride_out: Output stride in pixels
+ *
+ * Border pixels are replicated. Luma is filtered, chroma is copied as is.
+ * When the engine was initialized with more than one worker the frame is
+ * split into horizontal bands processed in parallel.
+ */
+void
+filter2d_sw_func (struct filter_s *fs,
+    unsigned short *frm_data_in, unsigned short *frm_data_out,
+    int height_in, int width_in, int stride_in,
+    int height_out, int width_out, int stride_out)
+{
+  struct f2d_sw_data *d = f2d_get_data (fs);
+  struct f2d_sw_job job;
+
+  if (!d)
+    return;
+
+  job.height = height_in < height_out ? height_in : height_out;
+  job.width = width_in < width_out ? width_in : width_out;
+  if (job.height <= 0 || job.width <= 0)
+    return;
+
+  f2d_sw_snapshot (fs, &job.plan);
+  job.in = frm_data_in;
+  job.out = frm_data_out;
+  job.stride_in = stride_in;
+  job.stride_out = stride_out;
+
+  /* single worker frames run inline without the lock, a pool seen here
+   * is checked again under it in case init is replacing it */
+  if (g_atomic_pointer_get (&d->pool)) {
+    g_mutex_lock (&d->pool_lock);
+    if (d->pool) {
+      filter_band_pool_run (d->pool, f2d_band, &job, job.height);
+      g_mutex_unlock (&d->pool_lock);
+      return;
+    }
+    g_mutex_unlock (&d->pool_lock);
+  }
+  f2d_band (&job, 0, job.height);
+}
+
+/**
+ * filter2d_sw_deinit - release the engine state attached to a filter
+ * @fs: Pointer to filter struct
+ */
+void
+filter2d_sw_deinit (struct filter_s *fs)
+{
+  struct f2d_sw_data *d;
+
+  if (!fs)
+    return;
+
+  d = fs->data;
+  if (d) {
+    filter_band_pool_free (d->pool);
+    g_mutex_clear (&d->pool_lock);
+    g_mutex_clear (&d->lock);
+  }
+  free (d);
+  fs->data = NULL;
+}
+
+/**
+ * filter2d_sw_set_coeff - load new coefficients into the engine
+ * @fs: Pointer to filter struct
+ * @coeff: 3x3 kernel, row major
+ */
+void
+filter2d_sw_set_coeff (struct filter_s *fs, const short coeff[3][3])
+{
+  struct f2d_sw_data *d;
+
+  if (!fs)
+    return;
+
+  d = f2d_get_data (fs);
+  if (!d)
+    return;
+
+  g_mutex_lock (&d->lock);
+  f2d_compile (d, coeff);
+  f2d_publish (d);
+  g_mutex_unlock (&d->lock);
+}
+
+/**
+ * filter2d_sw_set_kernel - load a 3x3, 5x5 or 7x7 kernel into the engine
+ * @fs: Pointer to filter struct
+ * @kernel: Kernel to load
+ *
+ * Return: 0 on success, error code otherwise.
+ */
+int
+filter2d_sw_set_kernel (struct filter_s *fs, const filter2d_kernel * kernel)
+{
+  short k[KSIZE_MAX * KSIZE_MAX];
+  struct f2d_sw_data *d;
+  int i, j;
+
+  if (!fs || !kernel || (kernel->ksize != 3 && kernel->ksize != 5 &&
+          kernel->ksize != 7))
+    return VLIB_ERROR_INVALID_PARAM;
+
+  d = f2d_get_data (fs);
+  if (!d)
+    return VLIB_ERROR_NO_MEM;
+
+  for (i = 0; i < kernel->ksize; i++) {
+    for (j = 0; j < kernel->ksize; j++)
+      k[i * kernel->ksize + j] = kernel->coeff[i][j];
+  }
+  g_mutex_lock (&d->lock);
+  f2d_compile_n (d, kernel->ksize, k);
+  f2d_publish (d);
+  g_mutex_unlock (&d->lock);
+
+  return VLIB_SUCCESS;
+}
+
+/**
+ * filter2d_sw_set_norm - set the output stage of the engine
+ * @fs: Pointer to filter struct
+ * @norm: Shift, offset and saturation mode, NULL for the identity
+ *
+ * The stage applies to the loaded kernel and to every kernel loaded later.
+ *
+ * Return: 0 on success, error code otherwise.
+ */
+int
+filter2d_sw_set_norm (struct filter_s *fs, const filter2d_norm * norm)
+{
+  struct f2d_sw_data *d;
+
+  if (!fs)
+    return VLIB_ERROR_INVALID_PARAM;
+  if (norm && (norm->shift > FILTER2D_SHIFT_MAX ||
+          norm->offset < -FILTER2D_OFFSET_MAX ||
+          norm->offset > FILTER2D_OFFSET_MAX))
+    return VLIB_ERROR_INVALID_PARAM;
+
+  d = f2d_get_data (fs);
+  if (!d)
+    return VLIB_ERROR_NO_MEM;
+
+  g_mutex_lock (&d->lock);
+  d->norm[F2D_NSHIFT] = norm ? norm->shift : 0;
+  d->norm[F2D_NOFFSET] = norm ? norm->offset : 0;
+  d->norm[F2D_NABS] = norm ? norm->sat_mode == FILTER2D_SAT_ABS : 0;
+  f2d_plan_norm (d);
+  f2d_publish (d);
+  g_mutex_unlock (&d->lock);
+
+  return VLIB_SUCCESS;
+}
+
+/**
+ * filter2d_sw_set_preset - load a preset into the engine
+ * @fs: Pointer to filter struct
+ * @preset: Preset the coefficients belong to
+ * @coeff: 3x3 kernel of the preset, row major
+ *
+ * Selects the kernel specialized for @preset, falling back to the generic
+ * kernel if @coeff does not match the preset.
+ */
+void
+filter2d_sw_set_preset (struct filter_s *fs, filter2d_preset preset,
+    const short coeff[3][3])
+{
+  struct f2d_sw_data *d;
+
+  if (!fs)
+    return;
+
+  d = f2d_get_data (fs);
+  if (!d)
+    return;
+
+  g_mutex_lock (&d->lock);
+  f2d_compile_preset (d, preset, coeff);
+  f2d_publish (d);
+  g_mutex_unlock (&d->lock);
+}
+
+/**
+ * filter2d_sw_get_coeff - coefficients the next frame will run with
+ * @fs: Pointer to filter struct
+ * @coeff: Returns the 3x3 kernel, row major
+ *
+ * Return: 0 on success, VLIB_ERROR_NOT_SUPPORTED if a larger kernel is
+ * loaded, error code otherwise.
+ */
+int
+filter2d_sw_get_coeff (struct filter_s *fs, short coeff[3][3])
+{
+  struct f2d_sw_plan plan;
+  int ret, i;
+
+  if (!fs)
+    return VLIB_ERROR_INVALID_PARAM;
+
+  ret = f2d_sw_snapshot (fs, &plan);
+  if (ret != VLIB_SUCCESS)
+    return ret;
+  if (plan.ksize != 3)
+    return VLIB_ERROR_NOT_SUPPORTED;
+
+  for (i = 0; i < F2D_TAPS; i++)
+    coeff[i / 3][i % 3] = plan.k[i];
+
+  return VLIB_SUCCESS;
+}
+
+/**
+ * filter2d_sw_coeff - last 3x3 kernel loaded into the engine
+ * @fs: Pointer to filter struct
+ *
+ * The storage belongs to @fs and is only written with its lock held, use
+ * filter2d_sw_get_coeff to read it while another thread may load a kernel.
+ *
+ * Return: kernel, NULL if the engine is not set up
+ */
+coeff_t *
+filter2d_sw_coeff (struct filter_s *fs)
+{
+  struct f2d_sw_data *d = fs ? f2d_get_data (fs) : NULL;
+
+  return d ? &d->coeff : NULL;
+}
+
+/**
+ * filter2d_sw_get_kernel - name of the kernel strategy the engine runs
+ * @fs: Pointer to filter struct
+ *
+ * Return: kernel name, NULL if the engine is not set up
+ */
+const char *
+filter2d_sw_get_kernel (struct filter_s *fs)
+{
+  struct f2d_sw_data *d = fs ? f2d_get_data (fs) : NULL;
+
+  return d ? d->kernel : NULL;
+}
+
+/**
+ * filter2d_sw_get_isa - name of the instruction set used by the engine
+ *
+ * Return: "neon", "avx2", "sse2" or "c"
+ */
+const char *
+filter2d_sw_get_isa (void)
+{
+  const char *isa;
+
+  f2d_select_simd (&isa);
+  return isa;
+}
+
+struct filter_ops filter2d_sw_ops = {
+  .init = filter2d_sw_init,
+  .func = filter2d_sw_func,
+  .func2 = NULL,
+};
@@ -0,0 +1,196 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+#include <string.h>
+
+#include "filter2d_sw_int.h"
+
+/*
+ * Row kernels for the filter2d presets. Every kernel is expanded from one
+ * of the macros below with its weights as literal constants, so the
+ * compiler drops zero taps and turns +-1/+-2 weights into adds and shifts.
+ * The weights must match the coeff_t tables in vgst_sdxfilter2d.c. The
+ * coefficient block passed in holds the same taps for the scalar border
+ * columns and the output stage.
+ */
+
+/* Generic 3x3 kernel with constant weights */
+#define F2D_DEFINE_ROW(name, k0, k1, k2, k3, k4, k5, k6, k7, k8)	\
+static void								\
+f2d_row_##name (const unsigned short *r0, const unsigned short *r1,	\
+    const unsigned short *r2, unsigned short *dst, int width,		\
+    const short *k)							\
+{									\
+  f2d_vnorm n;								\
+  int x = 0;								\
+									\
+  f2d_vnorm_init (&n, k + F2D_KNORM);					\
+  if (width > 0)							\
+    dst[x++] = f2d_pixel (r0, r1, r2, 0, width, k);			\
+  for (; x + F2D_VLANES <= width - 1; x += F2D_VLANES) {		\
+    f2d_vec acc = f2d_vzero ();						\
+									\
+    F2D_CTAP (acc, f2d_vload_y, r0 + x - 1, k0);			\
+    F2D_CTAP (acc, f2d_vload_y, r0 + x, k1);				\
+    F2D_CTAP (acc, f2d_vload_y, r0 + x + 1, k2);			\
+    F2D_CTAP (acc, f2d_vload_y, r1 + x - 1, k3);			\
+    F2D_CTAP (acc, f2d_vload_y, r1 + x, k4);				\
+    F2D_CTAP (acc, f2d_vload_y, r1 + x + 1, k5);			\
+    F2D_CTAP (acc, f2d_vload_y, r2 + x - 1, k6);			\
+    F2D_CTAP (acc, f2d_vload_y, r2 + x, k7);				\
+    F2D_CTAP (acc, f2d_vload_y, r2 + x + 1, k8);			\
+    f2d_vstore_px (dst + x, acc, r1 + x, &n);				\
+  }									\
+  for (; x < width; x++)						\
+    dst[x] = f2d_pixel (r0, r1, r2, x, width, k);			\
+}
+
+/*
+ * Separable kernel, outer product of the column (v0, v1, v2) and the row
+ * (h0, h1, h2) plus c times the center pixel: a vertical pass into a row
+ * of shorts that stays in L1, then a horizontal pass over it. Border
+ * columns are replicated in the intermediate row.
+ */
+#define F2D_DEFINE_ROW_SEP(name, v0, v1, v2, h0, h1, h2, c)		\
+static void								\
+f2d_row_##name (const unsigned short *r0, const unsigned short *r1,	\
+    const unsigned short *r2, unsigned short *dst, int width,		\
+    const short *k)							\
+{									\
+  short tmp[F2D_SEP_MAX_WIDTH + 2];					\
+  f2d_vnorm n;								\
+  int x;								\
+									\
+  f2d_vnorm_init (&n, k + F2D_KNORM);					\
+  if (width <= 0 || width > F2D_SEP_MAX_WIDTH) {			\
+    for (x = 0; x < width; x++)						\
+      dst[x] = f2d_pixel (r0, r1, r2, x, width, k);			\
+    return;								\
+  }									\
+									\
+  for (x = 0; x + F2D_VLANES <= width; x += F2D_VLANES) {		\
+    f2d_vec acc = f2d_vzero ();						\
+									\
+    F2D_CTAP (acc, f2d_vload_y, r0 + x, v0);				\
+    F2D_CTAP (acc, f2d_vload_y, r1 + x, v1);				\
+    F2D_CTAP (acc, f2d_vload_y, r2 + x, v2);				\
+    f2d_vstore_s16 (tmp + 1 + x, acc);					\
+  }									\
+  for (; x < width; x++)						\
+    tmp[1 + x] = (v0) * (r0[x] & F2D_LUMA_MASK) +			\
+        (v1) * (r1[x] & F2D_LUMA_MASK) + (v2) * (r2[x] & F2D_LUMA_MASK);	\
+  tmp[0] = tmp[1];							\
+  tmp[width + 1] = tmp[width];						\
+									\
+  for (x = 0; x + F2D_VLANES <= width; x += F2D_VLANES) {		\
+    f2d_vec acc = f2d_vzero ();						\
+									\
+    F2D_CTAP (acc, f2d_vload_s16, tmp + x, h0);				\
+    F2D_CTAP (acc, f2d_vload_s16, tmp + x + 1, h1);			\
+    F2D_CTAP (acc, f2d_vload_s16, tmp + x + 2, h2);			\
+    F2D_CTAP (acc, f2d_vload_y, r1 + x, c);				\
+    f2d_vstore_px (dst + x, acc, r1 + x, &n);				\
+  }									\
+  for (; x < width; x++)						\
+    dst[x] = f2d_clamp ((h0) * tmp[x] + (h1) * tmp[x + 1] +		\
+        (h2) * tmp[x + 2] + (c) * (r1[x] & F2D_LUMA_MASK), r1[x],	\
+        k + F2D_KNORM);							\
+}
+
+/* Identity only has to copy the center row, unless there is an output
+ * stage to apply */
+static void
+f2d_row_identity (const unsigned short *r0, const unsigned short *r1,
+    const unsigned short *r2, unsigned short *dst, int width, const short *k)
+{
+  f2d_vnorm n;
+  int x;
+
+  (void) r0;
+  (void) r2;
+  if (width <= 0)
+    return;
+  if (f2d_norm_is_identity (k + F2D_KNORM)) {
+    memcpy (dst, r1, width * sizeof *dst);
+    return;
+  }
+
+  f2d_vnorm_init (&n, k + F2D_KNORM);
+  for (x = 0; x + F2D_VLANES <= width; x += F2D_VLANES)
+    f2d_vstore_px (dst + x, f2d_vload_y (r1 + x), r1 + x, &n);
+  for (; x < width; x++)
+    dst[x] = f2d_clamp (r1[x] & F2D_LUMA_MASK, r1[x], k + F2D_KNORM);
+}
+
+F2D_DEFINE_ROW (edge, 0, 1, 0, 1, -4, 1, 0, 1, 0)
+F2D_DEFINE_ROW (edge_h, 0, -1, 0, 0, 2, 0, 0, -1, 0)
+F2D_DEFINE_ROW (edge_v, 0, 0, 0, -1, 2, -1, 0, 0, 0)
+F2D_DEFINE_ROW (emboss, -2, -1, 0, -1, 1, 1, 0, 1, 2)
+F2D_DEFINE_ROW (sharpen, 0, -1, 0, -1, 5, -1, 0, -1, 0)
+/* blur is a separable 3x3 box minus 8 times the center */
+F2D_DEFINE_ROW_SEP (blur, 1, 1, 1, 1, 1, 1, -8)
+F2D_DEFINE_ROW_SEP (gradient_h, -1, 0, 1, 1, 1, 1, 0)
+F2D_DEFINE_ROW_SEP (gradient_v, 1, 1, 1, -1, 0, 1, 0)
+F2D_DEFINE_ROW_SEP (sobel_h, 1, 0, -1, 1, 2, 1, 0)
+F2D_DEFINE_ROW_SEP (sobel_v, 1, 2, 1, 1, 0, -1, 0)
+
+const struct f2d_sw_kernel f2d_sw_presets[FILTER2D_PRESET_CNT] = {
+  [FILTER2D_PRESET_BLUR] = {"blur (separable)", {1, 1, 1, 1, -7, 1, 1, 1, 1}, f2d_row_blur},
+  [FILTER2D_PRESET_EDGE] = {"edge", {0, 1, 0, 1, -4, 1, 0, 1, 0}, f2d_row_edge},
+  [FILTER2D_PRESET_EDGE_H] =
+      {"edge_h", {0, -1, 0, 0, 2, 0, 0, -1, 0}, f2d_row_edge_h},
+  [FILTER2D_PRESET_EDGE_V] =
+      {"edge_v", {0, 0, 0, -1, 2, -1, 0, 0, 0}, f2d_row_edge_v},
+  [FILTER2D_PRESET_EMBOSS] =
+      {"emboss", {-2, -1, 0, -1, 1, 1, 0, 1, 2}, f2d_row_emboss},
+  [FILTER2D_PRESET_GRADIENT_H] =
+      {"gradient_h (separable)", {-1, -1, -1, 0, 0, 0, 1, 1, 1},
+      f2d_row_gradient_h},
+  [FILTER2D_PRESET_GRADIENT_V] =
+      {"gradient_v (separable)", {-1, 0, 1, -1, 0, 1, -1, 0, 1},
+      f2d_row_gradient_v},
+  [FILTER2D_PRESET_IDENTITY] =
+      {"identity (copy)", {0, 0, 0, 0, 1, 0, 0, 0, 0}, f2d_row_identity},
+  [FILTER2D_PRESET_SHARPEN] =
+      {"sharpen", {0, -1, 0, -1, 5, -1, 0, -1, 0}, f2d_row_sharpen},
+  [FILTER2D_PRESET_SOBEL_H] =
+      {"sobel_h (separable)", {1, 2, 1, 0, 0, 0, -1, -2, -1}, f2d_row_sobel_h},
+  [FILTER2D_PRESET_SOBEL_V] =
+      {"sobel_v (separable)", {1, 0, -1, 2, 0, -2, 1, 0, -1}, f2d_row_sobel_v},
+};
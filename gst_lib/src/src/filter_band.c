@@ -0,0 +1,304 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdlib.h>
+#include <glib.h>
+
+#include "filter_band.h"
+
+/*
+ * Persistent pool of worker threads splitting a frame into horizontal
+ * bands. Workers are created once, pinned to the CPUs of the mask and
+ * parked on a condition variable between frames. filter_band_pool_run()
+ * acts as the per frame barrier: it publishes a new generation and waits
+ * until every worker has finished its band.
+ *
+ * Bands only partition the output rows, the input frame stays shared and
+ * read-only so a band reads the rows above and below it (the 1-row halo)
+ * directly from the source.
+ */
+
+struct filter_band_worker
+{
+  struct filter_band_pool *pool;
+  GThread *thread;
+  unsigned int index;
+  int cpu;
+};
+
+struct filter_band_pool
+{
+  struct filter_band_worker *workers;
+  unsigned int num_workers;
+  /* one frame at a time, held for the whole of filter_band_pool_run() */
+  GMutex run_lock;
+  GMutex lock;
+  GCond start;
+  GCond done;
+  uint64_t generation;
+  unsigned int pending;
+  int quit;
+
+  /* current job */
+  filter_band_fn fn;
+  void *priv;
+  int height;
+};
+
+static void
+filter_band_pin (int cpu)
+{
+  cpu_set_t set;
+
+  if (cpu < 0)
+    return;
+
+  CPU_ZERO (&set);
+  CPU_SET (cpu, &set);
+  if (sched_setaffinity (0, sizeof set, &set))
+    g_warning ("failed to pin filter worker to cpu %d", cpu);
+}
+
+static gpointer
+filter_band_thread (gpointer data)
+{
+  struct filter_band_worker *w = data;
+  struct filter_band_pool *pool = w->pool;
+  uint64_t seen = 0;
+
+  filter_band_pin (w->cpu);
+
+  g_mutex_lock (&pool->lock);
+  for (;;) {
+    filter_band_fn fn;
+    void *priv;
+    int y_start, y_end;
+
+    while (pool->generation == seen && !pool->quit)
+      g_cond_wait (&pool->start, &pool->lock);
+    if (pool->quit)
+      break;
+
+    seen = pool->generation;
+    fn = pool->fn;
+    priv = pool->priv;
+    y_start = (int) ((int64_t) pool->height * w->index / pool->num_workers);
+    y_end = (int) ((int64_t) pool->height * (w->index + 1) / pool->num_workers);
+    g_mutex_unlock (&pool->lock);
+
+    if (y_end > y_start)
+      fn (priv, y_start, y_end);
+
+    g_mutex_lock (&pool->lock);
+    if (--pool->pending == 0)
+      g_cond_signal (&pool->done);
+  }
+  g_mutex_unlock (&pool->lock);
+
+  return NULL;
+}
+
+/* CPUs the calling process is allowed to run on */
+static uint64_t
+filter_band_allowed_cpus (void)
+{
+  cpu_set_t set;
+  uint64_t mask = 0;
+  int cpu;
+
+  if (sched_getaffinity (0, sizeof set, &set))
+    return 0;
+
+  for (cpu = 0; cpu < 64; cpu++) {
+    if (CPU_ISSET (cpu, &set))
+      mask |= (uint64_t) 1 << cpu;
+  }
+
+  return mask;
+}
+
+/* CPU of the n-th set bit of mask, wrapping around, -1 for no pinning */
+static int
+filter_band_cpu (uint64_t mask, unsigned int n)
+{
+  unsigned int bits = __builtin_popcountll (mask);
+  int cpu;
+
+  if (!bits)
+    return -1;
+
+  n %= bits;
+  for (cpu = 0; cpu < 64; cpu++) {
+    if ((mask >> cpu) & 1) {
+      if (!n--)
+        return cpu;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * filter_band_default_workers - worker count used when none is configured
+ *
+ * Return: number of online CPUs minus one, leaving a core for the
+ * streaming threads, but at least one.
+ */
+unsigned int
+filter_band_default_workers (void)
+{
+  unsigned int n = g_get_num_processors ();
+
+  return n > 1 ? n - 1 : 1;
+}
+
+/**
+ * filter_band_pool_new - create a pool of pinned band workers
+ * @num_workers: Number of worker threads, 0 for the default
+ * @cpu_mask: CPUs the workers are pinned to round-robin, 0 for all CPUs the
+ *            process may run on
+ *
+ * Return: pool on success, NULL otherwise.
+ */
+struct filter_band_pool *
+filter_band_pool_new (unsigned int num_workers, uint64_t cpu_mask)
+{
+  struct filter_band_pool *pool;
+  unsigned int i;
+
+  if (!num_workers)
+    num_workers = filter_band_default_workers ();
+
+  if (!cpu_mask)
+    cpu_mask = filter_band_allowed_cpus ();
+
+  pool = calloc (1, sizeof *pool);
+  if (!pool)
+    return NULL;
+
+  pool->workers = calloc (num_workers, sizeof *pool->workers);
+  if (!pool->workers) {
+    free (pool);
+    return NULL;
+  }
+
+  g_mutex_init (&pool->run_lock);
+  g_mutex_init (&pool->lock);
+  g_cond_init (&pool->start);
+  g_cond_init (&pool->done);
+  pool->num_workers = num_workers;
+
+  for (i = 0; i < num_workers; i++) {
+    struct filter_band_worker *w = &pool->workers[i];
+
+    w->pool = pool;
+    w->index = i;
+    w->cpu = filter_band_cpu (cpu_mask, i);
+    w->thread = g_thread_new ("filter-band", filter_band_thread, w);
+  }
+
+  return pool;
+}
+
+/**
+ * filter_band_pool_free - stop and join all workers
+ * @pool: Pool to free, may be NULL
+ */
+void
+filter_band_pool_free (struct filter_band_pool *pool)
+{
+  unsigned int i;
+
+  if (!pool)
+    return;
+
+  /* let a frame still in flight complete */
+  g_mutex_lock (&pool->run_lock);
+  g_mutex_lock (&pool->lock);
+  pool->quit = 1;
+  g_cond_broadcast (&pool->start);
+  g_mutex_unlock (&pool->lock);
+
+  for (i = 0; i < pool->num_workers; i++)
+    g_thread_join (pool->workers[i].thread);
+  g_mutex_unlock (&pool->run_lock);
+
+  g_cond_clear (&pool->done);
+  g_cond_clear (&pool->start);
+  g_mutex_clear (&pool->lock);
+  g_mutex_clear (&pool->run_lock);
+  free (pool->workers);
+  free (pool);
+}
+
+/**
+ * filter_band_pool_run - process one frame on all workers
+ * @pool: Band pool
+ * @fn: Band function, called once per worker with its row range
+ * @priv: Private data passed to @fn
+ * @height: Number of output rows of the frame
+ *
+ * Returns once every band of the frame has been processed. Concurrent
+ * callers are serialized, each frame runs on all workers in turn.
+ */
+void
+filter_band_pool_run (struct filter_band_pool *pool, filter_band_fn fn,
+    void *priv, int height)
+{
+  g_mutex_lock (&pool->run_lock);
+  g_mutex_lock (&pool->lock);
+  pool->fn = fn;
+  pool->priv = priv;
+  pool->height = height;
+  pool->pending = pool->num_workers;
+  pool->generation++;
+  g_cond_broadcast (&pool->start);
+  while (pool->pending)
+    g_cond_wait (&pool->done, &pool->lock);
+  g_mutex_unlock (&pool->lock);
+  g_mutex_unlock (&pool->run_lock);
+}
+
+unsigned int
+filter_band_pool_get_workers (const struct filter_band_pool *pool)
+{
+  return pool ? pool->num_workers : 0;
+}
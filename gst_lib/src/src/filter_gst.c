@@ -41,6 +41,8 @@
 #include <unistd.h>
 
 #include "filter.h"
+#include "filter2d_sw.h"
+#include "optical_flow_sw.h"
 #include "helper.h"
 
 static const char *f2d_modes_gst[] = {
@@ -53,7 +55,7 @@ const static struct filter_s f2d_FS_gst = {
   .dt_comp_string = "sdxfilter2d",
   .fd = -1,
   .mode = 0,
-  .ops = NULL,
+  .ops = &filter2d_sw_ops,
   .data = NULL,
   .num_modes = ARRAY_SIZE (f2d_modes_gst),
   .modes = f2d_modes_gst,
@@ -69,6 +71,7 @@ filter2d_create_gst (void)
 
 static const char *of_modes_gst[] = {
   "HW",
+  "SW",
 };
 
 const static struct filter_s of_FS_gst = {
@@ -76,7 +79,7 @@ const static struct filter_s of_FS_gst = {
   .dt_comp_string = "sdxopticalflow",
   .fd = -1,
   .mode = 0,
-  .ops = NULL,
+  .ops = &optical_flow_sw_ops,
   .data = NULL,
   .num_modes = ARRAY_SIZE (of_modes_gst),
   .modes = of_modes_gst,
@@ -0,0 +1,635 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <linux/videodev2.h>
+
+#include "vgst_lib.h"
+#include "optical_flow_sw.h"
+#include "filter_band.h"
+
+/*
+ * Dense pyramidal Lucas-Kanade. The luma of both frames is averaged down
+ * to at most OF_SW_MAX_WIDTH pixels and a pyramid is built from there.
+ * Starting at the coarsest level every pixel solves the 2x2 normal
+ * equations over a (2 * OF_SW_RADIUS + 1)^2 window, the flow is refined
+ * OF_SW_ITERS times against the current frame warped by the previous
+ * estimate and handed down to the next level.
+ *
+ * Every stage is a pass over whole rows of float images, split into
+ * bands for the worker pool. The inner loops have no branches and no
+ * loop carried dependencies so the compiler vectorizes them; the warp
+ * with its bilinear gather is the only scalar loop.
+ */
+#define OF_SW_MAX_WIDTH		960
+#define OF_SW_LEVELS		4
+#define OF_SW_MIN_SIZE		16
+#define OF_SW_RADIUS		3
+#define OF_SW_ITERS		3
+/* Smallest determinant of the structure tensor that gets a flow update */
+#define OF_SW_MIN_DET		1.0f
+/* Largest flow update per iteration in pixels */
+#define OF_SW_MAX_STEP		2.0f
+/* Chroma units per pixel of motion in the rendered output */
+#define OF_SW_GAIN		16.0f
+
+struct of_sw_level
+{
+  int width;
+  int height;
+  float *i0;                    /* previous frame */
+  float *i1;                    /* current frame */
+  float *u;                     /* horizontal flow */
+  float *v;                     /* vertical flow */
+};
+
+struct of_sw_data
+{
+  int width;
+  int height;
+  /* input pixels per level 0 pixel in each direction */
+  int scale;
+  int levels;
+  struct of_sw_level lv[OF_SW_LEVELS];
+  /* per level scratch, sized for level 0 */
+  float *ix;
+  float *iy;
+  float *it;
+  float *sxx;
+  float *sxy;
+  float *syy;
+  struct filter_band_pool *pool;
+  unsigned int num_workers;
+  uint64_t cpu_mask;
+};
+
+/* One stage of a frame as seen by the band workers */
+struct of_sw_job
+{
+  struct of_sw_data *d;
+  int level;
+  const unsigned short *prev;
+  const unsigned short *curr;
+  unsigned short *out;
+  int stride_in;
+  int width_out;
+  int stride_out;
+};
+
+static inline int
+of_clampi (int v, int lo, int hi)
+{
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static inline float
+of_clampf (float v, float lo, float hi)
+{
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static void
+of_run (struct of_sw_job *job, filter_band_fn fn, int height)
+{
+  if (job->d->pool)
+    filter_band_pool_run (job->d->pool, fn, job, height);
+  else
+    fn (job, 0, height);
+}
+
+/* Level 0 luma of both frames, scale x scale input pixels averaged */
+static void
+of_stage_luma (void *priv, int y_start, int y_end)
+{
+  const struct of_sw_job *job = priv;
+  const struct of_sw_level *lv = &job->d->lv[0];
+  int s = job->d->scale;
+  float norm = 1.0f / (s * s);
+  int x, y, i, j;
+
+  for (y = y_start; y < y_end; y++) {
+    float *d0 = lv->i0 + y * lv->width;
+    float *d1 = lv->i1 + y * lv->width;
+
+    for (x = 0; x < lv->width; x++) {
+      int a0 = 0, a1 = 0;
+
+      for (i = 0; i < s; i++) {
+        const unsigned short *p0 = job->prev + (y * s + i) * job->stride_in;
+        const unsigned short *p1 = job->curr + (y * s + i) * job->stride_in;
+
+        for (j = 0; j < s; j++) {
+          a0 += p0[x * s + j] & 0xff;
+          a1 += p1[x * s + j] & 0xff;
+        }
+      }
+      d0[x] = a0 * norm;
+      d1[x] = a1 * norm;
+    }
+  }
+}
+
+/* [1 2 1] x [1 2 1] / 16 around every second pixel of the finer level, so
+ * fine texture does not alias into the coarse levels */
+static inline float
+of_down_px (const float *src, int w, int ya, int yb, int yc, int x)
+{
+  int xa = of_clampi (2 * x - 1, 0, w - 1);
+  int xb = 2 * x;
+  int xc = of_clampi (2 * x + 1, 0, w - 1);
+
+  return 0.0625f * (src[ya + xa] + 2.0f * src[ya + xb] + src[ya + xc] +
+      2.0f * (src[yb + xa] + 2.0f * src[yb + xb] + src[yb + xc]) +
+      src[yc + xa] + 2.0f * src[yc + xb] + src[yc + xc]);
+}
+
+static void
+of_stage_down (void *priv, int y_start, int y_end)
+{
+  const struct of_sw_job *job = priv;
+  const struct of_sw_level *src = &job->d->lv[job->level - 1];
+  const struct of_sw_level *dst = &job->d->lv[job->level];
+  int w = src->width;
+  int x, y;
+
+  for (y = y_start; y < y_end; y++) {
+    int ya = of_clampi (2 * y - 1, 0, src->height - 1) * w;
+    int yb = 2 * y * w;
+    int yc = of_clampi (2 * y + 1, 0, src->height - 1) * w;
+
+    for (x = 0; x < dst->width; x++) {
+      dst->i0[y * dst->width + x] = of_down_px (src->i0, w, ya, yb, yc, x);
+      dst->i1[y * dst->width + x] = of_down_px (src->i1, w, ya, yb, yc, x);
+    }
+  }
+}
+
+/* Central differences of the previous frame */
+static void
+of_stage_grad (void *priv, int y_start, int y_end)
+{
+  const struct of_sw_job *job = priv;
+  const struct of_sw_data *d = job->d;
+  const struct of_sw_level *lv = &d->lv[job->level];
+  int w = lv->width;
+  int x, y;
+
+  for (y = y_start; y < y_end; y++) {
+    const float *up = lv->i0 + of_clampi (y - 1, 0, lv->height - 1) * w;
+    const float *dn = lv->i0 + of_clampi (y + 1, 0, lv->height - 1) * w;
+    const float *row = lv->i0 + y * w;
+    float *restrict ix = d->ix + y * w;
+    float *restrict iy = d->iy + y * w;
+
+    for (x = 0; x < w; x++)
+      iy[x] = 0.5f * (dn[x] - up[x]);
+    ix[0] = row[w > 1 ? 1 : 0] - row[0];
+    for (x = 1; x < w - 1; x++)
+      ix[x] = 0.5f * (row[x + 1] - row[x - 1]);
+    if (w > 1)
+      ix[w - 1] = row[w - 1] - row[w - 2];
+  }
+}
+
+/*
+ * Window sums of a * b for row y: the column sums go to col with
+ * OF_SW_RADIUS replicated entries on either side, then the horizontal
+ * sum over 2 * OF_SW_RADIUS + 1 columns.
+ */
+static void
+of_box_row (const float *a, const float *b, float *restrict dst, int y,
+    int width, int height)
+{
+  float col[OF_SW_MAX_WIDTH + 2 * OF_SW_RADIUS];
+  float *restrict c = col + OF_SW_RADIUS;
+  int x, i;
+
+  for (x = 0; x < width; x++)
+    c[x] = 0.0f;
+  for (i = -OF_SW_RADIUS; i <= OF_SW_RADIUS; i++) {
+    int r = of_clampi (y + i, 0, height - 1) * width;
+
+    for (x = 0; x < width; x++)
+      c[x] += a[r + x] * b[r + x];
+  }
+  for (i = 1; i <= OF_SW_RADIUS; i++) {
+    c[-i] = c[0];
+    c[width - 1 + i] = c[width - 1];
+  }
+
+  for (x = 0; x < width; x++) {
+    float s = 0.0f;
+
+    for (i = -OF_SW_RADIUS; i <= OF_SW_RADIUS; i++)
+      s += c[x + i];
+    dst[x] = s;
+  }
+}
+
+/* Structure tensor, does not depend on the flow */
+static void
+of_stage_tensor (void *priv, int y_start, int y_end)
+{
+  const struct of_sw_job *job = priv;
+  const struct of_sw_data *d = job->d;
+  const struct of_sw_level *lv = &d->lv[job->level];
+  int w = lv->width;
+  int y;
+
+  for (y = y_start; y < y_end; y++) {
+    of_box_row (d->ix, d->ix, d->sxx + y * w, y, w, lv->height);
+    of_box_row (d->ix, d->iy, d->sxy + y * w, y, w, lv->height);
+    of_box_row (d->iy, d->iy, d->syy + y * w, y, w, lv->height);
+  }
+}
+
+/* Flow of the coarser level, doubled */
+static void
+of_stage_up (void *priv, int y_start, int y_end)
+{
+  const struct of_sw_job *job = priv;
+  const struct of_sw_level *src = &job->d->lv[job->level + 1];
+  const struct of_sw_level *dst = &job->d->lv[job->level];
+  int x, y;
+
+  for (y = y_start; y < y_end; y++) {
+    int ys = of_clampi (y / 2, 0, src->height - 1) * src->width;
+
+    for (x = 0; x < dst->width; x++) {
+      int xs = of_clampi (x / 2, 0, src->width - 1);
+
+      dst->u[y * dst->width + x] = 2.0f * src->u[ys + xs];
+      dst->v[y * dst->width + x] = 2.0f * src->v[ys + xs];
+    }
+  }
+}
+
+/* Temporal difference against the current frame warped by the flow */
+static void
+of_stage_warp (void *priv, int y_start, int y_end)
+{
+  const struct of_sw_job *job = priv;
+  const struct of_sw_data *d = job->d;
+  const struct of_sw_level *lv = &d->lv[job->level];
+  int w = lv->width;
+  float xmax = w - 1;
+  float ymax = lv->height - 1;
+  int x, y;
+
+  for (y = y_start; y < y_end; y++) {
+    for (x = 0; x < w; x++) {
+      int i = y * w + x;
+      float xs = of_clampf (x + lv->u[i], 0.0f, xmax);
+      float ys = of_clampf (y + lv->v[i], 0.0f, ymax);
+      int x0 = (int) xs;
+      int y0 = (int) ys;
+      int x1 = x0 < w - 1 ? x0 + 1 : x0;
+      int y1 = y0 < lv->height - 1 ? y0 + 1 : y0;
+      float fx = xs - x0;
+      float fy = ys - y0;
+      const float *r0 = lv->i1 + y0 * w;
+      const float *r1 = lv->i1 + y1 * w;
+      float top = r0[x0] + fx * (r0[x1] - r0[x0]);
+      float bot = r1[x0] + fx * (r1[x1] - r1[x0]);
+
+      d->it[i] = top + fy * (bot - top) - lv->i0[i];
+    }
+  }
+}
+
+/* Solve the 2x2 normal equations of every pixel and update the flow */
+static void
+of_stage_solve (void *priv, int y_start, int y_end)
+{
+  const struct of_sw_job *job = priv;
+  const struct of_sw_data *d = job->d;
+  const struct of_sw_level *lv = &d->lv[job->level];
+  float bx[OF_SW_MAX_WIDTH];
+  float by[OF_SW_MAX_WIDTH];
+  int w = lv->width;
+  int x, y;
+
+  for (y = y_start; y < y_end; y++) {
+    const float *sxx = d->sxx + y * w;
+    const float *sxy = d->sxy + y * w;
+    const float *syy = d->syy + y * w;
+    float *restrict u = lv->u + y * w;
+    float *restrict v = lv->v + y * w;
+
+    of_box_row (d->ix, d->it, bx, y, w, lv->height);
+    of_box_row (d->iy, d->it, by, y, w, lv->height);
+
+    for (x = 0; x < w; x++) {
+      float det = sxx[x] * syy[x] - sxy[x] * sxy[x];
+      float inv = det > OF_SW_MIN_DET ? 1.0f / det : 0.0f;
+      float du = (sxy[x] * by[x] - syy[x] * bx[x]) * inv;
+      float dv = (sxy[x] * bx[x] - sxx[x] * by[x]) * inv;
+
+      u[x] += of_clampf (du, -OF_SW_MAX_STEP, OF_SW_MAX_STEP);
+      v[x] += of_clampf (dv, -OF_SW_MAX_STEP, OF_SW_MAX_STEP);
+    }
+  }
+}
+
+/* Level 0 flow into YUYV, in input pixels, one chroma pair per two pixels */
+static void
+of_stage_render (void *priv, int y_start, int y_end)
+{
+  const struct of_sw_job *job = priv;
+  const struct of_sw_data *d = job->d;
+  const struct of_sw_level *lv = &d->lv[0];
+  int x, y;
+
+  for (y = y_start; y < y_end; y++) {
+    int yf = of_clampi (y / d->scale, 0, lv->height - 1) * lv->width;
+    unsigned short *dst = job->out + y * job->stride_out;
+
+    for (x = 0; x + 1 < job->width_out; x += 2) {
+      int xf = of_clampi (x / d->scale, 0, lv->width - 1);
+      float gain = OF_SW_GAIN * d->scale;
+      int cu = 128 + (int) of_clampf (lv->u[yf + xf] * gain, -128.0f, 127.0f);
+      int cv = 128 + (int) of_clampf (lv->v[yf + xf] * gain, -128.0f, 127.0f);
+
+      dst[x] = (cu << 8) | 128;
+      dst[x + 1] = (cv << 8) | 128;
+    }
+    if (x < job->width_out)
+      dst[x] = (128 << 8) | 128;
+  }
+}
+
+static void
+of_free_levels (struct of_sw_data *d)
+{
+  int l;
+
+  for (l = 0; l < OF_SW_LEVELS; l++) {
+    free (d->lv[l].i0);
+    free (d->lv[l].i1);
+    free (d->lv[l].u);
+    free (d->lv[l].v);
+  }
+  free (d->ix);
+  free (d->iy);
+  free (d->it);
+  free (d->sxx);
+  free (d->sxy);
+  free (d->syy);
+  memset (d->lv, 0, sizeof d->lv);
+  d->ix = d->iy = d->it = d->sxx = d->sxy = d->syy = NULL;
+  d->width = d->height = 0;
+}
+
+/* Size the pyramid for width x height input frames */
+static int
+of_alloc (struct of_sw_data *d, int width, int height)
+{
+  size_t n;
+  int l, w, h;
+
+  if (d->width == width && d->height == height)
+    return VLIB_SUCCESS;
+  of_free_levels (d);
+
+  d->scale = 1;
+  while (width / d->scale > OF_SW_MAX_WIDTH)
+    d->scale *= 2;
+  w = width / d->scale;
+  h = height / d->scale;
+  if (w < 1 || h < 1)
+    return VLIB_ERROR_INVALID_PARAM;
+
+  for (l = 0; l < OF_SW_LEVELS; l++) {
+    if (l && (w < OF_SW_MIN_SIZE || h < OF_SW_MIN_SIZE))
+      break;
+    n = (size_t) w * h;
+    d->lv[l].width = w;
+    d->lv[l].height = h;
+    d->lv[l].i0 = malloc (n * sizeof (float));
+    d->lv[l].i1 = malloc (n * sizeof (float));
+    d->lv[l].u = malloc (n * sizeof (float));
+    d->lv[l].v = malloc (n * sizeof (float));
+    if (!d->lv[l].i0 || !d->lv[l].i1 || !d->lv[l].u || !d->lv[l].v)
+      goto nomem;
+    w = (w + 1) / 2;
+    h = (h + 1) / 2;
+  }
+  d->levels = l;
+
+  n = (size_t) d->lv[0].width * d->lv[0].height * sizeof (float);
+  d->ix = malloc (n);
+  d->iy = malloc (n);
+  d->it = malloc (n);
+  d->sxx = malloc (n);
+  d->sxy = malloc (n);
+  d->syy = malloc (n);
+  if (!d->ix || !d->iy || !d->it || !d->sxx || !d->sxy || !d->syy)
+    goto nomem;
+
+  d->width = width;
+  d->height = height;
+  return VLIB_SUCCESS;
+
+nomem:
+  of_free_levels (d);
+  return VLIB_ERROR_NO_MEM;
+}
+
+static struct of_sw_data *
+of_get_data (struct filter_s *fs)
+{
+  if (!fs->data)
+    fs->data = calloc (1, sizeof (struct of_sw_data));
+
+  return fs->data;
+}
+
+/**
+ * optical_flow_sw_init - initialize the software optical flow engine
+ * @fs: Pointer to filter struct
+ * @data: Frame geometry and format the engine will be run with
+ *
+ * Return: 0 on success, error code otherwise.
+ */
+int
+optical_flow_sw_init (struct filter_s *fs, const struct filter_init_data *data)
+{
+  struct of_sw_data *d;
+  unsigned int num_workers;
+
+  if (!fs || !data)
+    return VLIB_ERROR_INVALID_PARAM;
+
+  if (data->in_fourcc != V4L2_PIX_FMT_YUYV ||
+      data->out_fourcc != V4L2_PIX_FMT_YUYV)
+    return VLIB_ERROR_NOT_SUPPORTED;
+
+  d = of_get_data (fs);
+  if (!d)
+    return VLIB_ERROR_NO_MEM;
+
+  num_workers = data->num_workers ? data->num_workers :
+      filter_band_default_workers ();
+  if (d->pool && (d->num_workers != num_workers ||
+          d->cpu_mask != data->cpu_mask)) {
+    filter_band_pool_free (d->pool);
+    d->pool = NULL;
+  }
+  d->num_workers = num_workers;
+  d->cpu_mask = data->cpu_mask;
+  if (!d->pool && num_workers > 1) {
+    d->pool = filter_band_pool_new (num_workers, data->cpu_mask);
+    if (!d->pool)
+      return VLIB_ERROR_NO_MEM;
+  }
+
+  return of_alloc (d, data->in_width, data->in_height);
+}
+
+/**
+ * optical_flow_sw_func2 - compute the flow between two YUYV frames
+ * @fs: Pointer to filter struct
+ * @frame_prev: Previous input frame
+ * @frame_curr: Current input frame
+ * @frame_out: Output frame receiving the rendered flow
+ * @height_in: Input height in lines
+ * @width_in: Input width in pixels
+ * @stride_in: Input stride in pixels, same for both input frames
+ * @height_out: Output height in lines
+ * @width_out: Output width in pixels
+ * @stride_out: Output stride in pixels
+ *
+ * Input frames wider than OF_SW_MAX_WIDTH are averaged down by a power of
+ * two first, the flow is scaled back to input pixels when rendered.
+ */
+void
+optical_flow_sw_func2 (struct filter_s *fs,
+    unsigned short *frame_prev, unsigned short *frame_curr,
+    unsigned short *frame_out, int height_in, int width_in, int stride_in,
+    int height_out, int width_out, int stride_out)
+{
+  struct of_sw_data *d;
+  struct of_sw_job job;
+  int l, i;
+
+  if (!fs || width_in <= 0 || height_in <= 0)
+    return;
+
+  d = of_get_data (fs);
+  if (!d || of_alloc (d, width_in, height_in))
+    return;
+
+  job.d = d;
+  job.prev = frame_prev;
+  job.curr = frame_curr;
+  job.out = frame_out;
+  job.stride_in = stride_in;
+  job.width_out = width_out;
+  job.stride_out = stride_out;
+
+  job.level = 0;
+  of_run (&job, of_stage_luma, d->lv[0].height);
+  for (l = 1; l < d->levels; l++) {
+    job.level = l;
+    of_run (&job, of_stage_down, d->lv[l].height);
+  }
+
+  for (l = d->levels - 1; l >= 0; l--) {
+    struct of_sw_level *lv = &d->lv[l];
+
+    job.level = l;
+    if (l == d->levels - 1) {
+      memset (lv->u, 0, (size_t) lv->width * lv->height * sizeof (float));
+      memset (lv->v, 0, (size_t) lv->width * lv->height * sizeof (float));
+    } else {
+      of_run (&job, of_stage_up, lv->height);
+    }
+    of_run (&job, of_stage_grad, lv->height);
+    of_run (&job, of_stage_tensor, lv->height);
+    for (i = 0; i < OF_SW_ITERS; i++) {
+      of_run (&job, of_stage_warp, lv->height);
+      of_run (&job, of_stage_solve, lv->height);
+    }
+  }
+
+  of_run (&job, of_stage_render, height_out);
+}
+
+/**
+ * optical_flow_sw_deinit - release the engine state attached to a filter
+ * @fs: Pointer to filter struct
+ */
+void
+optical_flow_sw_deinit (struct filter_s *fs)
+{
+  struct of_sw_data *d;
+
+  if (!fs)
+    return;
+
+  d = fs->data;
+  if (d) {
+    filter_band_pool_free (d->pool);
+    of_free_levels (d);
+  }
+  free (d);
+  fs->data = NULL;
+}
+
+/**
+ * optical_flow_sw_get_scale - input pixels per flow pixel
+ * @fs: Pointer to filter struct
+ *
+ * Return: 1, 2, 4, ... once the engine saw its first frame, 0 before
+ */
+int
+optical_flow_sw_get_scale (struct filter_s *fs)
+{
+  struct of_sw_data *d = fs ? fs->data : NULL;
+
+  return d && d->width ? d->scale : 0;
+}
+
+struct filter_ops optical_flow_sw_ops = {
+  .init = optical_flow_sw_init,
+  .func = NULL,
+  .func2 = optical_flow_sw_func2,
+  .deinit = optical_flow_sw_deinit,
+};
@@ -0,0 +1,213 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/sockios.h>
+#include <gio/gio.h>
+#include "vgst_abr.h"
+#include "vgst_bitrate.h"
+GST_DEBUG_CATEGORY_EXTERN (vgst_lib);
+#define GST_CAT_DEFAULT vgst_lib
+
+/*
+ * AIMD rate control for the udpsink path. A worker samples the socket send
+ * queue (SIOCOUTQ) and the bytes udpsink could not send every
+ * VGST_ABR_PERIOD_MS, and once per GOP (as seen by the encoder output
+ * probe) feeds the worst of it to vgst_abr_decide. The decision has a dead
+ * band between the low and high queue marks and needs several clear GOPs
+ * before probing upwards, so the rate does not oscillate around the link
+ * capacity.
+ */
+typedef struct
+_abr_ctrl {
+    GThread          *thread;
+    GMutex           lock;
+    GCond            cond;
+    gboolean         stop;
+    guint            index;
+    GstElement       *enc;
+    GstElement       *sink;
+    vgst_abr_state   state;
+} abr_ctrl;
+
+static gboolean abr_enabled;
+static abr_ctrl ctrls[MAX_SRC_NUM];
+
+
+guint
+vgst_abr_decide (vgst_abr_state *state, const vgst_abr_sample *sample) {
+    guint target = state->target_kbps;
+
+    if (sample->queue_pct >= VGST_ABR_QUEUE_HIGH || sample->unsent_bytes) {
+      /* back off from what actually went out if the encoder undershot */
+      if (sample->measured_kbps && sample->measured_kbps < target)
+        target = sample->measured_kbps;
+      target = (guint64) target * VGST_ABR_DECREASE / 100;
+      state->clear_gops = 0;
+    } else if (sample->queue_pct <= VGST_ABR_QUEUE_LOW) {
+      /* only probe upwards while the encoder is using its budget */
+      if (++state->clear_gops >= VGST_ABR_CLEAR_GOPS &&
+          (!sample->measured_kbps || sample->measured_kbps * 10 >= target * 8))
+        target += MAX (state->max_kbps * VGST_ABR_INCREASE / 100, 1);
+    } else {
+      state->clear_gops = 0;
+    }
+
+    state->target_kbps = CLAMP (target, state->min_kbps, state->max_kbps);
+    return state->target_kbps;
+}
+
+
+void
+set_abr (gboolean enable) {
+    abr_enabled = enable;
+}
+
+
+/* send queue fill in % of the socket send buffer */
+static guint
+abr_queue_pct (GstElement *sink) {
+    GSocket *socket = NULL;
+    gint fd, outq = 0, sndbuf = 0;
+    socklen_t len = sizeof (sndbuf);
+    guint pct = 0;
+
+    g_object_get (G_OBJECT (sink), "used-socket", &socket, NULL);
+    if (!socket)
+      return 0;
+    fd = g_socket_get_fd (socket);
+    if (!ioctl (fd, SIOCOUTQ, &outq) && !getsockopt (fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, &len) && sndbuf > 0)
+      pct = MIN ((guint64) outq * 100 / sndbuf, 100);
+    g_object_unref (socket);
+    return pct;
+}
+
+
+static guint64
+abr_unsent_bytes (GstElement *sink) {
+    guint64 to_serve = 0, served = 0;
+    g_object_get (G_OBJECT (sink), "bytes-to-serve", &to_serve, "bytes-served", &served, NULL);
+    return to_serve > served ? to_serve - served : 0;
+}
+
+
+static gpointer
+abr_thread (gpointer data) {
+    abr_ctrl *ctrl = (abr_ctrl *)data;
+    vgst_abr_sample sample = { 0 };
+    vgst_bitrate_stats stats;
+    guint64 last_gop = 0, last_unsent = 0, unsent;
+    gint64 last_decision = g_get_monotonic_time ();
+    gint64 wake;
+    guint target;
+
+    g_mutex_lock (&ctrl->lock);
+    while (!ctrl->stop) {
+      wake = g_get_monotonic_time () + VGST_ABR_PERIOD_MS * G_TIME_SPAN_MILLISECOND;
+      if (g_cond_wait_until (&ctrl->cond, &ctrl->lock, wake) || ctrl->stop)
+        continue;
+      g_mutex_unlock (&ctrl->lock);
+
+      sample.queue_pct = MAX (sample.queue_pct, abr_queue_pct (ctrl->sink));
+      get_bitrate_stats (ctrl->index, &stats);
+      if (stats.gop_count != last_gop ||
+          g_get_monotonic_time () - last_decision >= VGST_ABR_FALLBACK_MS * G_TIME_SPAN_MILLISECOND) {
+        unsent = abr_unsent_bytes (ctrl->sink);
+        sample.unsent_bytes = unsent > last_unsent ? unsent - last_unsent : 0;
+        sample.measured_kbps = stats.window_bps / 1000;
+        last_unsent = unsent;
+        last_gop = stats.gop_count;
+        last_decision = g_get_monotonic_time ();
+
+        target = ctrl->state.target_kbps;
+        if (vgst_abr_decide (&ctrl->state, &sample) != target) {
+          GST_INFO ("pipeline %u: target-bitrate %u -> %u kbps (queue %u%%, unsent %" G_GUINT64_FORMAT " bytes, output %u kbps)",
+                    ctrl->index, target, ctrl->state.target_kbps, sample.queue_pct, sample.unsent_bytes, sample.measured_kbps);
+          g_object_set (G_OBJECT (ctrl->enc), "target-bitrate", ctrl->state.target_kbps, NULL);
+        }
+        memset (&sample, 0, sizeof (sample));
+      }
+      g_mutex_lock (&ctrl->lock);
+    }
+    g_mutex_unlock (&ctrl->lock);
+    return NULL;
+}
+
+
+void
+vgst_abr_attach (vgst_playback *play_ptr, guint index, vgst_enc_params *enc_param) {
+    abr_ctrl *ctrl;
+    guint max = enc_param->enc_type == HEVC ? MAX_H265_BITRATE : MAX_H264_BITRATE;
+
+    if (!abr_enabled || index >= MAX_SRC_NUM || !play_ptr->stream_sink || !play_ptr->videoenc)
+      return;
+    vgst_abr_detach (index);
+    ctrl = &ctrls[index];
+    ctrl->index = index;
+    ctrl->stop = FALSE;
+    ctrl->enc = gst_object_ref (play_ptr->videoenc);
+    ctrl->sink = gst_object_ref (play_ptr->stream_sink);
+    /* the configured bitrate is the ceiling, udpsink max-bitrate is set from it too */
+    ctrl->state.max_kbps = MIN (enc_param->bitrate, max);
+    ctrl->state.min_kbps = MIN (VGST_ABR_MIN_KBPS, ctrl->state.max_kbps);
+    ctrl->state.target_kbps = ctrl->state.max_kbps;
+    ctrl->state.clear_gops = 0;
+    g_object_set (G_OBJECT (ctrl->enc), "target-bitrate", ctrl->state.target_kbps, NULL);
+    ctrl->thread = g_thread_new ("vgst-abr", abr_thread, ctrl);
+}
+
+
+void
+vgst_abr_detach (guint index) {
+    abr_ctrl *ctrl;
+
+    if (index >= MAX_SRC_NUM || !ctrls[index].thread)
+      return;
+    ctrl = &ctrls[index];
+    g_mutex_lock (&ctrl->lock);
+    ctrl->stop = TRUE;
+    g_cond_signal (&ctrl->cond);
+    g_mutex_unlock (&ctrl->lock);
+    g_thread_join (ctrl->thread);
+    ctrl->thread = NULL;
+    gst_object_unref (ctrl->enc);
+    gst_object_unref (ctrl->sink);
+    ctrl->enc = NULL;
+    ctrl->sink = NULL;
+}
@@ -0,0 +1,407 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+#include "vgst_bitrate.h"
+GST_DEBUG_CATEGORY_EXTERN (vgst_lib);
+#define GST_CAT_DEFAULT vgst_lib
+
+/*
+ * The probe on the encoder capsfilter walks the byte-stream NAL units of
+ * every buffer, so it works for both au and nal (sub-frame) alignment. A
+ * new frame starts at the first slice of a picture; parameter sets and SEI
+ * in front of it are counted towards that frame. The picture type comes
+ * from the slice_type of the first slice.
+ */
+typedef enum {
+    CODEC_NONE,
+    CODEC_H264,
+    CODEC_H265,
+} bitrate_codec;
+
+typedef struct
+_nal_reader {
+    const guint8   *data;
+    gsize          size;
+    gsize          pos;
+    guint          bit;
+    guint          zeros;
+} nal_reader;
+
+typedef struct
+_bitrate_frame {
+    GstClockTime   ts;
+    guint          bytes;
+} bitrate_frame;
+
+typedef struct
+_bitrate_data {
+    bitrate_codec          codec;
+    guint8                 h265_extra_bits[64];
+    /* frame being assembled */
+    gboolean               in_frame;
+    VGST_FRAME_TYPE        type;
+    guint                  bytes;
+    guint                  prefix_bytes;
+    GstClockTime           ts;
+    /* finished frames */
+    bitrate_frame          frames[VGST_BITRATE_FRAMES];
+    guint                  next;
+    GstClockTime           last_ts;
+    GstClockTime           gop_start;
+    guint                  gop_frames;
+    guint                  gop_bytes;
+    vgst_bitrate_stats     stats;
+} bitrate_data;
+
+typedef struct
+_bitrate_source {
+    GMutex         lock;
+    bitrate_data   d;
+} bitrate_source;
+
+static bitrate_source sources[MAX_SRC_NUM];
+
+
+/* reads the RBSP, dropping emulation prevention bytes */
+static gboolean
+nal_read_bits (nal_reader *r, guint n, guint32 *val) {
+    *val = 0;
+    while (n--) {
+      if (r->bit == 0) {
+        if (r->pos >= r->size)
+          return FALSE;
+        if (r->zeros >= 2 && r->data[r->pos] == 0x03) {
+          r->zeros = 0;
+          if (++r->pos >= r->size)
+            return FALSE;
+        }
+      }
+      *val = (*val << 1) | ((r->data[r->pos] >> (7 - r->bit)) & 1);
+      if (++r->bit == 8) {
+        r->zeros = r->data[r->pos] ? 0 : r->zeros + 1;
+        r->bit = 0;
+        r->pos++;
+      }
+    }
+    return TRUE;
+}
+
+
+static gboolean
+nal_read_ue (nal_reader *r, guint32 *val) {
+    guint32 bit, suffix;
+    guint lz = 0;
+    do {
+      if (!nal_read_bits (r, 1, &bit))
+        return FALSE;
+    } while (!bit && ++lz < 32);
+    if (lz >= 32 || !nal_read_bits (r, lz, &suffix))
+      return FALSE;
+    *val = (1u << lz) - 1 + suffix;
+    return TRUE;
+}
+
+
+static void
+nal_reader_init (nal_reader *r, const guint8 *data, gsize size) {
+    memset (r, 0, sizeof (*r));
+    r->data = data;
+    r->size = size;
+}
+
+
+/* returns TRUE for the first slice of a picture, type is set from its slice_type */
+static gboolean
+parse_h264_slice (const guint8 *nal, gsize size, VGST_FRAME_TYPE *type) {
+    static const VGST_FRAME_TYPE types[5] = { VGST_FRAME_P, VGST_FRAME_B, VGST_FRAME_I, VGST_FRAME_P, VGST_FRAME_I };
+    nal_reader r;
+    guint32 first_mb, slice_type;
+
+    nal_reader_init (&r, nal + 1, size - 1);
+    if (!nal_read_ue (&r, &first_mb) || first_mb != 0)
+      return FALSE;
+    if (!nal_read_ue (&r, &slice_type) || slice_type > 9)
+      *type = (nal[0] & 0x1f) == 5 ? VGST_FRAME_I : VGST_FRAME_P;
+    else
+      *type = types[slice_type % 5];
+    return TRUE;
+}
+
+
+static void
+parse_h265_pps (bitrate_data *d, const guint8 *nal, gsize size) {
+    nal_reader r;
+    guint32 pps_id, sps_id, flags, extra;
+
+    nal_reader_init (&r, nal + 2, size - 2);
+    if (nal_read_ue (&r, &pps_id) && pps_id < G_N_ELEMENTS (d->h265_extra_bits) &&
+        nal_read_ue (&r, &sps_id) && nal_read_bits (&r, 2, &flags) && nal_read_bits (&r, 3, &extra))
+      d->h265_extra_bits[pps_id] = extra;
+}
+
+
+static gboolean
+parse_h265_slice (bitrate_data *d, const guint8 *nal, gsize size, VGST_FRAME_TYPE *type) {
+    static const VGST_FRAME_TYPE types[3] = { VGST_FRAME_B, VGST_FRAME_P, VGST_FRAME_I };
+    guint nal_type = (nal[0] >> 1) & 0x3f;
+    gboolean irap = nal_type >= 16 && nal_type <= 23;
+    nal_reader r;
+    guint32 first, skip, pps_id, slice_type;
+
+    nal_reader_init (&r, nal + 2, size - 2);
+    if (!nal_read_bits (&r, 1, &first) || !first)
+      return FALSE;
+    if ((irap && !nal_read_bits (&r, 1, &skip)) || !nal_read_ue (&r, &pps_id) ||
+        pps_id >= G_N_ELEMENTS (d->h265_extra_bits) ||
+        (d->h265_extra_bits[pps_id] && !nal_read_bits (&r, d->h265_extra_bits[pps_id], &skip)) ||
+        !nal_read_ue (&r, &slice_type) || slice_type > 2)
+      *type = irap ? VGST_FRAME_I : VGST_FRAME_P;
+    else
+      *type = types[slice_type];
+    return TRUE;
+}
+
+
+static void
+bitrate_frame_done (bitrate_data *d) {
+    vgst_bitrate_stats *stats = &d->stats;
+    vgst_frame_size_stats *fs = &stats->frame[d->type];
+    GstClockTime ts = d->ts;
+
+    stats->frames++;
+    stats->bytes += d->bytes;
+    if (!fs->count || d->bytes < fs->min_bytes)
+      fs->min_bytes = d->bytes;
+    if (d->bytes > fs->max_bytes)
+      fs->max_bytes = d->bytes;
+    fs->count++;
+    fs->bytes += d->bytes;
+
+    if (GST_CLOCK_TIME_IS_VALID (ts)) {
+      if (GST_CLOCK_TIME_IS_VALID (d->last_ts) && ts > d->last_ts)
+        stats->inst_bps = gst_util_uint64_scale (d->bytes * 8, GST_SECOND, ts - d->last_ts);
+      d->frames[d->next++ & (VGST_BITRATE_FRAMES - 1)] = (bitrate_frame) { ts, d->bytes };
+      d->last_ts = ts;
+    }
+
+    if (d->type == VGST_FRAME_I) {
+      if (d->gop_frames && GST_CLOCK_TIME_IS_VALID (d->gop_start) && GST_CLOCK_TIME_IS_VALID (ts) && ts > d->gop_start) {
+        stats->gop_count++;
+        stats->gop_length = d->gop_frames;
+        stats->gop_bytes = d->gop_bytes;
+        stats->gop_bps = gst_util_uint64_scale ((guint64) d->gop_bytes * 8, GST_SECOND, ts - d->gop_start);
+        stats->gop_length_mean += (d->gop_frames - stats->gop_length_mean) / stats->gop_count;
+      }
+      d->gop_start = ts;
+      d->gop_frames = 0;
+      d->gop_bytes = 0;
+    }
+    if (GST_CLOCK_TIME_IS_VALID (d->gop_start)) {
+      d->gop_frames++;
+      d->gop_bytes += d->bytes;
+    }
+}
+
+
+static void
+bitrate_nal (bitrate_data *d, const guint8 *nal, gsize size, guint span, GstClockTime ts) {
+    VGST_FRAME_TYPE type;
+    gboolean first = FALSE, vcl = FALSE;
+
+    if (d->codec == CODEC_H264 && size >= 2) {
+      guint nal_type = nal[0] & 0x1f;
+      vcl = nal_type >= 1 && nal_type <= 5;
+      first = vcl && parse_h264_slice (nal, size, &type);
+    } else if (d->codec == CODEC_H265 && size >= 3) {
+      guint nal_type = (nal[0] >> 1) & 0x3f;
+      vcl = nal_type < 32;
+      if (nal_type == 34)
+        parse_h265_pps (d, nal, size);
+      first = vcl && parse_h265_slice (d, nal, size, &type);
+    }
+
+    if (first) {
+      if (d->in_frame)
+        bitrate_frame_done (d);
+      d->in_frame = TRUE;
+      d->type = type;
+      d->bytes = d->prefix_bytes + span;
+      d->prefix_bytes = 0;
+      d->ts = ts;
+    } else if (vcl && d->in_frame) {
+      d->bytes += span;
+    } else {
+      d->prefix_bytes += span;
+    }
+}
+
+
+static void
+bitrate_scan (bitrate_data *d, const guint8 *data, gsize size, GstClockTime ts) {
+    gsize i, code, start = G_MAXSIZE, span_start = 0;
+
+    for (i =0; i + 2 < size; i++) {
+      if (data[i] || data[i + 1] || data[i + 2] != 1)
+        continue;
+      /* a 4 byte start code belongs to the following NAL */
+      code = (i && !data[i - 1]) ? i - 1 : i;
+      if (start != G_MAXSIZE)
+        bitrate_nal (d, data + start, code - start, code - span_start, ts);
+      else if (code)
+        d->prefix_bytes += code;
+      span_start = code;
+      start = i + 3;
+      i += 2;
+    }
+    if (start != G_MAXSIZE)
+      bitrate_nal (d, data + start, size - start, size - span_start, ts);
+    else if (d->in_frame)
+      d->bytes += size;
+    else
+      d->prefix_bytes += size;
+}
+
+
+static void
+bitrate_buffer (bitrate_source *src, GstBuffer *buf) {
+    GstMapInfo map;
+    GstClockTime ts = GST_BUFFER_DTS_OR_PTS (buf);
+
+    if (!gst_buffer_map (buf, &map, GST_MAP_READ))
+      return;
+    g_mutex_lock (&src->lock);
+    bitrate_scan (&src->d, map.data, map.size, ts);
+    g_mutex_unlock (&src->lock);
+    gst_buffer_unmap (buf, &map);
+}
+
+
+static gboolean
+bitrate_list_cb (GstBuffer **buf, guint idx, gpointer data) {
+    bitrate_buffer ((bitrate_source *)data, *buf);
+    return TRUE;
+}
+
+
+static GstPadProbeReturn
+bitrate_probe_cb (GstPad *pad, GstPadProbeInfo *info, gpointer data) {
+    bitrate_source *src = (bitrate_source *)data;
+
+    if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+      GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+      if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS) {
+        GstCaps *caps;
+        const gchar *name;
+        gst_event_parse_caps (event, &caps);
+        name = gst_structure_get_name (gst_caps_get_structure (caps, 0));
+        g_mutex_lock (&src->lock);
+        src->d.codec = !g_strcmp0 (name, "video/x-h264") ? CODEC_H264 :
+                       !g_strcmp0 (name, "video/x-h265") ? CODEC_H265 : CODEC_NONE;
+        g_mutex_unlock (&src->lock);
+      }
+      return GST_PAD_PROBE_OK;
+    }
+
+    if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+      gst_buffer_list_foreach (GST_PAD_PROBE_INFO_BUFFER_LIST (info), bitrate_list_cb, src);
+    else
+      bitrate_buffer (src, GST_PAD_PROBE_INFO_BUFFER (info));
+    return GST_PAD_PROBE_OK;
+}
+
+
+void
+vgst_bitrate_attach (vgst_playback *play_ptr, guint index) {
+    bitrate_source *src;
+    GstPad *pad;
+
+    if (index >= MAX_SRC_NUM)
+      return;
+    src = &sources[index];
+    g_mutex_lock (&src->lock);
+    memset (&src->d, 0, sizeof (src->d));
+    src->d.ts = GST_CLOCK_TIME_NONE;
+    src->d.last_ts = GST_CLOCK_TIME_NONE;
+    src->d.gop_start = GST_CLOCK_TIME_NONE;
+    g_mutex_unlock (&src->lock);
+
+    if (!play_ptr->videoenc || !play_ptr->enccapsfilter)
+      return;
+    pad = gst_element_get_static_pad (play_ptr->enccapsfilter, "src");
+    if (!pad)
+      return;
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+                       bitrate_probe_cb, src, NULL);
+    gst_object_unref (pad);
+}
+
+
+gint
+get_bitrate_stats (guint index, vgst_bitrate_stats *stats) {
+    bitrate_data *d;
+    GstClockTime window = VGST_BITRATE_WINDOW_MS * GST_MSECOND, oldest;
+    guint64 bytes = 0;
+    guint i, n;
+
+    if (index >= MAX_SRC_NUM || !stats)
+      return VGST_ERROR_OTHER;
+    d = &sources[index].d;
+
+    g_mutex_lock (&sources[index].lock);
+    *stats = d->stats;
+    n = MIN (d->next, VGST_BITRATE_FRAMES);
+    oldest = d->last_ts;
+    for (i =1; i <= n; i++) {
+      bitrate_frame *f = &d->frames[(d->next - i) & (VGST_BITRATE_FRAMES - 1)];
+      if (d->last_ts - f->ts >= window)
+        break;
+      bytes += f->bytes;
+      oldest = f->ts;
+    }
+    /* window not filled yet: scale by the time covered, counting the newest frame duration once */
+    if (n > 1 && i > 2) {
+      GstClockTime span = MIN (window, (d->last_ts - oldest) * (i - 1) / (i - 2));
+      if (span)
+        stats->window_bps = gst_util_uint64_scale (bytes * 8, GST_SECOND, span);
+    }
+    g_mutex_unlock (&sources[index].lock);
+
+    GST_LOG ("pipeline %u encoder output: %u bps (inst %u bps), %" G_GUINT64_FORMAT " frames, GOP %u frames %u bps",
+             index, stats->window_bps, stats->inst_bps, stats->frames, stats->gop_length, stats->gop_bps);
+    return VGST_SUCCESS;
+}
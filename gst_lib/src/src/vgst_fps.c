@@ -0,0 +1,392 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+#include <math.h>
+#include "vgst_fps.h"
+GST_DEBUG_CATEGORY_EXTERN (vgst_lib);
+#define GST_CAT_DEFAULT vgst_lib
+
+/*
+ * Frame statistics are computed from the buffer timestamps seen on the sink
+ * pad of the video sink, so they show the real presentation cadence (59.94
+ * vs 60 Hz, uneven pacing) rather than a rounded rate. The whole run is kept
+ * as a Welford mean/variance of the frame interval, the rolling windows are
+ * built from per second buckets of arrival time.
+ */
+typedef struct
+_fps_bucket {
+    gint64     sec;
+    guint64    frames;
+    guint64    intervals;
+    gdouble    sum;
+    gdouble    sum_sq;
+    guint64    dropped;
+    guint64    late;
+} fps_bucket;
+
+typedef struct
+_fps_data {
+    GstSegment     segment;
+    GstClockTime   nominal;
+    GstClockTime   last_pts;
+    guint64        frames;
+    guint64        intervals;
+    gdouble        mean;
+    gdouble        m2;
+    gdouble        min;
+    gdouble        max;
+    guint64        dropped;
+    guint64        late;
+    guint64        qos_dropped;
+    fps_bucket     buckets[VGST_FPS_BUCKETS];
+} fps_data;
+
+typedef struct
+_fps_sink {
+    GMutex         lock;
+    /* referenced, cached pipelines may outlive or replace the one attached */
+    GstElement     *element;
+    GstPad         *pad;
+    gulong         probe_id;
+    fps_data       d;
+} fps_sink;
+
+static fps_sink sinks[MAX_SRC_NUM][MAX_SPLIT_SCREEN];
+
+static const guint window_secs[VGST_FPS_WINDOW_COUNT] = {
+    [VGST_FPS_WINDOW_1S]  = 1,
+    [VGST_FPS_WINDOW_10S] = 10,
+    [VGST_FPS_WINDOW_60S] = VGST_FPS_WINDOW_SECS,
+};
+
+
+static void
+fps_data_reset (fps_data *d) {
+    memset (d, 0, sizeof (*d));
+    gst_segment_init (&d->segment, GST_FORMAT_UNDEFINED);
+    d->last_pts = GST_CLOCK_TIME_NONE;
+}
+
+
+static fps_bucket *
+fps_bucket_get (fps_data *d, gint64 sec) {
+    fps_bucket *bucket = &d->buckets[sec % VGST_FPS_BUCKETS];
+    if (bucket->sec != sec) {
+      memset (bucket, 0, sizeof (*bucket));
+      bucket->sec = sec;
+    }
+    return bucket;
+}
+
+
+/* frames missing between two timestamps delta apart */
+static guint64
+fps_missing_frames (GstClockTime delta, GstClockTime nominal) {
+    if (!nominal || delta * 100 <= nominal * VGST_FPS_DROP_THRESHOLD)
+      return 0;
+    return (delta + nominal / 2) / nominal - 1;
+}
+
+
+static gboolean
+fps_is_late (fps_data *d, GstElement *element, GstClockTime pts) {
+    GstClockTime running, now;
+    GstClock *clock;
+    gboolean late = FALSE;
+
+    if (d->segment.format != GST_FORMAT_TIME)
+      return FALSE;
+    running = gst_segment_to_running_time (&d->segment, GST_FORMAT_TIME, pts);
+    if (!GST_CLOCK_TIME_IS_VALID (running))
+      return FALSE;
+    clock = gst_element_get_clock (element);
+    if (!clock)
+      return FALSE;
+    now = gst_clock_get_time (clock) - gst_element_get_base_time (element);
+    /* a frame is late once its successor should already be on screen */
+    late = now > running + (d->nominal ? d->nominal : GST_SECOND / 60);
+    gst_object_unref (clock);
+    return late;
+}
+
+
+/* returns TRUE when pts opens a new second, the previous one is then complete */
+static gboolean
+fps_record (fps_sink *sink, GstClockTime pts) {
+    fps_data *d = &sink->d;
+    gint64 sec = g_get_monotonic_time () / G_USEC_PER_SEC;
+    gboolean new_second = d->frames && d->buckets[sec % VGST_FPS_BUCKETS].sec != sec;
+    fps_bucket *bucket = fps_bucket_get (d, sec);
+    gboolean late = fps_is_late (d, sink->element, pts);
+
+    d->frames++;
+    bucket->frames++;
+    if (late) {
+      d->late++;
+      bucket->late++;
+    }
+    if (GST_CLOCK_TIME_IS_VALID (d->last_pts) && pts > d->last_pts) {
+      GstClockTime delta = pts - d->last_pts;
+      gdouble us = (gdouble) delta / GST_USECOND;
+      gdouble diff = us - d->mean;
+      guint64 missing = fps_missing_frames (delta, d->nominal);
+
+      d->intervals++;
+      d->mean += diff / d->intervals;
+      d->m2 += diff * (us - d->mean);
+      if (d->intervals == 1 || us < d->min)
+        d->min = us;
+      if (us > d->max)
+        d->max = us;
+      d->dropped += missing;
+
+      bucket->intervals++;
+      bucket->sum += us;
+      bucket->sum_sq += us * us;
+      bucket->dropped += missing;
+    }
+    d->last_pts = pts;
+    return new_second;
+}
+
+
+static GstPadProbeReturn
+fps_probe_cb (GstPad *pad, GstPadProbeInfo *info, gpointer data) {
+    fps_sink *sink = (fps_sink *)data;
+
+    if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+      GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+      g_mutex_lock (&sink->lock);
+      switch (GST_EVENT_TYPE (event)) {
+      case GST_EVENT_CAPS: {
+        GstCaps *caps;
+        gint num = 0, den = 0;
+        gst_event_parse_caps (event, &caps);
+        sink->d.nominal = 0;
+        if (gst_structure_get_fraction (gst_caps_get_structure (caps, 0), "framerate", &num, &den) && num > 0)
+          sink->d.nominal = gst_util_uint64_scale_int (GST_SECOND, den, num);
+        break;
+      }
+      case GST_EVENT_SEGMENT: {
+        const GstSegment *segment;
+        gst_event_parse_segment (event, &segment);
+        gst_segment_copy_into (segment, &sink->d.segment);
+        break;
+      }
+      case GST_EVENT_FLUSH_STOP:
+        /* seeks (file loop) restart the timestamps */
+        sink->d.last_pts = GST_CLOCK_TIME_NONE;
+        break;
+      default:
+        break;
+      }
+      g_mutex_unlock (&sink->lock);
+      return GST_PAD_PROBE_OK;
+    }
+
+    if (GST_CLOCK_TIME_IS_VALID (GST_BUFFER_PTS (GST_PAD_PROBE_INFO_BUFFER (info)))) {
+      GstElement *element = NULL;
+      g_mutex_lock (&sink->lock);
+      if (sink->element && fps_record (sink, GST_BUFFER_PTS (GST_PAD_PROBE_INFO_BUFFER (info))))
+        element = gst_object_ref (sink->element);
+      g_mutex_unlock (&sink->lock);
+      /* lets the application refresh its statistics without polling */
+      if (element) {
+        gst_element_post_message (element, gst_message_new_element (GST_OBJECT (element),
+                                  gst_structure_new_empty (VGST_STATS_MESSAGE)));
+        gst_object_unref (element);
+      }
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+
+/* drops the probe and the element reference of the previous attach */
+static void
+fps_probe_remove (fps_sink *sink) {
+    GstElement *element;
+    GstPad *pad;
+
+    g_mutex_lock (&sink->lock);
+    element = sink->element;
+    pad = sink->pad;
+    sink->element = NULL;
+    sink->pad = NULL;
+    g_mutex_unlock (&sink->lock);
+    if (pad) {
+      gst_pad_remove_probe (pad, sink->probe_id);
+      gst_object_unref (pad);
+    }
+    sink->probe_id = 0;
+    if (element)
+      gst_object_unref (element);
+}
+
+
+static void
+fps_probe_add (fps_sink *sink, GstElement *element) {
+    GstPad *pad;
+
+    fps_probe_remove (sink);
+    g_mutex_lock (&sink->lock);
+    fps_data_reset (&sink->d);
+    g_mutex_unlock (&sink->lock);
+    if (!element)
+      return;
+    pad = gst_element_get_static_pad (element, "sink");
+    if (!pad)
+      return;
+    g_mutex_lock (&sink->lock);
+    sink->element = gst_object_ref (element);
+    sink->pad = pad;
+    g_mutex_unlock (&sink->lock);
+    sink->probe_id = gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+                                        fps_probe_cb, sink, NULL);
+}
+
+
+void
+vgst_fps_attach (vgst_playback *play_ptr, guint index) {
+    if (index >= MAX_SRC_NUM)
+      return;
+    fps_probe_add (&sinks[index][0], play_ptr->fpsdisplaysink || !play_ptr->stream_sink ? play_ptr->videosink : play_ptr->stream_sink);
+    fps_probe_add (&sinks[index][1], play_ptr->videosink2);
+}
+
+
+void
+vgst_fps_detach (guint index) {
+    guint s;
+
+    if (index >= MAX_SRC_NUM)
+      return;
+    for (s =0; s < MAX_SPLIT_SCREEN; s++)
+      fps_probe_remove (&sinks[index][s]);
+}
+
+
+void
+fps_stats_qos (vgst_playback *play_ptr, guint index, GstMessage *msg) {
+    GstFormat format;
+    guint64 dropped;
+    guint s;
+
+    if (index >= MAX_SRC_NUM)
+      return;
+    gst_message_parse_qos_stats (msg, &format, NULL, &dropped);
+    if (format != GST_FORMAT_BUFFERS && format != GST_FORMAT_DEFAULT)
+      return;
+    for (s =0; s < MAX_SPLIT_SCREEN; s++) {
+      fps_sink *sink = &sinks[index][s];
+      gboolean match;
+      g_mutex_lock (&sink->lock);
+      /* fpsdisplaysink and other sink bins post QoS from their inner sink */
+      match = sink->element && (GST_MESSAGE_SRC (msg) == GST_OBJECT (sink->element) ||
+                                gst_object_has_as_ancestor (GST_MESSAGE_SRC (msg), GST_OBJECT (sink->element)));
+      if (match)
+        sink->d.qos_dropped = dropped;
+      g_mutex_unlock (&sink->lock);
+      if (match)
+        return;
+    }
+}
+
+
+static gdouble
+fps_stddev (gdouble sum, gdouble sum_sq, guint64 n) {
+    gdouble var;
+    if (n < 2)
+      return 0;
+    var = (sum_sq - sum * sum / n) / (n - 1);
+    return var > 0 ? sqrt (var) : 0;
+}
+
+
+gint
+get_fps_stats (guint index, guint sink_index, vgst_fps_stats *stats) {
+    gint64 now = g_get_monotonic_time () / G_USEC_PER_SEC;
+    fps_sink *sink;
+    fps_data *d;
+    guint w, b;
+
+    if (index >= MAX_SRC_NUM || sink_index >= MAX_SPLIT_SCREEN || !stats)
+      return VGST_ERROR_OTHER;
+    sink = &sinks[index][sink_index];
+    d = &sink->d;
+    memset (stats, 0, sizeof (*stats));
+
+    g_mutex_lock (&sink->lock);
+    stats->frames = d->frames;
+    stats->interval_mean_us = d->mean;
+    stats->interval_stddev_us = d->intervals > 1 ? sqrt (d->m2 / (d->intervals - 1)) : 0;
+    stats->interval_min_us = d->min;
+    stats->interval_max_us = d->max;
+    stats->fps = d->mean > 0 ? G_USEC_PER_SEC / d->mean : 0;
+    stats->dropped = d->dropped;
+    stats->late = d->late;
+    stats->qos_dropped = d->qos_dropped;
+
+    /* windows cover the last completed seconds, the current one is still filling */
+    for (w =0; w < VGST_FPS_WINDOW_COUNT; w++) {
+      vgst_fps_window *win = &stats->window[w];
+      guint64 intervals = 0;
+      gdouble sum = 0, sum_sq = 0;
+      for (b =0; b < VGST_FPS_BUCKETS; b++) {
+        fps_bucket *bucket = &d->buckets[b];
+        if (!bucket->frames || bucket->sec >= now || bucket->sec < now - (gint64) window_secs[w])
+          continue;
+        win->frames += bucket->frames;
+        win->dropped += bucket->dropped;
+        win->late += bucket->late;
+        intervals += bucket->intervals;
+        sum += bucket->sum;
+        sum_sq += bucket->sum_sq;
+      }
+      if (!intervals)
+        continue;
+      win->interval_mean_us = sum / intervals;
+      win->interval_stddev_us = fps_stddev (sum, sum_sq, intervals);
+      win->fps = G_USEC_PER_SEC / win->interval_mean_us;
+    }
+    g_mutex_unlock (&sink->lock);
+
+    GST_LOG ("pipeline %u sink %u: %.3f fps, interval %.1f +- %.1f us, %" G_GUINT64_FORMAT " dropped, %"
+             G_GUINT64_FORMAT " late, %" G_GUINT64_FORMAT " qos dropped", index, sink_index, stats->fps,
+             stats->interval_mean_us, stats->interval_stddev_us, stats->dropped, stats->late, stats->qos_dropped);
+    return VGST_SUCCESS;
+}
@@ -0,0 +1,363 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+#include "vgst_graph.h"
+#include "vgst_pipeline.h"
+GST_DEBUG_CATEGORY_EXTERN (vgst_lib);
+#define GST_CAT_DEFAULT vgst_lib
+
+struct _vgst_graph {
+    const vgst_graph_desc  *desc;
+    GstElementFactory      **factories;
+    gchar                  ***props;
+    guint                  (*links)[2];
+    GstCaps                **caps;
+};
+
+#define NODE(field, factory, props) \
+    { #field, factory, G_STRUCT_OFFSET (vgst_playback, field), props }
+#define LINK(src, sink) \
+    { #src, NULL, #sink, NULL, NULL }
+#define LINK_PADS(src, src_pad, sink, sink_pad) \
+    { #src, src_pad, #sink, sink_pad, NULL }
+#define GRAPH(name, nodes, edges) \
+    { name, nodes, G_N_ELEMENTS (nodes), edges, G_N_ELEMENTS (edges) }
+
+/* ip_src --> capsfilter --> videofilter --> fpsdisplaysink */
+static const vgst_graph_node sdx_display_nodes[] = {
+    NODE (ip_src,         NULL,              NULL),
+    NODE (srccapsfilter,  "capsfilter",      NULL),
+    NODE (videofilter,    NULL,              NULL),
+    NODE (fpsdisplaysink, "fpsdisplaysink",  NULL),
+};
+static const vgst_graph_edge sdx_display_edges[] = {
+    LINK (ip_src,        srccapsfilter),
+    LINK (srccapsfilter, videofilter),
+    LINK (videofilter,   fpsdisplaysink),
+};
+
+/* ip_src --> capsfilter --> videoenc --> enccapsfilter --> queue --> videodec --> queue --> fpsdisplaysink */
+static const vgst_graph_node vcu_display_nodes[] = {
+    NODE (ip_src,         NULL,              NULL),
+    NODE (srccapsfilter,  "capsfilter",      NULL),
+    NODE (videoenc,       NULL,              NULL),
+    NODE (enccapsfilter,  "capsfilter",      NULL),
+    NODE (enc_queue,      "queue",           NULL),
+    NODE (videodec,       NULL,              NULL),
+    NODE (queue,          "queue",           NULL),
+    NODE (fpsdisplaysink, "fpsdisplaysink",  NULL),
+};
+static const vgst_graph_edge vcu_display_edges[] = {
+    LINK (ip_src,        srccapsfilter),
+    LINK (srccapsfilter, videoenc),
+    LINK (videoenc,      enccapsfilter),
+    LINK (enccapsfilter, enc_queue),
+    LINK (enc_queue,     videodec),
+    LINK (videodec,      queue),
+    LINK (queue,         fpsdisplaysink),
+};
+
+/* ip_src --> srccapsfilter --> videoenc --> enccapsfilter --> mpegtsmux --> rtppay --> enc_queue --> stream_sink */
+static const vgst_graph_node vcu_stream_nodes[] = {
+    NODE (ip_src,         NULL,                      NULL),
+    NODE (srccapsfilter,  "capsfilter",              NULL),
+    NODE (videoenc,       NULL,                      NULL),
+    NODE (enccapsfilter,  "capsfilter",              NULL),
+    NODE (mpegtsmux,      MPEG_TS_MUX_NAME,          NULL),
+    NODE (rtppay,         MPEG_TS_RTP_PAYLOAD_NAME,  NULL),
+    NODE (enc_queue,      "queue",                   NULL),
+    NODE (stream_sink,    "udpsink",                 NULL),
+};
+static const vgst_graph_edge vcu_stream_edges[] = {
+    LINK (ip_src,        srccapsfilter),
+    LINK (srccapsfilter, videoenc),
+    LINK (videoenc,      enccapsfilter),
+    LINK (enccapsfilter, mpegtsmux),
+    LINK (mpegtsmux,     rtppay),
+    LINK (rtppay,        enc_queue),
+    LINK (enc_queue,     stream_sink),
+};
+
+/* ip_src --> capsfilter --> videoenc --> queue --> capsfilter --> videoparser --> mux --> videosink */
+static const vgst_graph_node vcu_record_nodes[] = {
+    NODE (ip_src,         NULL,          NULL),
+    NODE (srccapsfilter,  "capsfilter",  NULL),
+    NODE (videoenc,       NULL,          NULL),
+    NODE (enc_queue,      "queue",       NULL),
+    NODE (enccapsfilter,  "capsfilter",  NULL),
+    NODE (videoparser,    NULL,          NULL),
+    NODE (mux,            NULL,          NULL),
+    NODE (videosink,      "filesink",    NULL),
+};
+static const vgst_graph_edge vcu_record_edges[] = {
+    LINK (ip_src,        srccapsfilter),
+    LINK (srccapsfilter, videoenc),
+    LINK (videoenc,      enc_queue),
+    LINK (enc_queue,     enccapsfilter),
+    LINK (enccapsfilter, videoparser),
+    LINK (videoparser,   mux),
+    LINK (mux,           videosink),
+};
+
+/* ip_src --> capsfilter --> fpsdisplaysink */
+static const vgst_graph_node raw_display_nodes[] = {
+    NODE (ip_src,         NULL,              NULL),
+    NODE (srccapsfilter,  "capsfilter",      NULL),
+    NODE (fpsdisplaysink, "fpsdisplaysink",  NULL),
+};
+static const vgst_graph_edge raw_display_edges[] = {
+    LINK (ip_src,        srccapsfilter),
+    LINK (srccapsfilter, fpsdisplaysink),
+};
+
+/*
+ * ip_src --> capsfilter --> tee --> videoenc --> enccapsfilter --> videodec --> queue --> fpsdisplaysink
+ *                               \-> queue --> fpsdisplaysink2
+ */
+static const vgst_graph_node split_screen_nodes[] = {
+    NODE (ip_src,          NULL,              NULL),
+    NODE (srccapsfilter,   "capsfilter",      NULL),
+    NODE (tee,             "tee",             NULL),
+    NODE (videoenc,        NULL,              NULL),
+    NODE (enccapsfilter,   "capsfilter",      NULL),
+    NODE (videodec,        NULL,              NULL),
+    NODE (queue,           "queue",           "max-size-bytes=0"),
+    NODE (fpsdisplaysink,  "fpsdisplaysink",  NULL),
+    NODE (enc_queue,       "queue",           "max-size-bytes=0"),
+    NODE (fpsdisplaysink2, "fpsdisplaysink",  NULL),
+};
+static const vgst_graph_edge split_screen_edges[] = {
+    LINK (ip_src,        srccapsfilter),
+    LINK (srccapsfilter, tee),
+    LINK_PADS (tee,      "src_1", videoenc,  "sink"),
+    LINK_PADS (tee,      "src_2", enc_queue, "sink"),
+    LINK (enc_queue,     fpsdisplaysink2),
+    LINK (videoenc,      enccapsfilter),
+    LINK (enccapsfilter, videodec),
+    LINK (videodec,      queue),
+    LINK (queue,         fpsdisplaysink),
+};
+
+static const vgst_graph_desc topologies[VGST_GRAPH_COUNT] = {
+    [VGST_GRAPH_SDX_DISPLAY]  = GRAPH ("sdx-display",  sdx_display_nodes,  sdx_display_edges),
+    [VGST_GRAPH_VCU_DISPLAY]  = GRAPH ("vcu-display",  vcu_display_nodes,  vcu_display_edges),
+    [VGST_GRAPH_VCU_STREAM]   = GRAPH ("vcu-stream",   vcu_stream_nodes,   vcu_stream_edges),
+    [VGST_GRAPH_VCU_RECORD]   = GRAPH ("vcu-record",   vcu_record_nodes,   vcu_record_edges),
+    [VGST_GRAPH_RAW_DISPLAY]  = GRAPH ("raw-display",  raw_display_nodes,  raw_display_edges),
+    [VGST_GRAPH_SPLIT_SCREEN] = GRAPH ("split-screen", split_screen_nodes, split_screen_edges),
+};
+
+static GMutex graph_lock;
+static vgst_graph *compiled[VGST_GRAPH_COUNT];
+
+
+static gint
+find_node (const vgst_graph_desc *desc, const gchar *name) {
+    guint i;
+    for (i =0; i < desc->num_nodes; i++) {
+      if (!g_strcmp0 (desc->nodes[i].name, name))
+        return i;
+    }
+    return -1;
+}
+
+
+vgst_graph *
+vgst_graph_compile (const vgst_graph_desc *desc) {
+    vgst_graph *graph;
+    guint i, j;
+
+    graph = g_new0 (vgst_graph, 1);
+    graph->desc = desc;
+    graph->factories = g_new0 (GstElementFactory *, desc->num_nodes);
+    graph->props = g_new0 (gchar **, desc->num_nodes);
+    graph->links = g_malloc0_n (desc->num_edges, sizeof (*graph->links));
+    graph->caps = g_new0 (GstCaps *, desc->num_edges);
+
+    for (i =0; i < desc->num_nodes; i++) {
+      const vgst_graph_node *node = &desc->nodes[i];
+      if (find_node (desc, node->name) != (gint) i) {
+        GST_ERROR ("graph %s: node %s is defined twice", desc->name, node->name);
+        goto fail;
+      }
+      if (node->factory && !(graph->factories[i] = gst_element_factory_find (node->factory))) {
+        GST_ERROR ("graph %s: no element factory %s for node %s", desc->name, node->factory, node->name);
+        goto fail;
+      }
+      if (node->props) {
+        graph->props[i] = g_strsplit (node->props, ";", -1);
+        for (j =0; graph->props[i][j]; j++) {
+          if (!strchr (graph->props[i][j], '=')) {
+            GST_ERROR ("graph %s: malformed property '%s' on node %s", desc->name, graph->props[i][j], node->name);
+            goto fail;
+          }
+        }
+      }
+    }
+
+    for (i =0; i < desc->num_edges; i++) {
+      const vgst_graph_edge *edge = &desc->edges[i];
+      gint src = find_node (desc, edge->src);
+      gint sink = find_node (desc, edge->sink);
+      if (src < 0 || sink < 0) {
+        GST_ERROR ("graph %s: edge %s --> %s uses an unknown node", desc->name, edge->src, edge->sink);
+        goto fail;
+      }
+      graph->links[i][0] = src;
+      graph->links[i][1] = sink;
+      if (edge->caps && !(graph->caps[i] = gst_caps_from_string (edge->caps))) {
+        GST_ERROR ("graph %s: invalid caps '%s' on %s --> %s", desc->name, edge->caps, edge->src, edge->sink);
+        goto fail;
+      }
+    }
+    return graph;
+
+fail:
+    vgst_graph_free (graph);
+    return NULL;
+}
+
+
+void
+vgst_graph_free (vgst_graph *graph) {
+    guint i;
+    if (!graph)
+      return;
+    for (i =0; i < graph->desc->num_nodes; i++) {
+      if (graph->factories[i])
+        gst_object_unref (graph->factories[i]);
+      g_strfreev (graph->props[i]);
+    }
+    for (i =0; i < graph->desc->num_edges; i++) {
+      if (graph->caps[i])
+        gst_caps_unref (graph->caps[i]);
+    }
+    g_free (graph->factories);
+    g_free (graph->props);
+    g_free (graph->links);
+    g_free (graph->caps);
+    g_free (graph);
+}
+
+
+const vgst_graph *
+vgst_graph_get (VGST_GRAPH_TOPOLOGY topology) {
+    vgst_graph *graph;
+    if ((gint) topology < 0 || topology >= VGST_GRAPH_COUNT)
+      return NULL;
+    g_mutex_lock (&graph_lock);
+    if (!compiled[topology])
+      compiled[topology] = vgst_graph_compile (&topologies[topology]);
+    graph = compiled[topology];
+    g_mutex_unlock (&graph_lock);
+    return graph;
+}
+
+
+gint
+vgst_graph_select (const vgst_ip_params *ip_param, guint sink_type) {
+    if (SPLIT_SCREEN == sink_type)
+      return VGST_GRAPH_SPLIT_SCREEN;
+    if ((ip_param->filter_type != SDX_FILTER) && (FILE_SRC == ip_param->src_type || STREAMING_SRC == ip_param->src_type)) {
+      /* decodebin pads appear at runtime, see on_pad_added */
+      return -1;
+    }
+    if (ip_param->raw)
+      return VGST_GRAPH_RAW_DISPLAY;
+    if (ip_param->filter_type == SDX_FILTER)
+      return sink_type == DISPLAY ? VGST_GRAPH_SDX_DISPLAY : -1;
+    switch (sink_type) {
+    case DISPLAY :
+      return VGST_GRAPH_VCU_DISPLAY;
+    case STREAM :
+      return VGST_GRAPH_VCU_STREAM;
+    case RECORD :
+      return VGST_GRAPH_VCU_RECORD;
+    }
+    return -1;
+}
+
+
+VGST_ERROR_LOG
+vgst_graph_instantiate (const vgst_graph *graph, vgst_playback *play_ptr) {
+    const vgst_graph_desc *desc = graph->desc;
+    GstElement *elements[desc->num_nodes];
+    guint i, j;
+
+    if (!play_ptr->pipeline) {
+      GST_ERROR ("graph %s: no pipeline to instantiate into", desc->name);
+      return VGST_ERROR_PIPELINE_CREATE_FAIL;
+    }
+
+    /* resolve every node before touching any link */
+    for (i =0; i < desc->num_nodes; i++) {
+      GstElement **slot = G_STRUCT_MEMBER_P (play_ptr, desc->nodes[i].offset);
+      if (!*slot && graph->factories[i])
+        *slot = gst_element_factory_create (graph->factories[i], NULL);
+      if (!*slot) {
+        GST_ERROR ("graph %s: FAILED to create %s", desc->name, desc->nodes[i].name);
+        return VGST_ERROR_PIPELINE_CREATE_FAIL;
+      }
+      if (!GST_OBJECT_PARENT (*slot))
+        gst_bin_add (GST_BIN (play_ptr->pipeline), *slot);
+      elements[i] = *slot;
+    }
+
+    for (i =0; i < desc->num_nodes; i++) {
+      for (j =0; graph->props[i] && graph->props[i][j]; j++) {
+        gchar **kv = g_strsplit (graph->props[i][j], "=", 2);
+        if (g_object_class_find_property (G_OBJECT_GET_CLASS (elements[i]), kv[0]))
+          gst_util_set_object_arg (G_OBJECT (elements[i]), kv[0], kv[1]);
+        else
+          GST_WARNING ("graph %s: %s has no property %s", desc->name, desc->nodes[i].name, kv[0]);
+        g_strfreev (kv);
+      }
+    }
+
+    for (i =0; i < desc->num_edges; i++) {
+      const vgst_graph_edge *edge = &desc->edges[i];
+      if (!gst_element_link_pads_filtered (elements[graph->links[i][0]], edge->src_pad,
+                                           elements[graph->links[i][1]], edge->sink_pad, graph->caps[i])) {
+        GST_ERROR ("Error linking for %s --> %s in %s graph", edge->src, edge->sink, desc->name);
+        return VGST_ERROR_PIPELINE_LINKING_FAIL;
+      }
+      GST_DEBUG ("Linked for %s --> %s successfully", edge->src, edge->sink);
+    }
+    return VGST_SUCCESS;
+}
@@ -0,0 +1,301 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+#include "vgst_latency.h"
+#include "video_trace.h"
+GST_DEBUG_CATEGORY_EXTERN (vgst_lib);
+#define GST_CAT_DEFAULT vgst_lib
+
+/*
+ * The source probe remembers when each buffer (by PTS) left the source,
+ * later probes look the PTS up and add the elapsed time to their stage
+ * histogram. Streaming threads only ever do atomic operations here, the
+ * stamps are published with a per slot sequence count.
+ */
+typedef struct
+_latency_stamp {
+    gint       seq;
+    gint64     pts;
+    gint64     time;
+} latency_stamp;
+
+typedef struct
+_latency_hist {
+    guint      buckets[VGST_LATENCY_BUCKETS];
+    gint       max_us;
+} latency_hist;
+
+typedef struct
+_latency_probe {
+    struct _latency_source  *source;
+    VGST_LATENCY_STAGE      stage;
+    GstPad                  *pad;
+    gulong                  probe_id;
+} latency_probe;
+
+typedef struct
+_latency_source {
+    latency_stamp  stamps[VGST_LATENCY_STAMPS];
+    gint           next;
+    latency_hist   hist[VGST_STAGE_COUNT];
+    latency_probe  probes[VGST_STAGE_COUNT];
+} latency_source;
+
+static latency_source sources[MAX_SRC_NUM];
+
+static const gchar *stage_names[VGST_STAGE_COUNT] = {
+    [VGST_STAGE_SRC]  = "src",
+    [VGST_STAGE_CAPS] = "capsfilter",
+    [VGST_STAGE_PROC] = "filter/encoder",
+    [VGST_STAGE_DEC]  = "decoder",
+    [VGST_STAGE_SINK] = "sink",
+    [VGST_STAGE_ENGINE] = "software engine",
+};
+
+
+static guint
+latency_bucket (guint64 us) {
+    guint octave;
+    if (us < 8)
+      return us;
+    us = MIN (us, G_MAXINT32);
+    octave = g_bit_nth_msf (us, -1);
+    return 8 + (octave - 3) * 4 + ((us >> (octave - 2)) & 3);
+}
+
+
+/* middle of the range covered by bucket b */
+static guint
+latency_bucket_value (guint b) {
+    guint octave, sub;
+    if (b < 8)
+      return b;
+    octave = (b - 8) / 4 + 3;
+    sub = (b - 8) % 4;
+    return ((4 + sub) << (octave - 2)) + (1u << (octave - 3));
+}
+
+
+static void
+latency_record (latency_hist *hist, gint64 us) {
+    gint max;
+    if (us < 0)
+      us = 0;
+    g_atomic_int_inc (&hist->buckets[latency_bucket (us)]);
+    do {
+      max = g_atomic_int_get (&hist->max_us);
+      if (us <= max)
+        break;
+    } while (!g_atomic_int_compare_and_exchange (&hist->max_us, max, (gint) MIN (us, G_MAXINT32)));
+}
+
+
+static void
+latency_stamp_put (latency_source *src, gint64 pts, gint64 time) {
+    latency_stamp *stamp = &src->stamps[src->next++ & (VGST_LATENCY_STAMPS - 1)];
+    g_atomic_int_inc (&stamp->seq);
+    stamp->pts = pts;
+    stamp->time = time;
+    g_atomic_int_inc (&stamp->seq);
+}
+
+
+static gboolean
+latency_stamp_find (latency_source *src, gint64 pts, gint64 *time) {
+    guint i;
+    for (i =0; i < VGST_LATENCY_STAMPS; i++) {
+      latency_stamp *stamp = &src->stamps[i];
+      gint seq = g_atomic_int_get (&stamp->seq);
+      gint64 p, t;
+      if (seq & 1)
+        continue;
+      p = stamp->pts;
+      t = stamp->time;
+      if (g_atomic_int_get (&stamp->seq) != seq || p != pts)
+        continue;
+      *time = t;
+      return TRUE;
+    }
+    return FALSE;
+}
+
+
+static GstPadProbeReturn
+latency_probe_cb (GstPad *pad, GstPadProbeInfo *info, gpointer data) {
+    latency_probe *probe = (latency_probe *)data;
+    latency_source *src = probe->source;
+    GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+    GstClockTime pts = GST_BUFFER_PTS (buf);
+    gint64 now = g_get_monotonic_time ();
+    gint64 then;
+
+    if (!GST_CLOCK_TIME_IS_VALID (pts))
+      return GST_PAD_PROBE_OK;
+
+    vlib_trace_instant (stage_names[probe->stage], pts);
+    if (probe->stage == VGST_STAGE_SRC) {
+      GstElement *element = gst_pad_get_parent_element (pad);
+      if (element) {
+        /* capture latency: running time now against the running time the
+         * source stamped on the buffer */
+        GstClock *clock = gst_element_get_clock (element);
+        if (clock) {
+          GstClockTime running = gst_clock_get_time (clock) - gst_element_get_base_time (element);
+          if (running >= pts)
+            latency_record (&src->hist[VGST_STAGE_SRC], (running - pts) / GST_USECOND);
+          gst_object_unref (clock);
+        }
+        gst_object_unref (element);
+      }
+      latency_stamp_put (src, pts, now);
+    } else if (latency_stamp_find (src, pts, &then)) {
+      latency_record (&src->hist[probe->stage], now - then);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+
+static void
+latency_probe_add (latency_source *src, VGST_LATENCY_STAGE stage, GstElement *element, const gchar *pad_name) {
+    GstPad *pad;
+    if (!element)
+      return;
+    pad = gst_element_get_static_pad (element, pad_name);
+    if (!pad)
+      return;
+    src->probes[stage].source = src;
+    src->probes[stage].stage = stage;
+    src->probes[stage].pad = pad;
+    src->probes[stage].probe_id = gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, latency_probe_cb,
+                                                     &src->probes[stage], NULL);
+}
+
+
+void
+vgst_latency_record (guint index, VGST_LATENCY_STAGE stage, gint64 us) {
+    if (index >= MAX_SRC_NUM || stage >= VGST_STAGE_COUNT)
+      return;
+    latency_record (&sources[index].hist[stage], us);
+}
+
+
+void
+vgst_latency_detach (guint index) {
+    guint s;
+
+    if (index >= MAX_SRC_NUM)
+      return;
+    for (s =0; s < VGST_STAGE_COUNT; s++) {
+      latency_probe *probe = &sources[index].probes[s];
+      if (!probe->pad)
+        continue;
+      gst_pad_remove_probe (probe->pad, probe->probe_id);
+      gst_object_unref (probe->pad);
+      probe->pad = NULL;
+      probe->probe_id = 0;
+    }
+}
+
+
+void
+vgst_latency_attach (vgst_playback *play_ptr, guint index) {
+    latency_source *src;
+    GstElement *sink;
+
+    if (index >= MAX_SRC_NUM)
+      return;
+    /* probes of a parked or previous pipeline must not outlive the reset */
+    vgst_latency_detach (index);
+    if (!play_ptr->ip_src)
+      return;
+    src = &sources[index];
+    memset (src, 0, sizeof (*src));
+
+    sink = play_ptr->fpsdisplaysink ? play_ptr->fpsdisplaysink :
+           play_ptr->stream_sink ? play_ptr->stream_sink : play_ptr->videosink;
+    latency_probe_add (src, VGST_STAGE_SRC,  play_ptr->ip_src, "src");
+    latency_probe_add (src, VGST_STAGE_CAPS, play_ptr->srccapsfilter, "src");
+    latency_probe_add (src, VGST_STAGE_PROC, play_ptr->videofilter ? play_ptr->videofilter : play_ptr->videoenc, "src");
+    latency_probe_add (src, VGST_STAGE_DEC,  play_ptr->videodec, "src");
+    latency_probe_add (src, VGST_STAGE_SINK, sink, "sink");
+    if (play_ptr->swfilter)
+      vgst_swfilter_set_latency_index (play_ptr->swfilter, index);
+}
+
+
+gint
+get_latency_stats (guint index, vgst_latency_stats *stats) {
+    latency_source *src;
+    guint buckets[VGST_LATENCY_BUCKETS];
+    guint s, b;
+
+    if (index >= MAX_SRC_NUM || !stats)
+      return VGST_ERROR_OTHER;
+    src = &sources[index];
+    for (s =0; s < VGST_STAGE_COUNT; s++) {
+      guint64 total = 0, acc = 0;
+      guint64 p50, p99;
+      gboolean have_p50 = FALSE;
+      memset (&stats[s], 0, sizeof (stats[s]));
+      for (b =0; b < VGST_LATENCY_BUCKETS; b++) {
+        buckets[b] = g_atomic_int_get (&src->hist[s].buckets[b]);
+        total += buckets[b];
+      }
+      if (!total)
+        continue;
+      p50 = (total + 1) / 2;
+      p99 = (total * 99 + 99) / 100;
+      for (b =0; b < VGST_LATENCY_BUCKETS; b++) {
+        acc += buckets[b];
+        if (!have_p50 && acc >= p50) {
+          stats[s].p50_us = latency_bucket_value (b);
+          have_p50 = TRUE;
+        }
+        if (acc >= p99) {
+          stats[s].p99_us = latency_bucket_value (b);
+          break;
+        }
+      }
+      stats[s].count = total;
+      stats[s].max_us = g_atomic_int_get (&src->hist[s].max_us);
+      GST_DEBUG ("source %u %s latency: p50 %uus p99 %uus max %uus (%" G_GUINT64_FORMAT " buffers)",
+                 index, stage_names[s], stats[s].p50_us, stats[s].p99_us, stats[s].max_us, total);
+    }
+    return VGST_SUCCESS;
+}
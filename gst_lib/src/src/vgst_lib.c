@@ -39,11 +39,16 @@
 
 #include "vgst_lib.h"
 #include "vgst_utils.h"
+#include "vgst_latency.h"
+#include "vgst_fps.h"
+#include "vgst_bitrate.h"
+#include "vgst_abr.h"
 
 GST_DEBUG_CATEGORY (vgst_lib);
 #define GST_CAT_DEFAULT vgst_lib
 
 static struct filter_tbl *sdx_ft;  /* filter table */
+extern vgst_application app;
 
 const gchar *
 vgst_error_to_string (VGST_ERROR_LOG error_code, gint index) {
@@ -296,6 +301,12 @@ vgst_get_bitrate (int index) {
 }
 
 
+gint
+vgst_get_bitrate_stats (guint index, vgst_bitrate_stats *stats) {
+    return get_bitrate_stats (index, stats);
+}
+
+
 gint
 vgst_stop_pipeline () {
     /* pipeline clean up */
@@ -309,21 +320,283 @@ vgst_poll_event (int *arg, int index) {
     return poll_event (arg, index);
 }
 
+gint
+vgst_get_event_fd (void) {
+    return get_event_fd ();
+}
+
+guint
+vgst_get_events (guint index) {
+    return take_events (index);
+}
+
+/* Runs in the default main context when a source locks to a new input
+ * resolution, every live pipeline capturing from it gets the event */
+static void
+notify_source_change (size_t vsrc, size_t width, size_t height, void *data) {
+    guint i;
+
+    GST_INFO ("source %zu changed to %zux%zu", vsrc, width, height);
+    if (!app.ip_params || !app.cmn_params)
+      return;
+    for (i =0; i < app.cmn_params->num_src && i < MAX_SRC_NUM; i++) {
+      if (LIVE_SRC == app.ip_params[i].src_type && vsrc == app.ip_params[i].device_type)
+        notify_event (i, VGST_EVENT_MASK_SOURCE_CHANGED);
+    }
+}
+
 gint vgst_init(void) {
+    vlib_video_src_set_change_cb (notify_source_change, NULL);
     return vlib_src_init();
 }
 
 gint vgst_uninit(void) {
+    vlib_video_src_set_change_cb (NULL, NULL);
+    close_event_fd ();
     return vlib_src_uninit();
 }
 
+gint
+vgst_get_latency_stats (guint index, vgst_latency_stats *stats) {
+    return get_latency_stats (index, stats);
+}
+
+gint
+vgst_get_fps_stats (guint index, guint sink, vgst_fps_stats *stats) {
+    return get_fps_stats (index, sink, stats);
+}
+
+gint
+vgst_set_abr (gboolean enable) {
+    set_abr (enable);
+    return VGST_SUCCESS;
+}
+
+gint
+vgst_set_sync_start (gboolean enable) {
+    set_sync_start (enable);
+    return VGST_SUCCESS;
+}
+
+gint64
+vgst_get_switch_time (void) {
+    return get_switch_time ();
+}
+
 #ifdef BASE_TRD
+
+/*
+ * Pipelines built by vgst_change_mode are parked in READY state instead of
+ * being destroyed, so switching back to a source/filter/mode combination
+ * seen before is a state change rather than a rebuild.
+ */
+typedef struct
+_pipeline_key {
+  size_t vsrc;
+  size_t type;
+  size_t mode;
+  guint driver_type;
+  guint width;
+  guint height;
+  guint frame_rate;
+  /* input caps format and encoder input format */
+  gchar format_str[8];
+  guint format;
+} pipeline_key;
+
+typedef struct
+_pipeline_cache_entry {
+  pipeline_key key;
+  vgst_playback play;
+  gint64 last_used;
+} pipeline_cache_entry;
+
+static pipeline_cache_entry pipeline_cache[VGST_PIPELINE_CACHE_SIZE];
+static pipeline_key active_key;
+static gboolean active_cacheable;
+
+/* switcher graph mode and the filter type/mode the running graph was built for */
+static gboolean switcher_enabled;
+static struct vlib_config switcher_config;
+
+/* arguments of the last vgst_change_mode, replayed when its source changes;
+ * the parameter pointers are borrowed from the caller, see vgst_lib.h */
+typedef struct
+_mode_args {
+  gboolean valid;
+  struct vlib_config config;
+  unsigned int flags;
+  vgst_enc_params *enc_param;
+  vgst_ip_params *input_param;
+  vgst_op_params *output_param;
+  vgst_cmn_params *cmn_param;
+  vgst_sdx_filter_params *filter_param;
+} mode_args;
+
+static mode_args last_mode;
+
+static gboolean
+pipeline_key_equal (const pipeline_key * a, const pipeline_key * b)
+{
+  return a->vsrc == b->vsrc && a->type == b->type && a->mode == b->mode &&
+      a->driver_type == b->driver_type && a->width == b->width &&
+      a->height == b->height && a->frame_rate == b->frame_rate &&
+      a->format == b->format && !strcmp (a->format_str, b->format_str);
+}
+
+/* Move the running pipeline into the cache, evicting the least recently used */
+static void
+pipeline_cache_park (void)
+{
+  vgst_playback *play_ptr = &app.playback[0];
+  pipeline_cache_entry *slot = &pipeline_cache[0];
+  guint i;
+
+  if (!active_cacheable || !play_ptr->pipeline) {
+    vgst_stop_pipeline ();
+    return;
+  }
+  active_cacheable = FALSE;
+  if (park_pipeline (play_ptr) != VGST_SUCCESS) {
+    destroy_pipeline (play_ptr);
+    return;
+  }
+
+  for (i = 0; i < VGST_PIPELINE_CACHE_SIZE; i++) {
+    if (!pipeline_cache[i].play.pipeline) {
+      slot = &pipeline_cache[i];
+      break;
+    }
+    if (pipeline_cache[i].last_used < slot->last_used)
+      slot = &pipeline_cache[i];
+  }
+  if (slot->play.pipeline) {
+    GST_DEBUG ("evicting cached pipeline for source %zu", slot->key.vsrc);
+    destroy_pipeline (&slot->play);
+  }
+  slot->key = active_key;
+  slot->play = *play_ptr;
+  slot->last_used = g_get_monotonic_time ();
+  memset (play_ptr, 0, sizeof (*play_ptr));
+}
+
+/* Take the pipeline for key out of the cache, NULL if there is none */
+static vgst_playback *
+pipeline_cache_take (const pipeline_key * key)
+{
+  guint i;
+
+  for (i = 0; i < VGST_PIPELINE_CACHE_SIZE; i++) {
+    if (pipeline_cache[i].play.pipeline
+        && pipeline_key_equal (&pipeline_cache[i].key, key))
+      return &pipeline_cache[i].play;
+  }
+  return NULL;
+}
+
+static void
+pipeline_cache_flush (void)
+{
+  guint i;
+
+  for (i = 0; i < VGST_PIPELINE_CACHE_SIZE; i++)
+    destroy_pipeline (&pipeline_cache[i].play);
+  memset (pipeline_cache, 0, sizeof (pipeline_cache));
+  active_cacheable = FALSE;
+}
+
+gint
+vgst_set_switcher (gboolean enable)
+{
+  switcher_enabled = enable;
+  return VGST_SUCCESS;
+}
+
+gint
+vgst_switch_source (size_t vsrc)
+{
+  return switch_source (&app.playback[0], vsrc);
+}
+
+/* Configure every live source and build one graph feeding all of them to the sink */
+static gint
+switcher_start (struct vlib_config *config, vgst_enc_params * enc_param,
+    vgst_ip_params * input_param, vgst_op_params * output_param,
+    vgst_cmn_params * cmn_param, vgst_sdx_filter_params * filter_param)
+{
+  size_t vsrc[MAX_SRC_NUM];
+  guint num_vsrc = 0;
+  size_t i;
+  int ret;
+
+  for (i = 0; i < vlib_video_src_cnt_get () && num_vsrc < MAX_SRC_NUM; i++) {
+    if (vlib_video_src_get_class (vlib_video_src_get (i)) == VLIB_VCLASS_FILE)
+      continue;
+    if (i != config->vsrc && !g_strcmp0 (V4L2_SRC_NAME, OPENSOURCE_V4L2_SRC_NAME)) {
+      struct vlib_config src_config = *config;
+
+      src_config.vsrc = i;
+      if (vlib_change_mode_gst (&src_config)) {
+        GST_WARNING ("skipping source %zu, media pipeline setup failed", i);
+        continue;
+      }
+    }
+    vsrc[num_vsrc++] = i;
+  }
+  /* leave the media pipeline of the selected source active */
+  if (!g_strcmp0 (V4L2_SRC_NAME, OPENSOURCE_V4L2_SRC_NAME)
+      && (ret = vlib_change_mode_gst (config)))
+    return ret;
+
+  ret =
+      vgst_config_options (enc_param, input_param, output_param, cmn_param,
+      filter_param);
+  if (ret != VGST_SUCCESS) {
+    fprintf (stderr, "ERROR: vgst_config_options failed\n");
+  }
+  if ((ret = vgst_create_switcher_pipeline (vsrc, num_vsrc)))
+    return ret;
+  switcher_config = *config;
+  return vgst_run_pipeline ();
+}
+
 gint
 vgst_video_src_init (struct vlib_config_data * cfg)
 {
   return vlib_video_src_init (cfg);
 }
 
+/* Runs in the default main context when a source locks to a new input
+ * resolution, the active mode is applied again to pick it up */
+static void
+on_source_change (size_t vsrc, size_t width, size_t height, void *data)
+{
+  struct vlib_config config;
+
+  GST_INFO ("source %zu changed to %zux%zu", vsrc, width, height);
+  notify_event (0, VGST_EVENT_MASK_SOURCE_CHANGED);
+
+  if (!last_mode.valid || last_mode.config.vsrc != vsrc)
+    return;
+
+  /* without a scaler the mode only works again once the input is back at
+   * its capture resolution, applying it now would fail the media setup */
+  if (!vlib_video_src_can_scale (vsrc)
+      && (width != last_mode.input_param->width
+          || height != last_mode.input_param->height)) {
+    GST_WARNING ("source %zu cannot capture %zux%zu input at %ux%u, mode kept",
+        vsrc, width, height, last_mode.input_param->width,
+        last_mode.input_param->height);
+    return;
+  }
+
+  config = last_mode.config;
+  if (vgst_change_mode (&config, last_mode.flags, last_mode.enc_param,
+          last_mode.input_param, last_mode.output_param, last_mode.cmn_param,
+          last_mode.filter_param) != VGST_SUCCESS)
+    GST_ERROR ("failed to apply mode for new input of source %zu", vsrc);
+}
+
 gint
 vgst_init_base (struct vlib_config_data * cfg, vgst_enc_params * enc_param,
     vgst_ip_params * input_param, vgst_op_params * output_param,
@@ -341,6 +614,7 @@ vgst_init_base (struct vlib_config_data * cfg, vgst_enc_params * enc_param,
     return ret;
   }
   sdx_ft = ft;
+  vlib_video_src_set_change_cb (on_source_change, NULL);
 
   /* Initialize gst_lib structs */
   cmn_param->num_src = 1;
@@ -366,7 +640,10 @@ gint
 vgst_stop_pipeline_base (void)
 {
   int ret = 0;
+  /* the caller may release the parameters of the last mode now */
+  last_mode.valid = FALSE;
   vgst_stop_pipeline ();
+  pipeline_cache_flush ();
   ret = vlib_pipeline_stop_gst ();
   return ret;
 }
@@ -381,6 +658,28 @@ vgst_change_mode (struct vlib_config * config, unsigned int flags,
   int vsrc_class;
   static int stop_flag = 0;
   struct filter_s *fs = NULL;
+  vgst_playback *cached;
+  pipeline_key key;
+
+  last_mode.valid = TRUE;
+  last_mode.config = *config;
+  last_mode.flags = flags;
+  last_mode.enc_param = enc_param;
+  last_mode.input_param = input_param;
+  last_mode.output_param = output_param;
+  last_mode.cmn_param = cmn_param;
+  last_mode.filter_param = filter_param;
+
+  /* same filter on a running switcher graph, only the input changes */
+  if (switcher_enabled && app.playback[0].selector
+      && config->type == switcher_config.type
+      && config->mode == switcher_config.mode
+      && switch_source (&app.playback[0], config->vsrc) == VGST_SUCCESS) {
+    input_param->device_type = config->vsrc;
+    return VGST_SUCCESS;
+  }
+
+  mark_switch_start ();
 
   /* xlnxvideosrc calls vlib_change_mode_gst internally.
    * Only call this function if v4l2src is used.
@@ -398,7 +697,7 @@ vgst_change_mode (struct vlib_config * config, unsigned int flags,
   }
 
   if (stop_flag) {
-    vgst_stop_pipeline ();
+    pipeline_cache_park ();
   }
 
   if (stop_flag == 0) {
@@ -429,6 +728,7 @@ vgst_change_mode (struct vlib_config * config, unsigned int flags,
     input_param->raw = FALSE;
     fs = filter_type_get_obj (sdx_ft, config->type - 1);
     filter_param->filter_name = strdup (fs->dt_comp_string);
+    filter_param->fs = fs;
     if (fs && config->mode >= filter_type_get_num_modes (fs)) {
       GST_ERROR ("invalid filter mode '%zu' for filter '%s'\n",
           config->mode, filter_type_get_display_text (fs));
@@ -446,15 +746,56 @@ vgst_change_mode (struct vlib_config * config, unsigned int flags,
     }
   }
 
-  /* Apply all config parameters */
-  ret =
-      vgst_config_options (enc_param, input_param, output_param, cmn_param,
-      filter_param);
-  if (ret != VGST_SUCCESS) {
-    fprintf (stderr, "ERROR: vgst_config_options failed\n");
-  }
+  memset (&key, 0, sizeof (key));
+  key.vsrc = config->vsrc;
+  key.type = config->type;
+  key.mode = config->type > 0 ? config->mode : 0;
+  key.driver_type = cmn_param->driver_type;
+  key.width = input_param->width;
+  key.height = input_param->height;
+  key.frame_rate = cmn_param->frame_rate;
+  key.format = input_param->format;
+  /* bounded copy, format_str may be a bare fourcc */
+  if (input_param->format_str)
+    strncpy (key.format_str, input_param->format_str,
+        sizeof (key.format_str) - 1);
+
+  cached = pipeline_cache_take (&key);
+  if (switcher_enabled && vsrc_class != VLIB_VCLASS_FILE) {
+    if (cached) {
+      /* the switcher replaces it, no point keeping both */
+      destroy_pipeline (cached);
+      memset (cached, 0, sizeof (*cached));
+    }
+    ret =
+        switcher_start (config, enc_param, input_param, output_param,
+        cmn_param, filter_param);
+  } else if (cached) {
+    /* parameters were validated when this pipeline was built, only the
+     * properties which may differ between runs are refreshed */
+    init_struct_params (enc_param, input_param, output_param, cmn_param,
+        filter_param);
+    app.playback[0] = *cached;
+    memset (cached, 0, sizeof (*cached));
+    if (input_param->src_type == FILE_SRC)
+      g_object_set (G_OBJECT (app.playback[0].ip_src), "location",
+          input_param->uri, NULL);
+    GST_DEBUG ("reusing cached pipeline for source %zu", key.vsrc);
+    ret = resume_pipeline (&app.playback[0]);
+  } else {
+    /* Apply all config parameters */
+    ret =
+        vgst_config_options (enc_param, input_param, output_param, cmn_param,
+        filter_param);
+    if (ret != VGST_SUCCESS) {
+      fprintf (stderr, "ERROR: vgst_config_options failed\n");
+    }
 
-  ret = vgst_start_pipeline ();
+    ret = vgst_start_pipeline ();
+  }
+  active_key = key;
+  active_cacheable = (ret == VGST_SUCCESS && cmn_param->num_src == 1 &&
+      cmn_param->sink_type == DISPLAY && !app.playback[0].selector);
 
   if (config && config->type > 0)
     free (filter_param->filter_name);
@@ -549,7 +890,8 @@ static xlnx_vsrc_name vsrc_name[] =
 const char *
 vgst_get_srctype(size_t id)
 {
-  int vsrc_class = vlib_video_src_get_class (vlib_video_src_get (id));
+  /* answered from the discovery cache, no device is probed for this */
+  int vsrc_class = vlib_video_src_get_class_from_id (id);
 
   for (unsigned int i = 0; i < ARRAY_SIZE(vsrc_name); i++) {
     if (vsrc_class == vsrc_name[i].vsrc_class) {
@@ -41,10 +41,70 @@
 #include <math.h>
 #include <string.h>
 #include "vgst_pipeline.h"
+#include "vgst_graph.h"
 GST_DEBUG_CATEGORY_EXTERN (vgst_lib);
 #define GST_CAT_DEFAULT vgst_lib
 
 
+static GstElement *
+make_videofilter (vgst_playback *play_ptr, vgst_sdx_filter_params *filter_param) {
+    GstElement *videofilter;
+    if (filter_param->filter_mode == GST_FILTER_MODE_SW && vgst_swfilter_supported (filter_param->fs)) {
+      /* native software engine runs in a pad probe of a pass-through element */
+      videofilter = gst_element_factory_make (VGST_SWFILTER_ELEMENT, NULL);
+      if (videofilter) {
+        g_object_set (G_OBJECT (videofilter), "silent", TRUE, NULL);
+        if (filter_param->fs && !g_strcmp0 (filter_param->fs->dt_comp_string, SDX_FILTER2D_PLUGIN))
+          filter2d_schedule_attach (videofilter, filter_param->fs);
+        play_ptr->swfilter = vgst_swfilter_attach (videofilter, filter_param);
+      }
+    } else {
+      videofilter = gst_element_factory_make (filter_param->filter_name, NULL);
+      if (videofilter && !strcmp (filter_param->filter_name, "sdxfilter2d")) {
+        g_object_set (G_OBJECT (videofilter), "filter-kernel", "filter2d_pl_accel", NULL );
+        filter2d_schedule_attach (videofilter, filter_param->fs);
+      }
+    }
+    return videofilter;
+}
+
+
+static GstCaps *
+make_sdx_src_caps (vgst_ip_params *ip_param, vgst_cmn_params *cmn_param) {
+    return gst_caps_new_full (
+		gst_structure_new ("video/x-raw",
+                           "width",     G_TYPE_INT,        ip_param->width,
+                           "height",    G_TYPE_INT,        ip_param->height,
+                           "format",    G_TYPE_STRING,     ip_param->format_str,
+                           "framerate", GST_TYPE_FRACTION, cmn_param->frame_rate, MAX_FRAME_RATE_DENOM,
+                           NULL),
+                gst_structure_new ("video/x-raw",
+			   "width",     G_TYPE_INT,        ip_param->width,
+			   "height",    G_TYPE_INT,        ip_param->height,
+			   "format",    G_TYPE_STRING,     ip_param->format_str,
+			   NULL),
+		NULL);
+}
+
+
+static void
+set_display_property (vgst_playback *play_ptr, vgst_ip_params *ip_param, vgst_cmn_params *cmn_param) {
+    g_object_set (G_OBJECT (play_ptr->fpsdisplaysink), "fps-update-interval",     FPS_UPDATE_INTERVAL, NULL);
+    g_object_set (G_OBJECT (play_ptr->fpsdisplaysink), "text-overlay",            FALSE, NULL);
+    if (ip_param->filter_type == SDX_FILTER)
+      g_object_set (G_OBJECT (play_ptr->fpsdisplaysink), "sync",                    FALSE, NULL);
+    if (!g_strcmp0 (KMS_SINK_NAME, XLNX_KMS_SINK_NAME)) {
+      gst_util_set_object_arg (G_OBJECT(play_ptr->videosink), "sink-type", vgst_get_sinkname(cmn_param->driver_type));
+      g_object_set (G_OBJECT (play_ptr->videosink), "fullscreen-overlay", FALSE, NULL);
+    } else if (cmn_param->driver_type == DP) {
+      g_object_set (G_OBJECT (play_ptr->videosink), "bus-id",                DP_BUS_ID, NULL);
+    } else if (cmn_param->driver_type == HDMI_Tx || cmn_param->driver_type == SDI_Tx) {
+      g_object_set (G_OBJECT (play_ptr->videosink), "bus-id",                MIXER_BUS_ID, NULL);
+    }
+    g_object_set (G_OBJECT (play_ptr->fpsdisplaysink), "video-sink",         play_ptr->videosink, NULL);
+}
+
+
 VGST_ERROR_LOG
 create_pipeline (vgst_ip_params *ip_param, vgst_enc_params *enc_param, vgst_playback *play_ptr, guint sink_type, gchar *uri, vgst_sdx_filter_params *filter_param) {
 	printf("create_pipeline: 1\n"); fflush(stdout);
@@ -121,10 +181,7 @@ create_pipeline (vgst_ip_params *ip_param, vgst_enc_params *enc_param, vgst_play
     }
 
     if (!ip_param->raw && (ip_param->filter_type == SDX_FILTER)) {
-       play_ptr->videofilter = gst_element_factory_make (filter_param->filter_name, NULL);
-		if ( !strcmp (filter_param->filter_name, "sdxfilter2d")) {
-			g_object_set (G_OBJECT (play_ptr->videofilter), "filter-kernel", "filter2d_pl_accel", NULL );
-		}
+      play_ptr->videofilter = make_videofilter (play_ptr, filter_param);
       if (!play_ptr->videofilter) {
         GST_ERROR ("FAILED to create videofilter elements");
         return VGST_ERROR_PIPELINE_CREATE_FAIL;
@@ -167,19 +224,6 @@ fetch_tag (const GstTagList * list, const gchar * tag, gpointer user_data) {
 }
 
 
-
-
-void
-on_fps_measurement (GstElement *fps,
-        gdouble fps_value,
-        gdouble drop_rate,
-        gdouble avg_rate,
-        gpointer   data) {
-    guint *fps_num = (guint *)data;
-    *fps_num = round(fps_value);
-}
-
-
 void
 set_property (vgst_application *app, gint index) {
     vgst_ip_params *ip_param = &app->ip_params[index];
@@ -204,7 +248,7 @@ set_property (vgst_application *app, gint index) {
         gst_util_set_object_arg (G_OBJECT(play_ptr->ip_src), "src-type", vgst_get_srctype(ip_param->device_type));
       else
         g_object_set (G_OBJECT(play_ptr->ip_src), "device", vlib_get_devname(ip_param->device_type), NULL);
-      if ((ip_param->filter_type == SDX_FILTER) && !ip_param->raw) {
+      if ((ip_param->filter_type == SDX_FILTER) && !ip_param->raw && !play_ptr->swfilter) {
         g_object_set (G_OBJECT (play_ptr->videofilter),  "filter-mode",       filter_param->filter_mode, NULL );
       }
       if ((ip_param->filter_type != SDX_FILTER) && !ip_param->raw) {
@@ -247,19 +291,7 @@ set_property (vgst_application *app, gint index) {
       }
     }
     if (ip_param->filter_type == SDX_FILTER) {
-	srcCaps = gst_caps_new_full (
-		gst_structure_new ("video/x-raw",
-                           "width",     G_TYPE_INT,        ip_param->width,
-                           "height",    G_TYPE_INT,        ip_param->height,
-                           "format",    G_TYPE_STRING,     ip_param->format_str,
-                           "framerate", GST_TYPE_FRACTION, cmn_param->frame_rate, MAX_FRAME_RATE_DENOM,
-                           NULL),
-                gst_structure_new ("video/x-raw",
-			   "width",     G_TYPE_INT,        ip_param->width,
-			   "height",    G_TYPE_INT,        ip_param->height,
-			   "format",    G_TYPE_STRING,     ip_param->format_str,
-			   NULL),
-		NULL);
+      srcCaps = make_sdx_src_caps (ip_param, cmn_param);
     }
     if (ip_param->filter_type != SDX_FILTER) {
       gchar * format;
@@ -284,7 +316,7 @@ set_property (vgst_application *app, gint index) {
 
     if ((ip_param->filter_type == SDX_FILTER) && !g_strcmp0 (ip_param->src, FILE_SRC_NAME)) {
       g_object_set (G_OBJECT(play_ptr->ip_src), "location", ip_param->uri, NULL);
-      if (!ip_param->raw) {
+      if (!ip_param->raw && !play_ptr->swfilter) {
         g_object_set (G_OBJECT (play_ptr->videofilter),  "filter-mode", filter_param->filter_mode, NULL );
       }
     }
@@ -293,22 +325,7 @@ set_property (vgst_application *app, gint index) {
       g_object_set (G_OBJECT (play_ptr->videosink), "location",    op_param->file_out, NULL);
       g_object_set (G_OBJECT (play_ptr->ip_src),    "num-buffers", op_param->duration*cmn_param->frame_rate*GST_MINUTE, NULL);
     } else if (cmn_param->sink_type == DISPLAY) {
-      g_object_set (G_OBJECT (play_ptr->fpsdisplaysink), "fps-update-interval",     FPS_UPDATE_INTERVAL, NULL);
-      g_object_set (G_OBJECT (play_ptr->fpsdisplaysink), "signal-fps-measurements", TRUE, NULL);
-      g_object_set (G_OBJECT (play_ptr->fpsdisplaysink), "text-overlay",            FALSE, NULL);
-      if (ip_param->filter_type == SDX_FILTER)
-        g_object_set (G_OBJECT (play_ptr->fpsdisplaysink), "sync",                    FALSE, NULL);
-      if (!g_strcmp0 (KMS_SINK_NAME, XLNX_KMS_SINK_NAME)) {
-        gst_util_set_object_arg (G_OBJECT(play_ptr->videosink), "sink-type", vgst_get_sinkname(cmn_param->driver_type));
-        g_object_set (G_OBJECT (play_ptr->videosink), "fullscreen-overlay", FALSE, NULL);
-      } else if (cmn_param->driver_type == DP) {
-        g_object_set (G_OBJECT (play_ptr->videosink), "bus-id",                DP_BUS_ID, NULL);
-      } else if (cmn_param->driver_type == HDMI_Tx || cmn_param->driver_type == SDI_Tx) {
-        g_object_set (G_OBJECT (play_ptr->videosink), "bus-id",                MIXER_BUS_ID, NULL);
-      }
-      g_object_set (G_OBJECT (play_ptr->fpsdisplaysink), "video-sink",         play_ptr->videosink, NULL);
-      g_signal_connect (play_ptr->fpsdisplaysink,        "fps-measurements",   G_CALLBACK (on_fps_measurement), &play_ptr->fps_num[0]);
-      cmn_param->plane_id++;
+      set_display_property (play_ptr, ip_param, cmn_param);
     } else if (cmn_param->sink_type == STREAM) {
       g_object_set (G_OBJECT (play_ptr->mpegtsmux), "alignment",     PKT_NUMBER_PER_BUFFER, NULL);
       g_object_set (G_OBJECT (play_ptr->stream_sink), "host",        op_param->host_ip, NULL);
@@ -350,70 +367,32 @@ on_pad_added (GstElement *element,
 
 VGST_ERROR_LOG
 link_streaming_pipeline (vgst_playback *play_ptr) {
-    gint ret = VGST_SUCCESS;
-
-    if (!gst_element_link_many (play_ptr->ip_src, play_ptr->srccapsfilter, play_ptr->videoenc, play_ptr->enccapsfilter, \
-                                play_ptr->mpegtsmux, play_ptr->rtppay, play_ptr->enc_queue, play_ptr->stream_sink, NULL)) {
-      GST_ERROR ("Error linking for ip_src --> srccapsfilter --> videoenc --> enccapsfilter --> mpegtsmux --> rtppay --> enc_queue --> stream_sink");
-      ret = VGST_ERROR_PIPELINE_LINKING_FAIL;
-    } else {
-      GST_DEBUG ("Linked for ip_src --> srccapsfilter --> videoenc --> enccapsfilter --> mpegtsmux --> rtppay --> enc_queue --> stream_sink successfully");
-    }
+    const vgst_graph *graph = vgst_graph_get (VGST_GRAPH_VCU_STREAM);
 
-    return ret;
+    if (!graph)
+      return VGST_ERROR_PIPELINE_LINKING_FAIL;
+    return vgst_graph_instantiate (graph, play_ptr);
 }
 
 
 VGST_ERROR_LOG
 link_elements (vgst_ip_params *ip_param, vgst_playback *play_ptr, gint sink_type, gint latency_mode) {
+    const vgst_graph *graph;
+    gint topology;
+
     if ((ip_param->filter_type != SDX_FILTER) && (FILE_SRC == ip_param->src_type || STREAMING_SRC == ip_param->src_type)) {
       g_object_set (G_OBJECT(play_ptr->ip_src), "uri", ip_param->uri, NULL);
       g_signal_connect (play_ptr->ip_src, "pad-added", G_CALLBACK (on_pad_added), play_ptr);
       return VGST_SUCCESS;
     }
 
-    if (ip_param->raw == FALSE && (ip_param->filter_type == SDX_FILTER)) {
-      if (sink_type == DISPLAY) {
-        if (!gst_element_link_many (play_ptr->ip_src, play_ptr->srccapsfilter, play_ptr->videofilter, play_ptr->fpsdisplaysink, NULL)) {
-          GST_ERROR ("Error linking for ip_src --> capsfilter --> videofilter --> fpsdisplaysink");
-          return VGST_ERROR_PIPELINE_LINKING_FAIL;
-        } else {
-          GST_DEBUG ("Linked for ip_src --> capsfilter --> videofilter --> queue --> fpsdisplaysink successfully");
-        }
-      }
-    } else if (ip_param->raw == FALSE) {
-      if (sink_type == DISPLAY) {
-        {
-          if (!gst_element_link_many (play_ptr->ip_src, play_ptr->srccapsfilter, play_ptr->videoenc, play_ptr->enccapsfilter, play_ptr->enc_queue,
-                                      play_ptr->videodec, play_ptr->queue, play_ptr->fpsdisplaysink, NULL)) {
-            GST_ERROR ("Error linking for ip_src --> capsfilter --> videoenc --> enccapsfilter --> queue --> videodec --> queue --> fpsdisplaysink");
-            return VGST_ERROR_PIPELINE_LINKING_FAIL;
-          } else {
-            GST_DEBUG ("Linked for ip_src --> capsfilter --> videoenc --> enccapsfilter --> queue --> videodec --> queue --> fpsdisplaysink successfully");
-          }
-        }
-      } else if (sink_type == STREAM) {
-        if ( VGST_SUCCESS != link_streaming_pipeline (play_ptr) )
-          return VGST_ERROR_PIPELINE_LINKING_FAIL;
-      } else if (sink_type == RECORD) {
-        if (!gst_element_link_many (play_ptr->ip_src, play_ptr->srccapsfilter, play_ptr->videoenc, play_ptr->enc_queue, play_ptr->enccapsfilter,
-                                    play_ptr->videoparser, play_ptr->mux, play_ptr->videosink, NULL)) {
-          GST_ERROR ("Error linking for ip_src --> capsfilter --> videoenc --> queue --> capsfilter --> videoparser --> mux --> videosink");
-          return VGST_ERROR_PIPELINE_LINKING_FAIL;
-        } else {
-          GST_DEBUG ("Linked for ip_src --> capsfilter --> videoenc --> queue --> capsfilter --> videoparser --> mux --> videosink successfully");
-        }
-      }
-    } else {
-      // It Comes here means need to use raw path means src --> sink path
-      if (!gst_element_link_many (play_ptr->ip_src, play_ptr->srccapsfilter, play_ptr->fpsdisplaysink, NULL)) {
-        GST_ERROR ("Error linking for testsrc --> capsfilter --> fpsdisplaysink");
-        return VGST_ERROR_PIPELINE_LINKING_FAIL;
-      } else {
-        GST_DEBUG ("Linked for ip_src --> capsfilter --> fpsdisplaysink successfully");
-      }
-    }
-    return VGST_SUCCESS;
+    topology = vgst_graph_select (ip_param, sink_type);
+    if (topology < 0)
+      return VGST_SUCCESS;
+    graph = vgst_graph_get (topology);
+    if (!graph)
+      return VGST_ERROR_PIPELINE_LINKING_FAIL;
+    return vgst_graph_instantiate (graph, play_ptr);
 }
 
 
@@ -433,3 +412,90 @@ get_coordinates (guint *x, guint *y, guint cnt) {
       *y = 1080;
     }
 }
+
+
+VGST_ERROR_LOG
+create_switcher_pipeline (vgst_ip_params *ip_param, vgst_cmn_params *cmn_param, vgst_playback *play_ptr,
+                          vgst_sdx_filter_params *filter_param, const size_t *vsrc, guint num_vsrc) {
+    GstElement *src, *capsfilter, *queue;
+    GstCaps *srcCaps;
+    guint i;
+
+    if (!num_vsrc || num_vsrc > MAX_SRC_NUM) {
+      GST_ERROR ("Source count is invalid");
+      return VGST_ERROR_SRC_COUNT_INVALID;
+    }
+
+    play_ptr->pipeline        = gst_pipeline_new ("vcu-trd-switcher");
+    play_ptr->selector        = gst_element_factory_make (INPUT_SELECTOR_NAME, NULL);
+    play_ptr->videosink       = gst_element_factory_make (KMS_SINK_NAME,       NULL);
+    play_ptr->fpsdisplaysink  = gst_element_factory_make ("fpsdisplaysink",    NULL);
+    if (!play_ptr->pipeline || !play_ptr->selector || !play_ptr->videosink || !play_ptr->fpsdisplaysink) {
+      GST_ERROR ("FAILED to create switcher elements");
+      return VGST_ERROR_PIPELINE_CREATE_FAIL;
+    }
+    gst_bin_add_many (GST_BIN(play_ptr->pipeline), play_ptr->selector, play_ptr->fpsdisplaysink, NULL);
+    /* inactive inputs drop their buffers right away, the sink only ever
+     * sees the active one */
+    g_object_set (G_OBJECT (play_ptr->selector), "sync-streams", FALSE, NULL);
+    g_object_set (G_OBJECT (play_ptr->selector), "cache-buffers", FALSE, NULL);
+
+    if (!ip_param->raw) {
+      play_ptr->videofilter = make_videofilter (play_ptr, filter_param);
+      if (!play_ptr->videofilter) {
+        GST_ERROR ("FAILED to create videofilter elements");
+        return VGST_ERROR_PIPELINE_CREATE_FAIL;
+      }
+      gst_bin_add (GST_BIN(play_ptr->pipeline), play_ptr->videofilter);
+      if (!play_ptr->swfilter)
+        g_object_set (G_OBJECT (play_ptr->videofilter), "filter-mode", filter_param->filter_mode, NULL);
+    }
+
+    /* every source is forced to the same caps so that switching never
+     * renegotiates the sink */
+    srcCaps = make_sdx_src_caps (ip_param, cmn_param);
+    for (i = 0; i < num_vsrc; i++) {
+      src        = gst_element_factory_make (V4L2_SRC_NAME, NULL);
+      capsfilter = gst_element_factory_make ("capsfilter",  NULL);
+      queue      = gst_element_factory_make ("queue",       NULL);
+      if (!src || !capsfilter || !queue) {
+        GST_ERROR ("FAILED to create switcher source elements");
+        gst_caps_unref (srcCaps);
+        return VGST_ERROR_PIPELINE_CREATE_FAIL;
+      }
+      gst_bin_add_many (GST_BIN(play_ptr->pipeline), src, capsfilter, queue, NULL);
+      g_object_set (G_OBJECT (src), "io-mode", ip_param->raw ? VGST_V4L2_IO_MODE_DMABUF_EXPORT : ip_param->io_mode, NULL);
+      if (!g_strcmp0 (V4L2_SRC_NAME, XLNX_V4L2_SRC_NAME))
+        gst_util_set_object_arg (G_OBJECT(src), "src-type", vgst_get_srctype(vsrc[i]));
+      else
+        g_object_set (G_OBJECT(src), "device", vlib_get_devname(vsrc[i]), NULL);
+      g_object_set (G_OBJECT (capsfilter), "caps", srcCaps, NULL);
+      /* keep inactive sources streaming without holding on to buffers */
+      g_object_set (G_OBJECT (queue), "max-size-buffers", SWITCHER_QUEUE_MAX_BUFFERS, NULL);
+      g_object_set (G_OBJECT (queue), "max-size-bytes", 0, NULL);
+      g_object_set (G_OBJECT (queue), "max-size-time", (guint64) 0, NULL);
+      gst_util_set_object_arg (G_OBJECT (queue), "leaky", "downstream");
+
+      play_ptr->selector_pads[i] = gst_element_get_request_pad (play_ptr->selector, "sink_%u");
+      play_ptr->selector_vsrc[i] = vsrc[i];
+      play_ptr->num_selector_pads = i + 1;
+      if (!play_ptr->selector_pads[i] || !gst_element_link_many (src, capsfilter, queue, NULL) ||
+          !gst_element_link_pads (queue, "src", play_ptr->selector, GST_OBJECT_NAME (play_ptr->selector_pads[i]))) {
+        GST_ERROR ("Error linking for ip_src --> capsfilter --> queue --> input-selector");
+        gst_caps_unref (srcCaps);
+        return VGST_ERROR_PIPELINE_LINKING_FAIL;
+      }
+    }
+    gst_caps_unref (srcCaps);
+    play_ptr->ip_src = NULL;
+
+    set_display_property (play_ptr, ip_param, cmn_param);
+    cmn_param->plane_id++;
+    if (!gst_element_link_many (play_ptr->selector, play_ptr->videofilter ? play_ptr->videofilter : play_ptr->fpsdisplaysink,
+                                play_ptr->videofilter ? play_ptr->fpsdisplaysink : NULL, NULL)) {
+      GST_ERROR ("Error linking for input-selector --> videofilter --> fpsdisplaysink");
+      return VGST_ERROR_PIPELINE_LINKING_FAIL;
+    }
+    GST_DEBUG ("Linked %u sources --> input-selector --> fpsdisplaysink successfully", num_vsrc);
+    return VGST_SUCCESS;
+}
@@ -40,6 +40,7 @@
 #include <vgst_utils.h>
 #include "vgst_lib.h"
 #include "vgst_sdxfilter2d.h"
+#include "filter2d_sw.h"
 
 extern vgst_application app;
 
@@ -109,9 +110,6 @@ const coeff_t coeff_sobel_v = {
   {1, 0, -1}
 };
 
-/* store current coefficients */
-static coeff_t coeff_cur;
-
 static struct
 {
   filter2d_preset preset;
@@ -132,6 +130,153 @@ static struct
   FILTER2D_PRESET_SOBEL_V, "Sobel Vertical", &coeff_sobel_v}
 };
 
+/*
+ * Push coefficients to the hardware filter element, as a GValue array of
+ * arrays so nothing is formatted into a string and parsed back. Elements
+ * whose property is not a GstValueArray still get the serialized string.
+ */
+static void
+filter2d_apply_coeff (const short *coeff)
+{
+  vgst_ip_params *ip_param = app.ip_params;
+  GValue matrix = G_VALUE_INIT;
+  GValue tap = G_VALUE_INIT;
+  GParamSpec *pspec;
+  unsigned int row;
+  unsigned int col;
+
+  if (!ip_param || ip_param->raw || (ip_param->filter_type != SDX_FILTER)
+      || !app.playback->videofilter || app.playback->swfilter)
+    return;
+
+  pspec = g_object_class_find_property (G_OBJECT_GET_CLASS
+      (app.playback->videofilter), "coefficients");
+  if (!pspec)
+    return;
+  if (G_PARAM_SPEC_VALUE_TYPE (pspec) != GST_TYPE_ARRAY) {
+    gchar *str = g_strdup_printf
+        ("< < %d, %d, %d >, < %d, %d, %d >, < %d, %d, %d > >",
+        coeff[0], coeff[1], coeff[2], coeff[3], coeff[4], coeff[5],
+        coeff[6], coeff[7], coeff[8]);
+    gst_util_set_object_arg (G_OBJECT (app.playback->videofilter),
+        "coefficients", str);
+    g_free (str);
+    return;
+  }
+
+  g_value_init (&matrix, GST_TYPE_ARRAY);
+  g_value_init (&tap, G_TYPE_INT);
+  for (row = 0; row < KSIZE; row++) {
+    GValue taps = G_VALUE_INIT;
+
+    g_value_init (&taps, GST_TYPE_ARRAY);
+    for (col = 0; col < KSIZE; col++) {
+      g_value_set_int (&tap, coeff[row * KSIZE + col]);
+      gst_value_array_append_value (&taps, &tap);
+    }
+    gst_value_array_append_and_take_value (&matrix, &taps);
+  }
+  g_object_set_property (G_OBJECT (app.playback->videofilter),
+      "coefficients", &matrix);
+  g_value_unset (&tap);
+  g_value_unset (&matrix);
+}
+
+/**
+ * filter2d_set_coeff_bin - set 3x3 coefficients of a running filter
+ * @fs: Pointer to filter struct
+ * @coeff: KSIZE * KSIZE coefficients, row major
+ *
+ * Safe to call from any thread at any rate. The software engine picks the
+ * new kernel up at the start of its next frame, never in the middle of one.
+ */
+void
+filter2d_set_coeff_bin (struct filter_s *fs, const short *coeff)
+{
+  coeff_t c;
+
+  memcpy (c, coeff, sizeof c);
+  filter2d_apply_coeff (coeff);
+
+  /* keep the native software engine in sync, generic kernel */
+  filter2d_sw_set_coeff (fs, c);
+}
+
+void
+filter2d_set_coeff (struct filter_s *fs, const coeff_t coeff)
+{
+  filter2d_set_coeff_bin (fs, &coeff[0][0]);
+}
+
+/*
+ * Push the output stage to the hardware filter element. The coefficients
+ * property only carries the 3x3 taps, so the stage goes through separate
+ * properties on elements that have them.
+ */
+static void
+filter2d_apply_norm (const filter2d_norm * norm)
+{
+  vgst_ip_params *ip_param = app.ip_params;
+  GObjectClass *klass;
+  GstElement *filter;
+
+  if (!ip_param || ip_param->raw || (ip_param->filter_type != SDX_FILTER)
+      || !app.playback->videofilter || app.playback->swfilter)
+    return;
+
+  filter = app.playback->videofilter;
+  klass = G_OBJECT_GET_CLASS (filter);
+  if (g_object_class_find_property (klass, "shift")
+      && g_object_class_find_property (klass, "offset")) {
+    g_object_set (G_OBJECT (filter), "shift", norm->shift, "offset",
+        norm->offset, NULL);
+  } else if (norm->shift || norm->offset) {
+    GST_WARNING ("%s has no shift/offset, output stage ignored",
+        GST_ELEMENT_NAME (filter));
+  }
+
+  if (g_object_class_find_property (klass, "saturation-mode")) {
+    g_object_set (G_OBJECT (filter), "saturation-mode", norm->sat_mode, NULL);
+  } else if (norm->sat_mode != FILTER2D_SAT_CLAMP) {
+    GST_WARNING ("%s has no saturation-mode, output clamped",
+        GST_ELEMENT_NAME (filter));
+  }
+}
+
+int
+filter2d_set_norm (struct filter_s *fs, const filter2d_norm * norm)
+{
+  static const filter2d_norm norm_none;
+  int ret;
+
+  if (!norm)
+    norm = &norm_none;
+
+  ret = filter2d_sw_set_norm (fs, norm);
+  if (ret != VLIB_SUCCESS) {
+    GST_ERROR ("invalid output stage shift %u offset %d", norm->shift,
+        norm->offset);
+    return ret;
+  }
+  filter2d_apply_norm (norm);
+
+  return VLIB_SUCCESS;
+}
+
+int
+filter2d_set_coeff_norm (struct filter_s *fs, const coeff_t coeff,
+    const filter2d_norm * norm)
+{
+  int ret;
+
+  ret = filter2d_set_norm (fs, norm);
+  if (ret != VLIB_SUCCESS)
+    return ret;
+  filter2d_set_coeff (fs, coeff);
+
+  return VLIB_SUCCESS;
+}
+
 void
 filter2d_set_preset_coeff (struct filter_s *fs, filter2d_preset preset)
 {
@@ -139,7 +284,9 @@ filter2d_set_preset_coeff (struct filter_s *fs, filter2d_preset preset)
 
   for (i = 0; i < ARRAY_SIZE (filter2d_presets); ++i) {
     if (filter2d_presets[i].preset == preset) {
-      filter2d_set_coeff (fs, *filter2d_presets[i].coeff);
+      filter2d_apply_coeff (&(*filter2d_presets[i].coeff)[0][0]);
+      /* software engine runs the kernel specialized for this preset */
+      filter2d_sw_set_preset (fs, preset, *filter2d_presets[i].coeff);
     }
   }
 }
@@ -157,49 +304,316 @@ filter2d_get_preset_name (filter2d_preset preset)
   return NULL;
 }
 
+/*
+ * Legacy entry point, the returned storage belongs to fs and follows its
+ * coefficient updates. Use filter2d_copy_coeff when another thread may
+ * load coefficients at the same time.
+ */
+coeff_t *
+filter2d_get_coeff (struct filter_s *fs)
+{
+  return filter2d_sw_coeff (fs);
+}
+
+int
+filter2d_copy_coeff (struct filter_s *fs, coeff_t coeff)
+{
+  return filter2d_sw_get_coeff (fs, coeff);
+}
+
+const coeff_t *
+filter2d_get_preset_coeff (filter2d_preset preset)
+{
+  unsigned int i;
+
+  for (i = 0; i < ARRAY_SIZE (filter2d_presets); ++i) {
+    if (filter2d_presets[i].preset == preset)
+      return filter2d_presets[i].coeff;
+  }
+
+  return NULL;
+}
+
 void
-filter2d_set_coeff (struct filter_s *fs, const coeff_t coeff)
+filter2d_kernel_from_coeff (filter2d_kernel * kernel, const coeff_t coeff)
 {
-  vgst_ip_params *ip_param = app.ip_params;
   unsigned int row;
   unsigned int col;
-  char tmp_str[256];
-  gchar *matrix;
-
-  /* set the coefficients */
-  sprintf (tmp_str, "< < %d, %d, %d >, < %d, %d, %d>, < %d, %d, %d> >",
-      coeff[0][0], coeff[0][1], coeff[0][2],
-      coeff[1][0], coeff[1][1], coeff[1][2],
-      coeff[2][0], coeff[2][1], coeff[2][2]);
-  matrix = g_strdup (tmp_str);
-  if (ip_param && (!ip_param->raw) && (ip_param->filter_type == SDX_FILTER)) {
-    gst_util_set_object_arg (G_OBJECT (app.playback->videofilter),
-        "coefficients", matrix);
-  }
 
-  /* store new values */
+  memset (kernel, 0, sizeof *kernel);
+  kernel->ksize = KSIZE;
   for (row = 0; row < KSIZE; row++)
     for (col = 0; col < KSIZE; col++)
-      coeff_cur[row][col] = coeff[row][col];
+      kernel->coeff[row][col] = coeff[row][col];
+}
+
+void
+filter2d_set_kernel (struct filter_s *fs, const filter2d_kernel * kernel)
+{
+  vgst_ip_params *ip_param = app.ip_params;
+  unsigned int row;
+  unsigned int col;
+  coeff_t coeff;
 
-  g_free (matrix);
+  if (kernel->ksize == KSIZE) {
+    for (row = 0; row < KSIZE; row++)
+      for (col = 0; col < KSIZE; col++)
+        coeff[row][col] = kernel->coeff[row][col];
+    filter2d_set_coeff (fs, coeff);
+    return;
+  }
+
+  if (ip_param && (!ip_param->raw) && (ip_param->filter_type == SDX_FILTER)
+      && app.playback->videofilter && !app.playback->swfilter) {
+    GST_WARNING ("%dx%d kernel is only supported by the software filter",
+        kernel->ksize, kernel->ksize);
+  }
+
+  if (filter2d_sw_set_kernel (fs, kernel))
+    GST_ERROR ("invalid %dx%d kernel", kernel->ksize, kernel->ksize);
 }
 
-coeff_t *
-filter2d_get_coeff (struct filter_s *fs)
+/*
+ * Compose two successive filters into one kernel. Running first and then
+ * second equals a single pass with the full 2D convolution of both
+ * kernels, except for intermediate results the first pass would have
+ * clamped to 0..255 and for border pixels.
+ */
+int
+filter2d_fuse_kernels (const filter2d_kernel * first,
+    const filter2d_kernel * second, filter2d_kernel * fused)
 {
-  return &coeff_cur;
+  int acc[KSIZE_MAX][KSIZE_MAX] = { {0} };
+  int ksize, i, j, m, n;
+
+  if (!first || !second || !fused)
+    return VLIB_ERROR_INVALID_PARAM;
+
+  ksize = first->ksize + second->ksize - 1;
+  if (ksize > KSIZE_MAX)
+    return VLIB_ERROR_NOT_SUPPORTED;
+
+  for (i = 0; i < first->ksize; i++)
+    for (j = 0; j < first->ksize; j++)
+      for (m = 0; m < second->ksize; m++)
+        for (n = 0; n < second->ksize; n++)
+          acc[i + m][j + n] += first->coeff[i][j] * second->coeff[m][n];
+
+  memset (fused, 0, sizeof *fused);
+  fused->ksize = ksize;
+  for (i = 0; i < ksize; i++) {
+    for (j = 0; j < ksize; j++) {
+      if (acc[i][j] < G_MINSHORT || acc[i][j] > G_MAXSHORT)
+        return VLIB_ERROR_NOT_SUPPORTED;
+      fused->coeff[i][j] = acc[i][j];
+    }
+  }
+
+  return VLIB_SUCCESS;
 }
 
-const coeff_t *
-filter2d_get_preset_coeff (filter2d_preset preset)
+/*
+ * Coefficient schedule. Keyframes are evaluated in a buffer probe in front
+ * of the filter, in the streaming thread, so every frame gets exactly the
+ * coefficients of its own timestamp without the application having to
+ * call in per frame. The keyframes hang off the filter object, every pad
+ * they are attached to runs its own timeline through them.
+ */
+typedef struct
+{
+  filter2d_keyframe *keys;
+  guint num_keys;
+  filter2d_schedule_unit unit;
+  gboolean interpolate;
+  gboolean loop;
+  /* changes with every filter2d_set_schedule, restarts the timelines */
+  guint epoch;
+} filter2d_schedule;
+
+/* Timeline of one attached pad, released with its probe */
+typedef struct
 {
+  struct filter_s *fs;
+  guint epoch;
+  /* origin of the timeline, set by the first frame */
+  gboolean started;
+  GstClockTime start_pts;
+  guint64 frame;
+  /* last coefficients applied */
+  gboolean applied;
+  coeff_t coeff;
+} filter2d_timeline;
+
+/* Guards fs->schedule of every filter */
+static GMutex schedule_lock;
+static guint schedule_epoch;
+
+int
+filter2d_set_schedule (struct filter_s *fs, const filter2d_keyframe * keys,
+    unsigned int num_keys, filter2d_schedule_unit unit, int interpolate,
+    int loop)
+{
+  filter2d_schedule *schedule;
+  filter2d_keyframe *copy;
   unsigned int i;
 
-  for (i = 0; i < ARRAY_SIZE (filter2d_presets); ++i) {
-    if (filter2d_presets[i].preset == preset)
-      return filter2d_presets[i].coeff;
+  if (!fs || !keys || !num_keys)
+    return VLIB_ERROR_INVALID_PARAM;
+  for (i = 1; i < num_keys; i++) {
+    if (keys[i].pos <= keys[i - 1].pos) {
+      GST_ERROR ("schedule keyframes must have increasing positions");
+      return VLIB_ERROR_INVALID_PARAM;
+    }
   }
 
-  return NULL;
+  copy = g_malloc (num_keys * sizeof *keys);
+  memcpy (copy, keys, num_keys * sizeof *keys);
+  g_mutex_lock (&schedule_lock);
+  schedule = fs->schedule;
+  if (!schedule) {
+    schedule = g_new0 (filter2d_schedule, 1);
+    fs->schedule = schedule;
+  }
+  g_free (schedule->keys);
+  schedule->keys = copy;
+  schedule->num_keys = num_keys;
+  schedule->unit = unit;
+  schedule->interpolate = interpolate;
+  schedule->loop = loop && num_keys > 1;
+  schedule->epoch = ++schedule_epoch;
+  g_mutex_unlock (&schedule_lock);
+
+  /* frames until the pipeline runs start with the first keyframe */
+  filter2d_set_coeff (fs, keys[0].coeff);
+
+  return VLIB_SUCCESS;
+}
+
+void
+filter2d_clear_schedule (struct filter_s *fs)
+{
+  filter2d_schedule *schedule;
+
+  if (!fs)
+    return;
+
+  g_mutex_lock (&schedule_lock);
+  schedule = fs->schedule;
+  fs->schedule = NULL;
+  g_mutex_unlock (&schedule_lock);
+
+  if (schedule) {
+    g_free (schedule->keys);
+    g_free (schedule);
+  }
+}
+
+/* Coefficients at pos, schedule_lock held */
+static void
+filter2d_schedule_eval (const filter2d_schedule * schedule, guint64 pos,
+    coeff_t coeff)
+{
+  const filter2d_keyframe *keys = schedule->keys;
+  guint last = schedule->num_keys - 1;
+  const filter2d_keyframe *a;
+  const filter2d_keyframe *b;
+  gdouble t;
+  guint i;
+  guint k;
+
+  if (pos < keys[0].pos) {
+    pos = keys[0].pos;
+  } else if (schedule->loop) {
+    pos = keys[0].pos + (pos - keys[0].pos) % (keys[last].pos - keys[0].pos);
+  }
+
+  for (i = 0; i < last && keys[i + 1].pos <= pos; i++);
+  a = &keys[i];
+  if (i == last || !schedule->interpolate) {
+    memcpy (coeff, a->coeff, sizeof (coeff_t));
+    return;
+  }
+
+  b = &keys[i + 1];
+  t = (gdouble) (pos - a->pos) / (b->pos - a->pos);
+  for (k = 0; k < KSIZE * KSIZE; k++) {
+    gdouble c0 = a->coeff[k / KSIZE][k % KSIZE];
+    gdouble c1 = b->coeff[k / KSIZE][k % KSIZE];
+    gdouble v = c0 + (c1 - c0) * t;
+
+    coeff[k / KSIZE][k % KSIZE] = (short) (v < 0 ? v - 0.5 : v + 0.5);
+  }
+}
+
+static GstPadProbeReturn
+filter2d_schedule_probe (GstPad * pad, GstPadProbeInfo * info, gpointer data)
+{
+  filter2d_timeline *timeline = data;
+  filter2d_schedule *schedule;
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstClockTime pts = GST_BUFFER_PTS (buf);
+  gboolean changed = FALSE;
+  guint64 pos;
+  coeff_t coeff;
+
+  g_mutex_lock (&schedule_lock);
+  schedule = timeline->fs->schedule;
+  if (!schedule) {
+    g_mutex_unlock (&schedule_lock);
+    return GST_PAD_PROBE_OK;
+  }
+
+  if (timeline->epoch != schedule->epoch) {
+    timeline->epoch = schedule->epoch;
+    timeline->started = FALSE;
+    timeline->frame = 0;
+    timeline->applied = FALSE;
+  }
+
+  if (schedule->unit == FILTER2D_SCHEDULE_FRAME) {
+    pos = timeline->frame++;
+  } else if (GST_CLOCK_TIME_IS_VALID (pts)) {
+    if (!timeline->started || pts < timeline->start_pts) {
+      timeline->start_pts = pts;
+      timeline->started = TRUE;
+    }
+    pos = pts - timeline->start_pts;
+  } else {
+    g_mutex_unlock (&schedule_lock);
+    return GST_PAD_PROBE_OK;
+  }
+
+  filter2d_schedule_eval (schedule, pos, coeff);
+  if (!timeline->applied || memcmp (coeff, timeline->coeff, sizeof coeff)) {
+    memcpy (timeline->coeff, coeff, sizeof coeff);
+    timeline->applied = TRUE;
+    changed = TRUE;
+  }
+  g_mutex_unlock (&schedule_lock);
+
+  if (changed)
+    filter2d_set_coeff_bin (timeline->fs, &coeff[0][0]);
+
+  return GST_PAD_PROBE_OK;
+}
+
+void
+filter2d_schedule_attach (GstElement * filter, struct filter_s *fs)
+{
+  filter2d_timeline *timeline;
+  GstPad *pad;
+
+  if (!filter || !fs)
+    return;
+
+  /* the probe must run ahead of the software filter probe on this pad,
+   * so it has to be attached first */
+  pad = gst_element_get_static_pad (filter, "sink");
+  if (!pad)
+    return;
+  timeline = g_new0 (filter2d_timeline, 1);
+  timeline->fs = fs;
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, filter2d_schedule_probe,
+      timeline, g_free);
+  gst_object_unref (pad);
 }
@@ -38,6 +38,7 @@
  *******************************************************************************/
 
 #include "vgst_pipeline.h"
+#include "vgst_graph.h"
 
 VGST_ERROR_LOG
 create_split_pipeline (vgst_ip_params *ip_param, vgst_enc_params *enc_param, vgst_playback *play_ptr) {
@@ -146,85 +147,32 @@ set_split_screen_property (vgst_application *app, gint index) {
     g_object_set (G_OBJECT (play_ptr->srccapsfilter),  "caps",  srcCaps, NULL);
     gst_caps_unref (srcCaps);
 
-    if (play_ptr->queue) {
-      g_object_set (G_OBJECT (play_ptr->queue), "max-size-bytes", 0, NULL);
-    }
-    if (play_ptr->enc_queue) {
-      g_object_set (G_OBJECT (play_ptr->enc_queue), "max-size-bytes", 0, NULL);
-    }
     g_object_set (G_OBJECT (play_ptr->fpsdisplaysink), "fps-update-interval",     FPS_UPDATE_INTERVAL, NULL);
-    g_object_set (G_OBJECT (play_ptr->fpsdisplaysink), "signal-fps-measurements", TRUE, NULL);
     g_object_set (G_OBJECT (play_ptr->fpsdisplaysink), "text-overlay",            FALSE, NULL);
     g_object_set (G_OBJECT (play_ptr->fpsdisplaysink), "video-sink",              play_ptr->videosink, NULL);
     g_object_set (G_OBJECT (play_ptr->videosink),      "bus-id",                  MIXER_BUS_ID, NULL);
     g_object_set (G_OBJECT (play_ptr->videosink),      "plane-id",                cmn_param->plane_id, NULL);
-    g_signal_connect (play_ptr->fpsdisplaysink,        "fps-measurements",        G_CALLBACK (on_fps_measurement), &play_ptr->fps_num[0]);
 
     cmn_param->plane_id++;
     g_object_set (G_OBJECT (play_ptr->fpsdisplaysink2), "fps-update-interval",     FPS_UPDATE_INTERVAL, NULL);
-    g_object_set (G_OBJECT (play_ptr->fpsdisplaysink2), "signal-fps-measurements", TRUE, NULL);
     g_object_set (G_OBJECT (play_ptr->fpsdisplaysink2), "text-overlay",            FALSE, NULL);
     g_object_set (G_OBJECT (play_ptr->fpsdisplaysink2), "video-sink",              play_ptr->videosink2, NULL);
     g_object_set (G_OBJECT (play_ptr->videosink2),      "bus-id",                  MIXER_BUS_ID, NULL);
     g_object_set (G_OBJECT (play_ptr->videosink2),      "plane-id",                cmn_param->plane_id, NULL);
-    g_signal_connect (play_ptr->fpsdisplaysink2,        "fps-measurements",        G_CALLBACK (on_fps_measurement), &play_ptr->fps_num[1]);
     cmn_param->plane_id++;
 }
 
 
 VGST_ERROR_LOG
 link_split_screen_elements (vgst_ip_params *ip_param, vgst_playback *play_ptr) {
-    gchar *name1 = NULL, *name2 = NULL;
-    gint ret = VGST_SUCCESS;
+    const vgst_graph *graph = vgst_graph_get (VGST_GRAPH_SPLIT_SCREEN);
+
+    if (!graph)
+      return VGST_ERROR_PIPELINE_LINKING_FAIL;
+    /* keep the tee pads so stop_pipeline can release them */
     if (play_ptr->tee) {
       play_ptr->pad = gst_element_get_request_pad(play_ptr->tee, "src_1");
-      name1 = gst_pad_get_name(play_ptr->pad);
       play_ptr->pad2 = gst_element_get_request_pad(play_ptr->tee, "src_2");
-      name2 = gst_pad_get_name(play_ptr->pad2);
-    }
-    if (!gst_element_link_many (play_ptr->ip_src, play_ptr->srccapsfilter, play_ptr->tee, NULL)) {
-      GST_ERROR ("Error linking for ip_src --> capsfilter --> tee");
-      ret = VGST_ERROR_PIPELINE_LINKING_FAIL;
-      goto CLEAN_UP;
-    } else {
-      GST_DEBUG ("Linked for ip_src --> capsfilter --> tee successfully");
-    }
-    if (!gst_element_link_pads(play_ptr->tee, name1, play_ptr->videoenc, "sink")) {
-      GST_ERROR ("Error linking for tee --> queue");
-      ret = VGST_ERROR_PIPELINE_LINKING_FAIL;
-      goto CLEAN_UP;
-    } else {
-      GST_DEBUG ("Linked for tee --> queue successfully");
-    }
-    if (!gst_element_link_pads(play_ptr->tee, name2, play_ptr->enc_queue, "sink")) {
-      GST_ERROR ("Error linking for tee --> enc_queue");
-      ret = VGST_ERROR_PIPELINE_LINKING_FAIL;
-      goto CLEAN_UP;
-    } else {
-      GST_DEBUG ("Linked for tee --> enc_queue successfully");
     }
-    if (!gst_element_link_many (play_ptr->enc_queue, play_ptr->fpsdisplaysink2, NULL)) {
-      GST_ERROR ("Error linking for enc_queue --> fpsdisplaysink2");
-      ret = VGST_ERROR_PIPELINE_LINKING_FAIL;
-      goto CLEAN_UP;
-    } else {
-      GST_DEBUG ("Linked for enc_queue --> fpsdisplaysink2 successfully");
-    }
-
-    if (!gst_element_link_many (play_ptr->videoenc, play_ptr->enccapsfilter, play_ptr->videodec, play_ptr->queue, play_ptr->fpsdisplaysink, NULL)) {
-      GST_ERROR ("Error linking for videoenc --> enccapsfilter --> videodec --> queue --> sink");
-      ret = VGST_ERROR_PIPELINE_LINKING_FAIL;
-      goto CLEAN_UP;
-    } else {
-      GST_DEBUG ("Linked for videoenc --> enccapsfilter --> videodec --> queue --> sink successfully");
-    }
-
-CLEAN_UP :
-    if (name1)
-      g_free (name1);
-    if (name2)
-      g_free (name2);
-
-    return ret;
+    return vgst_graph_instantiate (graph, play_ptr);
 }
-
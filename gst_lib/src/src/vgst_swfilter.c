@@ -0,0 +1,278 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+#include <linux/videodev2.h>
+#include <gst/video/video.h>
+#include <gst/video/gstvideopool.h>
+#include "vgst_swfilter.h"
+#include "vgst_latency.h"
+#include "video_trace.h"
+GST_DEBUG_CATEGORY_EXTERN (vgst_lib);
+#define GST_CAT_DEFAULT vgst_lib
+
+struct _vgst_swfilter {
+    struct filter_s    *fs;
+    guint              num_workers;
+    guint64            cpu_mask;
+    GstPad             *pad;
+    gulong             probe_id;
+    GstBufferPool      *pool;
+    GstVideoInfo       info;
+    gboolean           configured, bypass;
+    GstBuffer          *prev;
+    guint              frames;
+    gint64             busy_time;
+    guint              latency_index;
+};
+
+/* swfilters per filter_s, cached pipelines may share one with the running pipeline */
+static GHashTable *fs_users;
+static GMutex fs_users_lock;
+
+
+gboolean
+vgst_swfilter_supported (const struct filter_s *fs) {
+    return fs && fs->ops && (fs->ops->func || fs->ops->func2);
+}
+
+
+static void
+swfilter_reset (vgst_swfilter *sw) {
+    if (sw->pool) {
+      gst_buffer_pool_set_active (sw->pool, FALSE);
+      gst_object_unref (sw->pool);
+      sw->pool = NULL;
+    }
+    gst_buffer_replace (&sw->prev, NULL);
+    sw->frames = 0;
+    sw->busy_time = 0;
+    sw->configured = FALSE;
+    sw->bypass = FALSE;
+}
+
+
+static gboolean
+swfilter_configure (vgst_swfilter *sw, GstPad *pad) {
+    struct filter_init_data init_data;
+    GstStructure *config;
+    GstCaps *caps;
+
+    caps = gst_pad_get_current_caps (pad);
+    if (!caps)
+      return FALSE;
+    sw->configured = TRUE;
+    if (!gst_video_info_from_caps (&sw->info, caps) ||
+        GST_VIDEO_INFO_FORMAT (&sw->info) != GST_VIDEO_FORMAT_YUY2) {
+      GST_WARNING ("software filter supports YUY2 only, passing frames through");
+      sw->bypass = TRUE;
+      gst_caps_unref (caps);
+      return TRUE;
+    }
+
+    init_data.in_width = init_data.out_width = GST_VIDEO_INFO_WIDTH (&sw->info);
+    init_data.in_height = init_data.out_height = GST_VIDEO_INFO_HEIGHT (&sw->info);
+    init_data.in_fourcc = init_data.out_fourcc = V4L2_PIX_FMT_YUYV;
+    init_data.num_workers = sw->num_workers;
+    init_data.cpu_mask = sw->cpu_mask;
+    if (sw->fs->ops->init && sw->fs->ops->init (sw->fs, &init_data)) {
+      GST_ERROR ("%s software engine init failed", sw->fs->display_text);
+      sw->bypass = TRUE;
+      gst_caps_unref (caps);
+      return TRUE;
+    }
+
+    sw->pool = gst_video_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (sw->pool);
+    gst_buffer_pool_config_set_params (config, caps, GST_VIDEO_INFO_SIZE (&sw->info), VGST_SWFILTER_POOL_MIN, 0);
+    if (!gst_buffer_pool_set_config (sw->pool, config) || !gst_buffer_pool_set_active (sw->pool, TRUE)) {
+      GST_ERROR ("failed to activate software filter buffer pool");
+      gst_object_unref (sw->pool);
+      sw->pool = NULL;
+      sw->bypass = TRUE;
+    }
+    GST_DEBUG ("%s software engine configured for %dx%d", sw->fs->display_text,
+               GST_VIDEO_INFO_WIDTH (&sw->info), GST_VIDEO_INFO_HEIGHT (&sw->info));
+    gst_caps_unref (caps);
+    return TRUE;
+}
+
+
+static GstPadProbeReturn
+swfilter_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data) {
+    vgst_swfilter *sw = (vgst_swfilter *)data;
+    GstVideoFrame in_frame, out_frame, prev_frame;
+    GstBuffer *inbuf, *outbuf = NULL;
+    gint64 start, cost;
+
+    if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+      if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) == GST_EVENT_CAPS)
+        swfilter_reset (sw);
+      return GST_PAD_PROBE_OK;
+    }
+
+    if (!sw->configured && !swfilter_configure (sw, pad))
+      return GST_PAD_PROBE_OK;
+    if (sw->bypass)
+      return GST_PAD_PROBE_OK;
+
+    inbuf = GST_PAD_PROBE_INFO_BUFFER (info);
+    if (!sw->fs->ops->func && !sw->prev) {
+      /* two frame engine, first frame only primes the history */
+      sw->prev = gst_buffer_ref (inbuf);
+      return GST_PAD_PROBE_OK;
+    }
+    if (GST_FLOW_OK != gst_buffer_pool_acquire_buffer (sw->pool, &outbuf, NULL)) {
+      GST_WARNING ("no output buffer available, passing frame through");
+      return GST_PAD_PROBE_OK;
+    }
+    if (!gst_video_frame_map (&in_frame, &sw->info, inbuf, GST_MAP_READ)) {
+      gst_buffer_unref (outbuf);
+      return GST_PAD_PROBE_OK;
+    }
+    if (!gst_video_frame_map (&out_frame, &sw->info, outbuf, GST_MAP_WRITE)) {
+      gst_video_frame_unmap (&in_frame);
+      gst_buffer_unref (outbuf);
+      return GST_PAD_PROBE_OK;
+    }
+
+    /* filter_ops work on 16 bit YUYV pixels, strides are given in pixels */
+    start = g_get_monotonic_time ();
+    vlib_trace_begin ("swfilter");
+    if (sw->fs->ops->func) {
+      sw->fs->ops->func (sw->fs,
+                         GST_VIDEO_FRAME_PLANE_DATA (&in_frame, 0),
+                         GST_VIDEO_FRAME_PLANE_DATA (&out_frame, 0),
+                         GST_VIDEO_FRAME_HEIGHT (&in_frame), GST_VIDEO_FRAME_WIDTH (&in_frame),
+                         GST_VIDEO_FRAME_PLANE_STRIDE (&in_frame, 0) / 2,
+                         GST_VIDEO_FRAME_HEIGHT (&out_frame), GST_VIDEO_FRAME_WIDTH (&out_frame),
+                         GST_VIDEO_FRAME_PLANE_STRIDE (&out_frame, 0) / 2);
+    } else if (gst_video_frame_map (&prev_frame, &sw->info, sw->prev, GST_MAP_READ)) {
+      sw->fs->ops->func2 (sw->fs,
+                          GST_VIDEO_FRAME_PLANE_DATA (&prev_frame, 0),
+                          GST_VIDEO_FRAME_PLANE_DATA (&in_frame, 0),
+                          GST_VIDEO_FRAME_PLANE_DATA (&out_frame, 0),
+                          GST_VIDEO_FRAME_HEIGHT (&in_frame), GST_VIDEO_FRAME_WIDTH (&in_frame),
+                          GST_VIDEO_FRAME_PLANE_STRIDE (&in_frame, 0) / 2,
+                          GST_VIDEO_FRAME_HEIGHT (&out_frame), GST_VIDEO_FRAME_WIDTH (&out_frame),
+                          GST_VIDEO_FRAME_PLANE_STRIDE (&out_frame, 0) / 2);
+      gst_video_frame_unmap (&prev_frame);
+    }
+    vlib_trace_end ("swfilter");
+    cost = g_get_monotonic_time () - start;
+    vgst_latency_record (sw->latency_index, VGST_STAGE_ENGINE, cost);
+    sw->busy_time += cost;
+    if (++sw->frames == VGST_SWFILTER_FPS_FRAMES) {
+      GST_INFO ("%s software engine: %.1f fps", sw->fs->display_text,
+                sw->busy_time ? sw->frames * (gdouble) G_USEC_PER_SEC / sw->busy_time : 0.0);
+      sw->frames = 0;
+      sw->busy_time = 0;
+    }
+
+    gst_video_frame_unmap (&out_frame);
+    gst_video_frame_unmap (&in_frame);
+    gst_buffer_copy_into (outbuf, inbuf, GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+    if (!sw->fs->ops->func)
+      gst_buffer_replace (&sw->prev, inbuf);
+    gst_buffer_unref (inbuf);
+    GST_PAD_PROBE_INFO_DATA (info) = outbuf;
+    return GST_PAD_PROBE_OK;
+}
+
+
+vgst_swfilter *
+vgst_swfilter_attach (GstElement *element, vgst_sdx_filter_params *filter_param) {
+    struct filter_s *fs = filter_param->fs;
+    vgst_swfilter *sw;
+
+    if (!element || !vgst_swfilter_supported (fs))
+      return NULL;
+
+    sw = g_new0 (vgst_swfilter, 1);
+    sw->fs = fs;
+    sw->num_workers = filter_param->num_workers;
+    sw->cpu_mask = filter_param->cpu_mask;
+    sw->latency_index = G_MAXUINT;
+    sw->pad = gst_element_get_static_pad (element, "sink");
+    if (!sw->pad) {
+      GST_ERROR ("software filter element has no sink pad");
+      g_free (sw);
+      return NULL;
+    }
+    sw->probe_id = gst_pad_add_probe (sw->pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+                                      swfilter_probe, sw, NULL);
+    g_mutex_lock (&fs_users_lock);
+    if (!fs_users)
+      fs_users = g_hash_table_new (NULL, NULL);
+    g_hash_table_insert (fs_users, fs, GUINT_TO_POINTER (GPOINTER_TO_UINT (g_hash_table_lookup (fs_users, fs)) + 1));
+    g_mutex_unlock (&fs_users_lock);
+    GST_DEBUG ("%s running on native software engine", fs->display_text);
+    return sw;
+}
+
+
+void
+vgst_swfilter_set_latency_index (vgst_swfilter *sw, guint index) {
+    if (sw)
+      sw->latency_index = index;
+}
+
+
+void
+vgst_swfilter_free (vgst_swfilter *sw) {
+    guint users;
+
+    if (!sw)
+      return;
+    if (sw->pad) {
+      gst_pad_remove_probe (sw->pad, sw->probe_id);
+      gst_object_unref (sw->pad);
+    }
+    swfilter_reset (sw);
+    g_mutex_lock (&fs_users_lock);
+    users = GPOINTER_TO_UINT (g_hash_table_lookup (fs_users, sw->fs)) - 1;
+    if (users)
+      g_hash_table_insert (fs_users, sw->fs, GUINT_TO_POINTER (users));
+    else
+      g_hash_table_remove (fs_users, sw->fs);
+    g_mutex_unlock (&fs_users_lock);
+    /* the last user releases the engine state sized for its frames */
+    if (!users && sw->fs->ops->deinit)
+      sw->fs->ops->deinit (sw->fs);
+    g_free (sw);
+}
@@ -36,11 +36,34 @@
  * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
  * AT ALL TIMES.
  *******************************************************************************/
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include "vgst_utils.h"
 #include "vgst_pipeline.h"
+#include "vgst_graph.h"
+#include "vgst_latency.h"
+#include "vgst_fps.h"
+#include "vgst_bitrate.h"
+#include "vgst_abr.h"
+#include "filter2d_sw.h"
+#include "video_trace.h"
 
 vgst_application app;
 
+/* mode switch timing, see mark_switch_start () */
+static gint64 switch_start;
+static gint64 switch_time = -1;
+
+/* build multi-source pipelines in parallel and start them on one clock */
+static gboolean sync_start;
+
+/* event notification: pending VGST_EVENT_MASK bits per pipeline, the
+ * eventfd only wakes the client up, see get_event_fd () */
+static gint event_fd = -1;
+static gint pending_events[MAX_SRC_NUM];
+static GMutex event_lock;
+
 GST_DEBUG_CATEGORY_EXTERN (vgst_lib);
 #define GST_CAT_DEFAULT vgst_lib
 
@@ -184,6 +207,7 @@ vgst_print_params () {
     vgst_ip_params *ip_param = app.ip_params;
     vgst_enc_params *enc_param = app.enc_params;
     vgst_op_params *op_param = app.op_params;
+    vgst_sdx_filter_params *filter_param = app.filter_params;
 
     GST_DEBUG ("Src type %d", ip_param->src_type);
     GST_DEBUG ("Device type %d [1 =TPG, 2 =HDMI], 3 = MIPI", ip_param->device_type);
@@ -207,6 +231,12 @@ vgst_print_params () {
       GST_DEBUG ("Gop_mode %u", enc_param->gop_mode);
       GST_DEBUG ("Low_bandwidth %u", enc_param->low_bandwidth);
     }
+    if (SDX_FILTER == ip_param->filter_type && filter_param && GST_FILTER_MODE_SW == filter_param->filter_mode) {
+      GST_DEBUG ("SW filter workers %u", filter_param->num_workers);
+      GST_DEBUG ("SW filter cpu mask 0x%" G_GINT64_MODIFIER "x", filter_param->cpu_mask);
+      if (filter_param->fs && !g_strcmp0 (filter_param->fs->dt_comp_string, SDX_FILTER2D_PLUGIN))
+        GST_DEBUG ("SW filter2d kernel %s [%s]", filter2d_sw_get_kernel (filter_param->fs), filter2d_sw_get_isa ());
+    }
     GST_DEBUG ("Duration %u minute/s", op_param->duration);
     if (op_param->file_out)
       GST_DEBUG ("Record file path %s",   op_param->file_out);
@@ -216,9 +246,69 @@ vgst_print_params () {
 }
 
 
+void
+notify_event (guint index, guint mask) {
+    gint fd;
+    if (index >= MAX_SRC_NUM)
+      return;
+    g_atomic_int_or ((guint *)&pending_events[index], mask);
+    fd = g_atomic_int_get (&event_fd);
+    if (fd >= 0 && eventfd_write (fd, 1))
+      GST_WARNING ("failed to signal event fd: %s", g_strerror (errno));
+}
+
+
+gint
+get_event_fd (void) {
+    g_mutex_lock (&event_lock);
+    if (event_fd < 0) {
+      gint fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (fd < 0)
+        GST_ERROR ("failed to create event fd: %s", g_strerror (errno));
+      g_atomic_int_set (&event_fd, fd);
+    }
+    g_mutex_unlock (&event_lock);
+    return event_fd;
+}
+
+
+guint
+take_events (guint index) {
+    eventfd_t count;
+    gint fd = g_atomic_int_get (&event_fd);
+    guint events, i;
+    if (index >= MAX_SRC_NUM)
+      return 0;
+    /* drain first so bits set from here on re-arm the fd */
+    if (fd >= 0)
+      eventfd_read (fd, &count);
+    events = g_atomic_int_and ((guint *)&pending_events[index], 0);
+    /* the fd is shared, keep it readable while other pipelines have events */
+    for (i =0; fd >= 0 && i < MAX_SRC_NUM; i++) {
+      if (g_atomic_int_get (&pending_events[i])) {
+        eventfd_write (fd, 1);
+        break;
+      }
+    }
+    return events;
+}
+
+
+void
+close_event_fd (void) {
+    g_mutex_lock (&event_lock);
+    if (event_fd >= 0) {
+      close (event_fd);
+      g_atomic_int_set (&event_fd, -1);
+    }
+    g_mutex_unlock (&event_lock);
+}
+
+
 gboolean
 bus_callback (GstBus *bus, GstMessage *msg, gpointer ptr) {
     vgst_playback *play_ptr = (vgst_playback *)ptr;
+    vlib_trace_instant (GST_MESSAGE_TYPE_NAME (msg), play_ptr - app.playback);
     switch (GST_MESSAGE_TYPE (msg)) {
     case GST_MESSAGE_EOS:
       GST_DEBUG ("End of stream");
@@ -231,6 +321,7 @@ bus_callback (GstBus *bus, GstMessage *msg, gpointer ptr) {
         break;
       }
       play_ptr->eos_flag = TRUE;
+      notify_event (play_ptr - app.playback, VGST_EVENT_MASK_EOS);
       if (play_ptr->loop && g_main_is_running (play_ptr->loop)) {
         GST_DEBUG ("Quitting the loop");
         g_main_loop_quit (play_ptr->loop);
@@ -248,6 +339,7 @@ bus_callback (GstBus *bus, GstMessage *msg, gpointer ptr) {
       }
       // playback can't continue in error condition
       play_ptr->err_flag = TRUE;
+      notify_event (play_ptr - app.playback, VGST_EVENT_MASK_ERROR);
       g_error_free (error);
       if (play_ptr->loop && g_main_is_running (play_ptr->loop)) {
         GST_DEBUG ("Quitting the loop");
@@ -256,6 +348,26 @@ bus_callback (GstBus *bus, GstMessage *msg, gpointer ptr) {
       }
       break;
     }
+    case GST_MESSAGE_STATE_CHANGED : {
+      GstState new_state;
+      if (GST_MESSAGE_SRC (msg) != GST_OBJECT (play_ptr->pipeline))
+        break;
+      gst_message_parse_state_changed (msg, NULL, &new_state, NULL);
+      notify_event (play_ptr - app.playback, VGST_EVENT_MASK_STATE_CHANGED);
+      if (switch_start && new_state == GST_STATE_PLAYING) {
+        switch_time = g_get_monotonic_time () - switch_start;
+        switch_start = 0;
+        GST_INFO ("mode switch took %.1f ms", switch_time / 1000.0);
+      }
+      break;
+    }
+    case GST_MESSAGE_ELEMENT :
+      if (gst_message_has_name (msg, VGST_STATS_MESSAGE))
+        notify_event (play_ptr - app.playback, VGST_EVENT_MASK_STATS);
+      break;
+    case GST_MESSAGE_QOS :
+      fps_stats_qos (play_ptr, play_ptr - app.playback, msg);
+      break;
     case GST_MESSAGE_TAG : {
       GstTagList *tags = NULL;
       gst_message_parse_tag (msg, &tags);
@@ -272,73 +384,216 @@ bus_callback (GstBus *bus, GstMessage *msg, gpointer ptr) {
 }
 
 
+void
+set_sync_start (gboolean enable) {
+    sync_start = enable;
+}
+
+
+/* Create, set up and link the pipeline of source i, only touches app.playback[i] */
+static VGST_ERROR_LOG
+build_pipeline (guint i) {
+    gint ret;
+    vgst_cmn_params *cmn_param = app.cmn_params;
+    vgst_ip_params *ip_param = &app.ip_params[i];
+    vgst_playback *play_ptr = &app.playback[i];
+
+    if (SPLIT_SCREEN == cmn_param->sink_type) {
+      if (!(ret = create_split_pipeline (ip_param, &app.enc_params[i], play_ptr))) {
+        GST_DEBUG ("Succeed to create pipeline !!!");
+      } else {
+        GST_ERROR ("failed to create pipeline !!!");
+        return ret;
+      }
+
+      // set all the property for split-screen
+      set_split_screen_property (&app, i);
+
+      // linking all the elements for split screen
+      if ((ret = link_split_screen_elements (ip_param, play_ptr))) {
+        GST_ERROR ("Failed to link elements !!!");
+        return ret;
+      }
+    } else {
+      if (!(ret = create_pipeline (ip_param, &app.enc_params[i], play_ptr, cmn_param->sink_type, app.op_params->file_out, &app.filter_params[i]))) {
+        GST_DEBUG ("Succeed to create pipeline !!!");
+      } else {
+        GST_ERROR ("failed to create pipeline !!!");
+        return ret;
+      }
+
+      // set all the property
+      set_property (&app, i);
+
+      // linking all the elements
+      if ((ret = link_elements (ip_param, play_ptr, cmn_param->sink_type, app.enc_params[i].latency_mode))) {
+        GST_ERROR ("Failed to link elements !!!");
+        return ret;
+      }
+    }
+    vgst_latency_attach (play_ptr, i);
+    vgst_fps_attach (play_ptr, i);
+    vgst_bitrate_attach (play_ptr, i);
+    return VGST_SUCCESS;
+}
+
+
+static gpointer
+build_pipeline_thread (gpointer data) {
+    return GINT_TO_POINTER (build_pipeline (GPOINTER_TO_UINT (data)));
+}
+
+
 VGST_ERROR_LOG
 vgst_create_pipeline () {
     guint i =0;
-    gint ret;
+    gint ret = VGST_SUCCESS, err;
     vgst_cmn_params *cmn_param = app.cmn_params;
     vgst_ip_params *ip_param = app.ip_params;
-    vgst_enc_params *enc_param = app.enc_params;
-    vgst_sdx_filter_params *filter_param = app.filter_params;
-    vgst_playback *play_ptr = app.playback;
+    gint64 start = g_get_monotonic_time ();
 
+    /* compile every topology up front, a missing plugin fails before any
+     * pipeline of a multi-source setup is built */
     for (i =0; i < cmn_param->num_src; i++) {
-      if (SPLIT_SCREEN == cmn_param->sink_type) {
-        if (!(ret = create_split_pipeline (&ip_param[i], &enc_param[i], &play_ptr[i]))) {
-          GST_DEBUG ("Succeed to create pipeline !!!");
-        } else {
-          GST_ERROR ("failed to create pipeline !!!");
-          return ret;
-        }
+      gint topology = vgst_graph_select (&ip_param[i], cmn_param->sink_type);
+      if (topology >= 0 && !vgst_graph_get (topology)) {
+        GST_ERROR ("pipeline graph for source %u is not available", i);
+        return VGST_ERROR_PIPELINE_CREATE_FAIL;
+      }
+    }
 
-        // set all the property for split-screen
-        set_split_screen_property (&app, i);
+    if (sync_start && cmn_param->num_src > 1 && SPLIT_SCREEN != cmn_param->sink_type) {
+      /* pipelines share no state, build them side by side */
+      GThread *threads[MAX_SRC_NUM];
+      for (i =0; i < cmn_param->num_src; i++) {
+        threads[i] = g_thread_new ("vgst-build", build_pipeline_thread, GUINT_TO_POINTER (i));
+      }
+      for (i =0; i < cmn_param->num_src; i++) {
+        err = GPOINTER_TO_INT (g_thread_join (threads[i]));
+        if (err && !ret)
+          ret = err;
+      }
+    } else {
+      for (i =0; i < cmn_param->num_src && !ret; i++) {
+        ret = build_pipeline (i);
+      }
+    }
+    if (ret)
+      return ret;
 
-        // linking all the elements for split screen
-        if ((ret = link_split_screen_elements (&ip_param[i], &play_ptr[i]))) {
-          GST_ERROR ("Failed to link elements !!!");
-          return ret;
-        }
-      } else {
-        if (!(ret = create_pipeline (&ip_param[i], &enc_param[i], &play_ptr[i], cmn_param->sink_type, app.op_params->file_out, &filter_param[i]))) {
-          GST_DEBUG ("Succeed to create pipeline !!!");
-          printf("Succeed to create pipeline !!! %d", 1);
-        } else {
-          GST_ERROR ("failed to create pipeline !!!");
+    /* one display plane per source */
+    if (DISPLAY == cmn_param->sink_type)
+      cmn_param->plane_id += cmn_param->num_src;
+    GST_INFO ("%u pipeline(s) built in %.1f ms", cmn_param->num_src, (g_get_monotonic_time () - start) / 1000.0);
+    return VGST_SUCCESS;
+}
 
-          printf("failed to create pipeline !!!, %d", 0);
-          return ret;
-       }
+VGST_ERROR_LOG
+vgst_create_switcher_pipeline (const size_t *vsrc, guint num_vsrc) {
+    gint ret;
 
-        // set all the property
-        set_property (&app, i);
+    if ((ret = create_switcher_pipeline (app.ip_params, app.cmn_params, &app.playback[0], app.filter_params, vsrc, num_vsrc))) {
+      GST_ERROR ("failed to create switcher pipeline !!!");
+      return ret;
+    }
+    if ((ret = switch_source (&app.playback[0], app.ip_params->device_type))) {
+      return ret;
+    }
+    vgst_fps_attach (&app.playback[0], 0);
+    GST_DEBUG ("Succeed to create switcher pipeline !!!");
+    return VGST_SUCCESS;
+}
 
-        // linking all the elements
-        if ((ret = link_elements (&ip_param[i], &play_ptr[i], cmn_param->sink_type, enc_param[i].latency_mode))) {
-          GST_ERROR ("Failed to link elements !!!");
-          return ret;
-        }
+VGST_ERROR_LOG
+switch_source (vgst_playback *play_ptr, size_t vsrc) {
+    guint i;
+    if (!play_ptr->selector) {
+      GST_ERROR ("Pipeline is not a switcher");
+      return VGST_ERROR_PIPELINE_NOT_INITIALIZED;
+    }
+    for (i =0; i < play_ptr->num_selector_pads; i++) {
+      if (play_ptr->selector_vsrc[i] == vsrc) {
+        /* input-selector swaps pads between two buffers, the sink keeps
+         * running with unchanged caps */
+        g_object_set (G_OBJECT (play_ptr->selector), "active-pad", play_ptr->selector_pads[i], NULL);
+        GST_DEBUG ("switched to source %zu", vsrc);
+        return VGST_SUCCESS;
       }
     }
-    return VGST_SUCCESS;
+    GST_ERROR ("source %zu is not part of the switcher", vsrc);
+    return VGST_ERROR_DEVICE_TYPE_INVALID;
 }
 
 void
 get_fps (guint index, guint *fps) {
+    vgst_fps_stats stats;
     gint i =0;
     if (!fps) {
       GST_ERROR ("Fps pointer is NULL");
       return;
     } else {
-      fps[i] = app.playback[index].fps_num[i];
+      get_fps_stats (index, i, &stats);
+      fps[i] = stats.window[VGST_FPS_WINDOW_1S].frames;
       i++;
       if (app.cmn_params && SPLIT_SCREEN == app.cmn_params->sink_type) {
         // In case of split screen, 0th index(Left) is processed and 1st index(Right) is Raw
-        fps[i] = app.playback[index].fps_num[i];
+        get_fps_stats (index, i, &stats);
+        fps[i] = stats.window[VGST_FPS_WINDOW_1S].frames;
       }
     }
 }
 
+static gpointer
+preroll_thread (gpointer data) {
+    GstElement *pipeline = data;
+    if (GST_STATE_CHANGE_FAILURE == gst_element_set_state (pipeline, GST_STATE_PAUSED))
+      return GINT_TO_POINTER (FALSE);
+    return GINT_TO_POINTER (GST_STATE_CHANGE_FAILURE !=
+        gst_element_get_state (pipeline, NULL, NULL, SYNC_START_TIMEOUT_MS * GST_MSECOND));
+}
+
+
+/* Bring all pipelines to PAUSED concurrently, then start them on one clock
+ * with one base time so their running times, and frames, line up */
+static VGST_ERROR_LOG
+start_synchronized (guint num_src) {
+    GThread *threads[MAX_SRC_NUM];
+    GstClock *clock = gst_system_clock_obtain ();
+    GstClockTime base_time;
+    gint ret = VGST_SUCCESS;
+    guint i;
+
+    for (i =0; i< num_src; i++) {
+      gst_pipeline_use_clock (GST_PIPELINE (app.playback[i].pipeline), clock);
+      /* keep the pipeline from picking its own base time on PLAYING */
+      gst_element_set_start_time (app.playback[i].pipeline, GST_CLOCK_TIME_NONE);
+    }
+    for (i =0; i< num_src; i++) {
+      threads[i] = g_thread_new ("vgst-start", preroll_thread, app.playback[i].pipeline);
+    }
+    for (i =0; i< num_src; i++) {
+      if (!GPOINTER_TO_INT (g_thread_join (threads[i])))
+        ret = VGST_ERROR_STATE_CHANGE_FAIL;
+    }
+    if (ret) {
+      GST_ERROR ("failed to bring all pipelines to PAUSED");
+      gst_object_unref (clock);
+      return ret;
+    }
+
+    base_time = gst_clock_get_time (clock) + SYNC_START_DELAY_MS * GST_MSECOND;
+    for (i =0; i< num_src; i++) {
+      gst_element_set_base_time (app.playback[i].pipeline, base_time);
+    }
+    for (i =0; i< num_src; i++) {
+      if (GST_STATE_CHANGE_FAILURE == gst_element_set_state (app.playback[i].pipeline, GST_STATE_PLAYING))
+        ret = VGST_ERROR_STATE_CHANGE_FAIL;
+    }
+    gst_object_unref (clock);
+    return ret;
+}
+
+
 VGST_ERROR_LOG
 vgst_run_pipeline () {
     guint i =0;
@@ -395,16 +650,31 @@ vgst_run_pipeline () {
           return VGST_ERROR_OVERLAY_CREATION_FAIL;
         }
       }
+      if (sync_start && num_src > 1)
+        continue;
       if (GST_STATE_CHANGE_FAILURE == gst_element_set_state (play_ptr[i].pipeline, GST_STATE_PLAYING))
         return VGST_ERROR_STATE_CHANGE_FAIL;
     }
+    if (sync_start && num_src > 1) {
+      gint64 start = g_get_monotonic_time ();
+      if ((ret = start_synchronized (num_src)))
+        return ret;
+      GST_INFO ("%u pipelines started together in %.1f ms", num_src, (g_get_monotonic_time () - start) / 1000.0);
+    }
+    if (STREAM == cmn_param->sink_type) {
+      for (i =0; i< num_src; i++)
+        vgst_abr_attach (&play_ptr[i], i, &app.enc_params[i]);
+    }
     return VGST_SUCCESS;
 }
 
 guint
 get_bitrate (int index) {
+    vgst_bitrate_stats stats;
     if ((FILE_SRC == app.ip_params[index].src_type || STREAMING_SRC == app.ip_params[index].src_type) && app.playback[index].file_br) {
       return app.playback[index].file_br;
+    } else if (LIVE_SRC == app.ip_params[index].src_type && !get_bitrate_stats (index, &stats)) {
+      return stats.window_bps;
     } else
       return 0;
 }
@@ -434,6 +704,7 @@ stop_pipeline (void) {
     }
     guint num_src = app.cmn_params->num_src;
     gint i =0, ret = VGST_SUCCESS;
+    guint j;
     for (i =0; i< num_src; i++) {
       vgst_playback *play_ptr = &app.playback[i];
       if (!play_ptr || !play_ptr->pipeline) {
@@ -442,12 +713,15 @@ stop_pipeline (void) {
         continue;
       }
       play_ptr->stop_flag = TRUE;
+      vgst_abr_detach (i);
+      vgst_fps_detach (i);
       GST_DEBUG ("setting to NULL state");
       if (GST_STATE_CHANGE_FAILURE == gst_element_set_state (play_ptr->pipeline, GST_STATE_NULL)) {
         GST_ERROR ("state change is failed");
         ret |= VGST_ERROR_STATE_CHANGE_FAIL;
         continue;
       }
+      vgst_latency_detach (i);
       if (play_ptr->pipeline) {
         if (play_ptr->pad) {
           GST_DEBUG ("releasing pads");
@@ -459,6 +733,15 @@ stop_pipeline (void) {
           gst_element_release_request_pad (play_ptr->tee, play_ptr->pad2);
           gst_object_unref (play_ptr->pad2);
         }
+        for (j =0; j < play_ptr->num_selector_pads; j++) {
+          if (!play_ptr->selector_pads[j])
+            continue;
+          gst_element_release_request_pad (play_ptr->selector, play_ptr->selector_pads[j]);
+          gst_object_unref (play_ptr->selector_pads[j]);
+          play_ptr->selector_pads[j] = NULL;
+        }
+        play_ptr->num_selector_pads = 0;
+        play_ptr->selector = NULL;
         GST_DEBUG ("removing  bus");
         GstBus *bus;
         bus = gst_pipeline_get_bus (GST_PIPELINE (play_ptr->pipeline));
@@ -472,12 +755,103 @@ stop_pipeline (void) {
         }
         gst_object_unref (GST_OBJECT (play_ptr->pipeline));
         play_ptr->pipeline = NULL;
+        vgst_swfilter_free (play_ptr->swfilter);
+        play_ptr->swfilter = NULL;
       }
     }
     GST_DEBUG ("returning from stop");
     return ret;
 }
 
+gint
+park_pipeline (vgst_playback *play_ptr) {
+    GstBus *bus;
+    if (!play_ptr->pipeline) {
+      return VGST_ERROR_PIPELINE_NOT_INITIALIZED;
+    }
+    play_ptr->stop_flag = TRUE;
+    vgst_abr_detach (play_ptr - app.playback);
+    /* the probes are installed again on resume, a parked pipeline may be
+     * evicted while another one owns the index */
+    vgst_fps_detach (play_ptr - app.playback);
+    /* READY releases buffers and the display plane but keeps every element,
+     * link and property in place */
+    GST_DEBUG ("parking pipeline in READY state");
+    if (GST_STATE_CHANGE_FAILURE == gst_element_set_state (play_ptr->pipeline, GST_STATE_READY)) {
+      GST_ERROR ("state change is failed");
+      return VGST_ERROR_STATE_CHANGE_FAIL;
+    }
+    /* no streaming thread runs in READY, resume installs them again */
+    vgst_latency_detach (play_ptr - app.playback);
+    bus = gst_pipeline_get_bus (GST_PIPELINE (play_ptr->pipeline));
+    if (bus) {
+      gst_bus_remove_watch (bus);
+      /* drop messages of the old run, they must not reach the next watch */
+      gst_bus_set_flushing (bus, TRUE);
+      gst_object_unref (bus);
+    }
+    if (play_ptr->err_msg) {
+      g_free (play_ptr->err_msg);
+      play_ptr->err_msg = NULL;
+    }
+    return VGST_SUCCESS;
+}
+
+VGST_ERROR_LOG
+resume_pipeline (vgst_playback *play_ptr) {
+    GstBus *bus;
+    if (!play_ptr->pipeline) {
+      return VGST_ERROR_PIPELINE_NOT_INITIALIZED;
+    }
+    play_ptr->stop_flag = FALSE;
+    play_ptr->eos_flag = FALSE;
+    play_ptr->err_flag = FALSE;
+    bus = gst_pipeline_get_bus (GST_PIPELINE (play_ptr->pipeline));
+    gst_bus_set_flushing (bus, FALSE);
+    gst_bus_add_watch (bus, bus_callback, play_ptr);
+    gst_object_unref (bus);
+    vgst_fps_attach (play_ptr, play_ptr - app.playback);
+    vgst_latency_attach (play_ptr, play_ptr - app.playback);
+    if (GST_STATE_CHANGE_FAILURE == gst_element_set_state (play_ptr->pipeline, GST_STATE_PLAYING))
+      return VGST_ERROR_STATE_CHANGE_FAIL;
+    if (app.cmn_params && STREAM == app.cmn_params->sink_type)
+      vgst_abr_attach (play_ptr, play_ptr - app.playback, &app.enc_params[play_ptr - app.playback]);
+    return VGST_SUCCESS;
+}
+
+void
+destroy_pipeline (vgst_playback *play_ptr) {
+    /* cached pipelines live outside app.playback and never hold the
+     * probes, see park_pipeline () */
+    gboolean attached = play_ptr >= app.playback && play_ptr < app.playback + MAX_SRC_NUM;
+
+    if (!play_ptr->pipeline)
+      return;
+    if (attached) {
+      vgst_abr_detach (play_ptr - app.playback);
+      vgst_fps_detach (play_ptr - app.playback);
+    }
+    gst_element_set_state (play_ptr->pipeline, GST_STATE_NULL);
+    if (attached)
+      vgst_latency_detach (play_ptr - app.playback);
+    gst_object_unref (GST_OBJECT (play_ptr->pipeline));
+    play_ptr->pipeline = NULL;
+    vgst_swfilter_free (play_ptr->swfilter);
+    play_ptr->swfilter = NULL;
+    g_free (play_ptr->err_msg);
+    play_ptr->err_msg = NULL;
+}
+
+void
+mark_switch_start (void) {
+    switch_start = g_get_monotonic_time ();
+}
+
+gint64
+get_switch_time (void) {
+    return switch_time;
+}
+
 void
 create_err_msg(gchar *err_str, int index) {
   app.playback[index].err_msg = g_strdup (err_str);
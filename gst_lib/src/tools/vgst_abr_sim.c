@@ -0,0 +1,122 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+/*
+ * Drives vgst_abr_decide () with a simulated lossy link, one decision per
+ * GOP of one second. The link drains capacity_kbps minus a random loss of
+ * up to loss_pct, whatever is not drained piles up in a send buffer of
+ * VGST_ABR_SIM_SNDBUF bytes and overflows as unsent bytes. The capacity
+ * steps from the first to the second value half way through the run.
+ *
+ * A real loopback test does not exercise the controller: SIOCOUTQ on lo
+ * stays close to 0 because the kernel hands packets over at once. Use a
+ * shaped link (tc qdisc tbf/netem) for that, this driver only shows how
+ * the decisions react, e.g. that the rate holds instead of oscillating
+ * once the link is steady.
+ *
+ * Build against gst_lib:
+ *   gcc vgst_abr_sim.c -I../include $(pkg-config --cflags --libs gstreamer-1.0) -lvgst -o vgst_abr_sim
+ * Usage:
+ *   vgst_abr_sim [gops [capacity_kbps [capacity2_kbps [loss_pct]]]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "vgst_abr.h"
+
+/* Default socket send buffer (net.core.wmem_default) */
+#define VGST_ABR_SIM_SNDBUF       212992
+#define VGST_ABR_SIM_MAX_KBPS     20000
+
+int
+main (int argc, char *argv[]) {
+    guint gops = argc > 1 ? atoi (argv[1]) : 120;
+    guint cap1 = argc > 2 ? atoi (argv[2]) : 8000;
+    guint cap2 = argc > 3 ? atoi (argv[3]) : 15000;
+    guint loss = argc > 4 ? atoi (argv[4]) : 5;
+    vgst_abr_state state = { VGST_ABR_SIM_MAX_KBPS, VGST_ABR_MIN_KBPS, VGST_ABR_SIM_MAX_KBPS, 0 };
+    gint64 queued = 0;
+    guint last = state.target_kbps;
+    gint dir = 0;
+    guint ups = 0, downs = 0, reversals = 0;
+    guint g;
+
+    if (!gops || loss >= 100) {
+      fprintf (stderr, "usage: %s [gops [capacity_kbps [capacity2_kbps [loss_pct]]]]\n", argv[0]);
+      return 1;
+    }
+    srand (1);
+    printf ("gop  capacity  queue%%   unsent  target\n");
+    for (g =0; g < gops; g++) {
+      guint cap = g < gops / 2 ? cap1 : cap2;
+      guint drained = (guint64) cap * (100 - rand () % (loss + 1)) / 100;
+      /* the encoder slightly undershoots its target */
+      guint sent = (guint64) state.target_kbps * 97 / 100;
+      vgst_abr_sample sample = { 0, 0, sent };
+      guint target;
+
+      queued += ((gint64) sent - drained) * 1000 / 8;
+      if (queued < 0)
+        queued = 0;
+      if (queued > VGST_ABR_SIM_SNDBUF) {
+        sample.unsent_bytes = queued - VGST_ABR_SIM_SNDBUF;
+        queued = VGST_ABR_SIM_SNDBUF;
+      }
+      sample.queue_pct = queued * 100 / VGST_ABR_SIM_SNDBUF;
+
+      target = vgst_abr_decide (&state, &sample);
+      printf ("%3u  %8u  %6u  %7" G_GUINT64_FORMAT "  %6u\n", g, drained, sample.queue_pct,
+              sample.unsent_bytes, target);
+
+      if (target != last) {
+        gint d = target > last ? 1 : -1;
+        if (d > 0)
+          ups++;
+        else
+          downs++;
+        if (dir && d != dir)
+          reversals++;
+        dir = d;
+        last = target;
+      }
+    }
+    printf ("%u increases, %u decreases, %u direction changes, final %u kbps\n", ups, downs, reversals,
+            state.target_kbps);
+    return 0;
+}
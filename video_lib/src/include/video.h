@@ -177,6 +177,8 @@ struct vlib_vdev;
 const char *vlib_video_src_get_display_text(const struct vlib_vdev *vsrc);
 const char *vlib_video_src_get_entity_name(const struct vlib_vdev *vsrc);
 enum vlib_vsrc_class vlib_video_src_get_class(const struct vlib_vdev *vsrc);
+int vlib_video_src_get_class_from_id(size_t id);
+int vlib_video_src_can_scale(size_t id);
 size_t vlib_video_src_get_index(const struct vlib_vdev *vsrc);
 struct vlib_vdev *vlib_video_src_get(size_t id);
 const char *video_src_get_vdev_from_id(size_t id);
@@ -186,6 +188,15 @@ int vlib_video_src_init(struct vlib_config_data *cfg);
 void vlib_video_src_uninit(void);
 int vlib_platform_setup(struct vlib_config_data *cfg);
 
+/*
+ * Called when a video source locks to a new input resolution, e.g. after an
+ * HDMI hot plug or a source mode change. The call is queued to the default
+ * main context and only delivered while the application iterates it, so the
+ * callback may safely reconfigure pipelines.
+ */
+typedef void (*vlib_video_src_change_cb)(size_t id, size_t width,
+					 size_t height, void *data);
+void vlib_video_src_set_change_cb(vlib_video_src_change_cb cb, void *data);
 
 static inline const char *vlib_video_src_get_display_text_from_id(size_t id)
 {
@@ -0,0 +1,82 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+
+#ifndef VIDEO_TRACE_H
+#define VIDEO_TRACE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/*
+ * Lightweight event tracer
+ *
+ * Every thread that emits an event gets its own ring of fixed-size binary
+ * records, so the hot path is a clock read and a few stores without any
+ * locking or formatting. The rings are converted to Chrome trace JSON
+ * (chrome://tracing, Perfetto) only when vlib_trace_dump() is called.
+ *
+ * Tracing is disabled by default. Setting VLIB_TRACE=<file> in the
+ * environment enables it on first use and dumps the trace to <file> at exit.
+ *
+ * Event names are stored by reference and must be string literals or
+ * otherwise outlive the trace.
+ */
+
+/* Number of records per thread ring, must be a power of two */
+#define VLIB_TRACE_RING_SIZE	8192
+
+void vlib_trace_enable(int enable);
+int vlib_trace_enabled(void);
+
+void vlib_trace_begin(const char *name);
+void vlib_trace_end(const char *name);
+void vlib_trace_instant(const char *name, uint64_t arg);
+void vlib_trace_counter(const char *name, uint64_t value);
+
+int vlib_trace_dump(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VIDEO_TRACE_H */
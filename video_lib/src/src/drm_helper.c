@@ -51,6 +51,7 @@
 #include "drm_helper.h"
 #include <drm/drm_fourcc.h>
 #include "common.h"
+#include "video_trace.h"
 
 #define container_of(ptr, type, member) ({ \
     const typeof( ((type *)0)->member ) \
@@ -376,10 +377,12 @@ static int drm_set_mode(struct drm_device *dev, const char *bgnd)
 
 set_crtc:
 	/* Set the resolution */
+	vlib_trace_begin("drm_set_mode");
 	ret = drmModeSetCrtc(dev->fd, curr_crtc->crtc_id,
 			     dev->crtc_buf.fb_handle,
 			     0, 0,
 			     &dev->con_id, 1, &connector->modes[j]);
+	vlib_trace_end("drm_set_mode");
 	ASSERT2(ret >= 0,
 		"drmModeSetCrtc :: Failed Not able to set resolution [%dx%d] on the CRTC: %s\n",
 		v_pipe->w_out, v_pipe->h_out, ERRSTR);
@@ -647,11 +650,14 @@ void drm_uninit (struct drm_device *dev)
 /* Configures plane with buffer index to be selected for next scanout */
 int drm_set_plane(struct drm_device *dev, int index)
 {
+	int ret;
+
 	/*
 	 * Configure plane, the crtc then blends the content from the
 	 * plane over the CRTC framebuffer buffer during scanout
 	 */
-	return drmModeSetPlane(dev->fd, dev->overlay_plane.drm_plane->plane_id,
+	vlib_trace_begin("drm_set_plane");
+	ret = drmModeSetPlane(dev->fd, dev->overlay_plane.drm_plane->plane_id,
 				dev->crtc_id, dev->d_buff[index].fb_handle, 0,
 				dev->overlay_plane.vlib_plane.xoffs, /* crtx_x */
 				dev->overlay_plane.vlib_plane.yoffs, /* crtc_y */
@@ -660,6 +666,9 @@ int drm_set_plane(struct drm_device *dev, int index)
 				0, 0, /* src_x, src_y */
 				dev->overlay_plane.vlib_plane.width << 16, /* src_w */
 				dev->overlay_plane.vlib_plane.height << 16); /* src_h */
+	vlib_trace_end("drm_set_plane");
+
+	return ret;
 }
 
 int drm_wait_vblank(struct drm_device *dev, void *d_ptr)
@@ -669,7 +678,9 @@ int drm_wait_vblank(struct drm_device *dev, void *d_ptr)
 	vblank.request.type = DRM_VBLANK_EVENT | DRM_VBLANK_RELATIVE;
 	vblank.request.sequence = 1;
 	vblank.request.signal = (unsigned long)d_ptr;
+	vlib_trace_begin("drm_wait_vblank");
 	ret = drmWaitVBlank(dev->fd, &vblank);
+	vlib_trace_end("drm_wait_vblank");
 	ASSERT2(!ret, "drmWaitVBlank failed: %s\n", ERRSTR);
 	return VLIB_SUCCESS;
 }
@@ -689,10 +700,12 @@ int drm_set_plane_prop(struct drm_device *dev, unsigned int plane_id, const char
 		drmModePropertyPtr prop = drmModeGetProperty(dev->fd, props->props[i]);
 
 		if (!strcmp(prop->name, prop_name)) {
+			vlib_trace_begin("drm_set_plane_prop");
 			ret = drmModeObjectSetProperty(dev->fd, plane_id,
 						       DRM_MODE_OBJECT_PLANE,
 						       prop->prop_id,
 						       prop_val);
+			vlib_trace_end("drm_set_plane_prop");
 			drmModeFreeProperty(prop);
 			break;
 		}
@@ -717,6 +730,7 @@ int drm_set_plane_state(struct drm_device *dev, unsigned int plane_id, int enabl
 		 plane->plane_id,dev->crtc_id,plane->crtc_x, plane->crtc_y,
 		 plane->x, plane->y);
 	/* note src coords (last 4 args) are in Q16 format */
+	vlib_trace_begin("drm_set_plane_state");
 	drmModeSetPlane(dev->fd, plane->plane_id, dev->crtc_id, fb_id, flags,
 			dev->overlay_plane.vlib_plane.xoffs, /* crtx_x */
 			dev->overlay_plane.vlib_plane.yoffs, /* crtc_y */
@@ -725,6 +739,7 @@ int drm_set_plane_state(struct drm_device *dev, unsigned int plane_id, int enabl
 			0, 0, /* src_x, src_y */
 			dev->overlay_plane.vlib_plane.width << 16, /* src_w */
 			dev->overlay_plane.vlib_plane.height << 16); /* src_h */
+	vlib_trace_end("drm_set_plane_state");
 
 	drmModeFreePlane(plane);
 
@@ -750,11 +765,13 @@ int drm_set_prim_plane_pos(struct drm_device *dev, int x, int y)
 		 prim_plane->y);
 
 	/* note src coords (last 4 args) are in Q16 format */
+	vlib_trace_begin("drm_set_prim_plane_pos");
 	drmModeSetPlane(dev->fd, prim_plane->plane_id, dev->crtc_id,
 			prim_plane->fb_id, flags, prim_plane->crtc_x,
 			prim_plane->crtc_y, v_pipe->w_out,
 			v_pipe->h_out - prim_plane->crtc_y, 0, 0, v_pipe->w_out << 16,
 			(v_pipe->h_out - prim_plane->crtc_y) << 16);
+	vlib_trace_end("drm_set_prim_plane_pos");
 
 	return VLIB_SUCCESS;
 }
@@ -42,6 +42,9 @@
 
 struct media_device;
 struct media_device_info;
+struct media_entity;
+struct media_pad;
+struct media_link;
 struct vlib_vdev;
 struct v4l2_dv_timings;
 
@@ -58,4 +61,23 @@ void media_set_fmt_str(char *set_fmt, char *entity, unsigned int pad,
 /* Set media pad string */
 void media_set_pad_str(char *set_fmt, char *entity, unsigned int pad);
 
+/* Enumerate the media device once and index its entities, pads and links */
+int media_cache_init(struct media_device *media);
+/* Drop the topology cache of the media device */
+void media_cache_free(struct media_device *media);
+/*
+ * Check the cache against the kernel topology version. Fails once the graph
+ * has changed, the pooled subdevice nodes are closed and the media device
+ * must be opened again, see vlib_vdev_refresh().
+ */
+int media_cache_validate(struct media_device *media);
+/* Cached lookups, the media device is enumerated on first use */
+struct media_entity *media_cache_get_entity(struct media_device *media,
+					    const char *name);
+struct media_pad *media_cache_get_pad(struct media_device *media,
+				      const char *name, unsigned int pad);
+struct media_link *media_cache_get_link(struct media_device *media,
+					const char *src, unsigned int src_pad,
+					const char *sink, unsigned int sink_pad);
+
 #endif /* MEDIA_CTL_H */
@@ -44,5 +44,42 @@
 
 /* Set subdevice control */
 int v4l2_set_ctrl(const struct vlib_vdev *vsrc, char *name, int id, int value);
+/* Pooled subdevice file descriptor, owned by the pool, do not close */
+int v4l2_subdev_fd(const struct vlib_vdev *vsrc, const char *name);
+/* Close all pooled subdevice nodes */
+void v4l2_subdev_pool_free(void);
+
+/* Batch control writes, committed as one VIDIOC_S_EXT_CTRLS per subdevice */
+struct v4l2_ctrl_txn;
+struct v4l2_ctrl_txn *v4l2_ctrl_txn_begin(const struct vlib_vdev *vsrc);
+int v4l2_ctrl_txn_set(struct v4l2_ctrl_txn *txn, const char *name, int id,
+		      int value);
+/* Apply and free the transaction */
+int v4l2_ctrl_txn_commit(struct v4l2_ctrl_txn *txn);
+
+/* Pipeline configuration a format plan is compiled for */
+struct v4l2_fmt_plan_key {
+	size_t in_width;	/* sensor or receiver resolution */
+	size_t in_height;
+	size_t width;		/* output resolution */
+	size_t height;
+	unsigned int fourcc;	/* output fourcc */
+	unsigned int in_code;	/* media bus code reported by the receiver */
+};
+
+/* Precompiled set of subdevice pad formats */
+struct v4l2_fmt_plan;
+/* Look up the plan for @key, *compile is set if its steps must be added */
+struct v4l2_fmt_plan *v4l2_fmt_plan_get(const struct vlib_vdev *vsrc,
+					const struct v4l2_fmt_plan_key *key,
+					int *compile);
+/* Append the format of @name:@pad and its propagation to linked sinks */
+int v4l2_fmt_plan_add(struct v4l2_fmt_plan *plan, const char *name,
+		      unsigned int pad, const char *fmt, unsigned int width,
+		      unsigned int height);
+/* Issue one VIDIOC_SUBDEV_S_FMT per planned pad, returns -errno on failure */
+int v4l2_fmt_plan_apply(struct v4l2_fmt_plan *plan);
+/* Drop the plans of @vsrc, they refer to its media graph */
+void v4l2_fmt_plans_free(const struct vlib_vdev *vsrc);
 
 #endif /* V4L2_HELPER_H */
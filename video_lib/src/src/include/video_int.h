@@ -80,6 +80,9 @@ struct vsrc_ops {
 	int (*set_media_ctrl)(struct video_pipeline *video_setup,
 			      const struct vlib_vdev *vdev);
 	int (*set_frame_rate)(const struct vlib_vdev *vdev, size_t numerator, size_t denominator);
+	void (*release)(struct vlib_vdev *vdev);
+	/* restart what release stopped once the media device was reopened */
+	void (*reopen)(struct vlib_vdev *vdev);
 };
 
 struct vlib_vdev {
@@ -117,6 +120,11 @@ struct vlib_vdev {
  */
 #define VDEV_CONFIG_TYPE_USER	BIT(0)
 
+/* The device cannot scale, its input resolution has to match the capture
+ * resolution of the mode.
+ */
+#define VDEV_FIXED_INPUT	BIT(1)
+
 typedef enum {
 	MODE_INIT,
 	MODE_CHANGE,
@@ -148,8 +156,11 @@ struct video_pipeline {
 int vlib_video_src_init(struct vlib_config_data *cfg);
 void vlib_video_src_uninit(void);
 struct media_device *vlib_vdev_get_mdev(const struct vlib_vdev *vdev);
+int vlib_vdev_refresh(struct vlib_vdev *vdev);
 void vlib_video_src_class_disable(enum vlib_vsrc_class class);
 const char *vlib_video_src_mdev2vdev(struct media_device *media);
+void vlib_video_src_notify_change(const struct vlib_vdev *vsrc, size_t width,
+				  size_t height);
 int vlib_video_src_get_vnode(const struct vlib_vdev *vsrc);
 size_t vlib_fourcc2bpp(uint32_t fourcc);
 const char *vlib_fourcc2mbus(uint32_t fourcc);
@@ -36,12 +36,18 @@
  * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
  * AT ALL TIMES.
  *******************************************************************************/
+#include <fcntl.h>
+#include <glib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/media.h>
 #include <mediactl/mediactl.h>
 #include <mediactl/v4l2subdev.h>
 
 #include "helper.h"
 #include "mediactl_helper.h"
+#include "v4l2_helper.h"
 #include "video_int.h"
 
 #define MEDIA_FMT "\"%s\":%d [fmt:%s/%dx%d field:none]"
@@ -82,6 +88,243 @@ void print_media_info(const struct media_device_info *info)
 						   (info->driver_version << 0) & 0xff);
 }
 
+/*
+ * Topology cache
+ *
+ * Entities, pads and links of a media device are enumerated once and indexed
+ * by name so control and format helpers do not walk the graph on every call.
+ * The cache is keyed by the media device and remembers the kernel topology
+ * version it was built against; media_cache_validate() compares it with the
+ * current version. libmediactl cannot re-enumerate a device, so once the
+ * graph has changed the cache is marked stale and lookups fail until
+ * vlib_vdev_refresh() has switched the source to a newly opened device.
+ */
+struct media_cache {
+	struct media_device *media;
+	int fd;
+	uint64_t version;
+	int stale;
+	GHashTable *entities;	/* "name" -> struct media_entity */
+	GHashTable *pads;	/* "name":pad -> struct media_pad */
+	GHashTable *links;	/* "src":pad->"sink":pad -> struct media_link */
+};
+
+static GHashTable *media_caches;
+static GMutex media_cache_lock;
+
+static uint64_t media_topology_version(int fd)
+{
+#ifdef MEDIA_IOC_G_TOPOLOGY
+	struct media_v2_topology topo;
+
+	/* without arrays the ioctl only reports the counts and the version */
+	memset(&topo, 0, sizeof(topo));
+	if (fd >= 0 && !ioctl(fd, MEDIA_IOC_G_TOPOLOGY, &topo))
+		return topo.topology_version;
+#endif
+	return 0;
+}
+
+static char *media_cache_pad_key(const char *name, unsigned int pad)
+{
+	return g_strdup_printf("%s:%u", name, pad);
+}
+
+static void media_cache_fill(struct media_cache *cache)
+{
+	unsigned int n = media_get_entities_count(cache->media);
+
+	g_hash_table_remove_all(cache->entities);
+	g_hash_table_remove_all(cache->pads);
+	g_hash_table_remove_all(cache->links);
+
+	for (unsigned int i = 0; i < n; i++) {
+		struct media_entity *entity = media_get_entity(cache->media, i);
+		const struct media_entity_desc *info = media_entity_get_info(entity);
+
+		g_hash_table_insert(cache->entities, g_strdup(info->name),
+				    entity);
+		for (unsigned int p = 0; p < info->pads; p++) {
+			g_hash_table_insert(cache->pads,
+					    media_cache_pad_key(info->name, p),
+					    (void *)media_entity_get_pad(entity, p));
+		}
+		for (unsigned int l = 0; l < media_entity_get_links_count(entity); l++) {
+			const struct media_link *link = media_entity_get_link(entity, l);
+			const struct media_entity_desc *src =
+				media_entity_get_info(link->source->entity);
+			const struct media_entity_desc *sink =
+				media_entity_get_info(link->sink->entity);
+
+			g_hash_table_insert(cache->links,
+					    g_strdup_printf("%s:%u->%s:%u",
+							    src->name, link->source->index,
+							    sink->name, link->sink->index),
+					    (void *)link);
+		}
+	}
+
+	cache->version = media_topology_version(cache->fd);
+	vlib_dbg("%s: cached %u entities, %u pads, %u links (topology %llu)\n",
+		 media_get_devnode(cache->media), n,
+		 g_hash_table_size(cache->pads),
+		 g_hash_table_size(cache->links),
+		 (unsigned long long)cache->version);
+}
+
+static void media_cache_destroy(gpointer data)
+{
+	struct media_cache *cache = data;
+
+	g_hash_table_destroy(cache->entities);
+	g_hash_table_destroy(cache->pads);
+	g_hash_table_destroy(cache->links);
+	if (cache->fd >= 0)
+		close(cache->fd);
+	g_free(cache);
+}
+
+/* Returns the cache of @media, building it on first use. Called locked */
+static struct media_cache *media_cache_get(struct media_device *media)
+{
+	struct media_cache *cache;
+	int ret;
+
+	if (!media)
+		return NULL;
+
+	if (!media_caches)
+		media_caches = g_hash_table_new_full(NULL, NULL, NULL,
+						     media_cache_destroy);
+
+	cache = g_hash_table_lookup(media_caches, media);
+	if (cache)
+		return cache;
+
+	ret = media_device_enumerate(media);
+	if (ret < 0) {
+		VLIB_REPORT_ERR("Failed to enumerate media device (%d)", ret);
+		return NULL;
+	}
+
+	cache = g_new0(struct media_cache, 1);
+	cache->media = media;
+	cache->fd = open(media_get_devnode(media), O_RDONLY | O_CLOEXEC);
+	cache->entities = g_hash_table_new_full(g_str_hash, g_str_equal,
+						g_free, NULL);
+	cache->pads = g_hash_table_new_full(g_str_hash, g_str_equal,
+					    g_free, NULL);
+	cache->links = g_hash_table_new_full(g_str_hash, g_str_equal,
+					     g_free, NULL);
+	media_cache_fill(cache);
+	g_hash_table_insert(media_caches, media, cache);
+
+	return cache;
+}
+
+int media_cache_init(struct media_device *media)
+{
+	struct media_cache *cache;
+
+	g_mutex_lock(&media_cache_lock);
+	cache = media_cache_get(media);
+	g_mutex_unlock(&media_cache_lock);
+
+	return cache ? VLIB_SUCCESS : VLIB_ERROR_OTHER;
+}
+
+void media_cache_free(struct media_device *media)
+{
+	g_mutex_lock(&media_cache_lock);
+	if (media_caches)
+		g_hash_table_remove(media_caches, media);
+	g_mutex_unlock(&media_cache_lock);
+}
+
+int media_cache_validate(struct media_device *media)
+{
+	struct media_cache *cache;
+	uint64_t version;
+	int changed = 0;
+	int ret;
+
+	g_mutex_lock(&media_cache_lock);
+	cache = media_cache_get(media);
+	if (cache && !cache->stale) {
+		version = media_topology_version(cache->fd);
+		if (version != cache->version) {
+			vlib_warn("%s: topology changed (%llu -> %llu), reopening\n",
+				  media_get_devnode(media),
+				  (unsigned long long)cache->version,
+				  (unsigned long long)version);
+			g_hash_table_remove_all(cache->entities);
+			g_hash_table_remove_all(cache->pads);
+			g_hash_table_remove_all(cache->links);
+			cache->stale = 1;
+			changed = 1;
+		}
+	}
+	ret = cache && !cache->stale ? VLIB_SUCCESS : VLIB_ERROR_OTHER;
+	g_mutex_unlock(&media_cache_lock);
+
+	/* subdevice nodes and the format plans using them may be gone too */
+	if (changed)
+		v4l2_subdev_pool_free();
+
+	return ret;
+}
+
+struct media_entity *media_cache_get_entity(struct media_device *media,
+					    const char *name)
+{
+	struct media_cache *cache;
+	struct media_entity *entity = NULL;
+
+	g_mutex_lock(&media_cache_lock);
+	cache = media_cache_get(media);
+	if (cache)
+		entity = g_hash_table_lookup(cache->entities, name);
+	g_mutex_unlock(&media_cache_lock);
+
+	return entity;
+}
+
+struct media_pad *media_cache_get_pad(struct media_device *media,
+				      const char *name, unsigned int pad)
+{
+	struct media_cache *cache;
+	struct media_pad *mpad = NULL;
+	char *key = media_cache_pad_key(name, pad);
+
+	g_mutex_lock(&media_cache_lock);
+	cache = media_cache_get(media);
+	if (cache)
+		mpad = g_hash_table_lookup(cache->pads, key);
+	g_mutex_unlock(&media_cache_lock);
+	g_free(key);
+
+	return mpad;
+}
+
+struct media_link *media_cache_get_link(struct media_device *media,
+					const char *src, unsigned int src_pad,
+					const char *sink, unsigned int sink_pad)
+{
+	struct media_cache *cache;
+	struct media_link *link = NULL;
+	char *key = g_strdup_printf("%s:%u->%s:%u", src, src_pad, sink,
+				    sink_pad);
+
+	g_mutex_lock(&media_cache_lock);
+	cache = media_cache_get(media);
+	if (cache)
+		link = g_hash_table_lookup(cache->links, key);
+	g_mutex_unlock(&media_cache_lock);
+	g_free(key);
+
+	return link;
+}
+
 /*
  * Helper function that returns the full path and name to the device node
  * corresponding to the given entity i.e (/dev/v4l-subdev* )
@@ -90,13 +333,8 @@ int get_entity_devname(struct media_device *media, char *name, char *subdev_name
 {
 	struct media_entity *entity;
 	const char *entity_node_name;
-	int ret;
-
-	/* Enumerate entities, pads and links */
-	ret = media_device_enumerate(media);
-	ASSERT2(ret >= 0, "Failed to enumerate media device (%d)\n", ret);
 
-	entity = media_get_entity_by_name(media, name);
+	entity = media_cache_get_entity(media, name);
 	ASSERT2(entity, "Entity '%s' not found\n", name);
 
 	entity_node_name = media_entity_get_devname(entity);
@@ -118,15 +356,8 @@ int query_entity_dv_timings(const struct vlib_vdev *vdev, char *entity_name,
 	struct media_pad *pad;
 	int ret;
 	struct media_device *mdev = vlib_vdev_get_mdev(vdev);
-	char pad_str[100];
-
-	/* Enumerate entities, pads and links */
-	ret = media_device_enumerate(mdev);
-	ASSERT2(ret >= 0, "Failed to enumerate media device (%d)\n", ret);
 
-	memset(pad_str, 0, sizeof (pad_str));
-	media_set_pad_str(pad_str, entity_name, padn);
-	pad = media_parse_pad(mdev, pad_str, NULL);
+	pad = media_cache_get_pad(mdev, entity_name, padn);
 	ASSERT2(pad, "Pad '%s' not found\n", entity_name);
 
 	ret = v4l2_subdev_query_dv_timings(pad->entity, timings);
@@ -39,48 +39,509 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <glib.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <time.h>
 #include <unistd.h>
+#include <mediactl/mediactl.h>
+#include <mediactl/v4l2subdev.h>
 
 #include "helper.h"
 #include "mediactl_helper.h"
 #include "platform.h"
 #include "v4l2_helper.h"
+#include "video_trace.h"
 
-/* set subdevice control */
-int v4l2_set_ctrl(const struct vlib_vdev *vsrc, char *name, int id, int value)
+/*
+ * Subdevice nodes are opened once and kept in a pool keyed by device node,
+ * together with the VIDIOC_QUERYCTRL results seen so far. Control writes then
+ * cost a single ioctl instead of open/QUERYCTRL/S_CTRL/close.
+ */
+struct v4l2_subdev_handle {
+	int fd;
+	GHashTable *ctrls;	/* control id -> struct v4l2_queryctrl */
+};
+
+static GHashTable *subdev_pool;
+static GHashTable *fmt_plans;
+static GMutex subdev_pool_lock;
+
+static void v4l2_subdev_handle_free(gpointer data)
+{
+	struct v4l2_subdev_handle *h = data;
+
+	close(h->fd);
+	g_hash_table_destroy(h->ctrls);
+	g_free(h);
+}
+
+static struct v4l2_subdev_handle *
+v4l2_subdev_handle_get(const struct vlib_vdev *vsrc, const char *name)
 {
-	int fd, ret;
+	struct v4l2_subdev_handle *h;
 	char subdev_name[DEV_NAME_LEN];
-	struct v4l2_queryctrl query;
-	struct v4l2_control ctrl;
 
+	get_entity_devname(vlib_vdev_get_mdev(vsrc), (char *)name, subdev_name);
+
+	g_mutex_lock(&subdev_pool_lock);
+	if (!subdev_pool)
+		subdev_pool = g_hash_table_new_full(g_str_hash, g_str_equal,
+						    g_free,
+						    v4l2_subdev_handle_free);
+
+	h = g_hash_table_lookup(subdev_pool, subdev_name);
+	if (!h) {
+		h = g_new0(struct v4l2_subdev_handle, 1);
+		h->fd = open(subdev_name, O_RDWR | O_CLOEXEC);
+		ASSERT2(h->fd >= 0, "failed to open %s: %s\n", subdev_name,
+			ERRSTR);
+		h->ctrls = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+						 NULL, g_free);
+		g_hash_table_insert(subdev_pool, g_strdup(subdev_name), h);
+		vlib_dbg("opened %s for '%s'\n", subdev_name, name);
+	}
+	g_mutex_unlock(&subdev_pool_lock);
+
+	return h;
+}
+
+static struct v4l2_queryctrl *
+v4l2_subdev_query_ctrl(struct v4l2_subdev_handle *h, int id)
+{
+	struct v4l2_queryctrl *query;
+	int ret;
+
+	g_mutex_lock(&subdev_pool_lock);
+	query = g_hash_table_lookup(h->ctrls, GINT_TO_POINTER(id));
+	if (!query) {
+		query = g_new0(struct v4l2_queryctrl, 1);
+		query->id = id;
+		ret = ioctl(h->fd, VIDIOC_QUERYCTRL, query);
+		ASSERT2(ret >= 0, "VIDIOC_QUERYCTRL failed: %s\n", ERRSTR);
+		g_hash_table_insert(h->ctrls, GINT_TO_POINTER(id), query);
+	}
+	g_mutex_unlock(&subdev_pool_lock);
+
+	return query;
+}
+
+int v4l2_subdev_fd(const struct vlib_vdev *vsrc, const char *name)
+{
 	if (!vsrc) {
 		return VLIB_ERROR_INVALID_PARAM;
 	}
 
-	get_entity_devname(vlib_vdev_get_mdev(vsrc), name, subdev_name);
+	return v4l2_subdev_handle_get(vsrc, name)->fd;
+}
 
-	fd = open(subdev_name, O_RDWR);
-	ASSERT2(fd >= 0, "failed to open %s: %s\n", subdev_name, ERRSTR);
+void v4l2_subdev_pool_free(void)
+{
+	g_mutex_lock(&subdev_pool_lock);
+	if (fmt_plans) {
+		g_hash_table_destroy(fmt_plans);
+		fmt_plans = NULL;
+	}
+	if (subdev_pool) {
+		g_hash_table_destroy(subdev_pool);
+		subdev_pool = NULL;
+	}
+	g_mutex_unlock(&subdev_pool_lock);
+}
 
-	memset(&query, 0, sizeof(query));
-	query.id = id;
-	ret = ioctl(fd, VIDIOC_QUERYCTRL, &query);
-	ASSERT2(ret >= 0, "VIDIOC_QUERYCTRL failed: %s\n", ERRSTR);
+/* set subdevice control */
+int v4l2_set_ctrl(const struct vlib_vdev *vsrc, char *name, int id, int value)
+{
+	int ret;
+	struct v4l2_subdev_handle *h;
+	struct v4l2_queryctrl *query;
+	struct v4l2_control ctrl;
 
-	if (query.flags & V4L2_CTRL_FLAG_DISABLED) {
+	if (!vsrc) {
+		return VLIB_ERROR_INVALID_PARAM;
+	}
+
+	h = v4l2_subdev_handle_get(vsrc, name);
+	query = v4l2_subdev_query_ctrl(h, id);
+
+	if (query->flags & V4L2_CTRL_FLAG_DISABLED) {
 		vlib_info("V4L2_CID_%d is disabled\n", id);
 	} else {
 		memset(&ctrl, 0, sizeof(ctrl));
-		ctrl.id = query.id;
+		ctrl.id = query->id;
 		ctrl.value = value;
-		ret = ioctl(fd, VIDIOC_S_CTRL, &ctrl);
+		ret = ioctl(h->fd, VIDIOC_S_CTRL, &ctrl);
+		ASSERT2(ret >= 0, "VIDIOC_S_CTRL failed: %s\n", ERRSTR);
+	}
+
+	return VLIB_SUCCESS;
+}
+
+/*
+ * Control transactions collect the writes for one configuration change and
+ * commit them as one VIDIOC_S_EXT_CTRLS per subdevice, so a subdevice never
+ * runs with half of a new configuration applied.
+ */
+struct v4l2_ctrl_group {
+	struct v4l2_subdev_handle *h;
+	const char *name;
+	GArray *ctrls;		/* struct v4l2_ext_control */
+};
+
+struct v4l2_ctrl_txn {
+	const struct vlib_vdev *vsrc;
+	GPtrArray *groups;	/* struct v4l2_ctrl_group, in first-use order */
+};
+
+static void v4l2_ctrl_group_free(gpointer data)
+{
+	struct v4l2_ctrl_group *g = data;
+
+	g_array_free(g->ctrls, TRUE);
+	g_free(g);
+}
+
+struct v4l2_ctrl_txn *v4l2_ctrl_txn_begin(const struct vlib_vdev *vsrc)
+{
+	struct v4l2_ctrl_txn *txn;
+
+	if (!vsrc) {
+		return NULL;
+	}
+
+	txn = g_new0(struct v4l2_ctrl_txn, 1);
+	txn->vsrc = vsrc;
+	txn->groups = g_ptr_array_new_with_free_func(v4l2_ctrl_group_free);
+
+	return txn;
+}
+
+int v4l2_ctrl_txn_set(struct v4l2_ctrl_txn *txn, const char *name, int id,
+		      int value)
+{
+	struct v4l2_subdev_handle *h;
+	struct v4l2_ctrl_group *g = NULL;
+	struct v4l2_ext_control ctrl;
+	guint i;
+
+	if (!txn) {
+		return VLIB_ERROR_INVALID_PARAM;
+	}
+
+	h = v4l2_subdev_handle_get(txn->vsrc, name);
+
+	for (i = 0; i < txn->groups->len; i++) {
+		g = g_ptr_array_index(txn->groups, i);
+		if (g->h == h)
+			break;
+		g = NULL;
+	}
+
+	if (!g) {
+		g = g_new0(struct v4l2_ctrl_group, 1);
+		g->h = h;
+		g->name = name;
+		g->ctrls = g_array_new(FALSE, FALSE,
+				       sizeof(struct v4l2_ext_control));
+		g_ptr_array_add(txn->groups, g);
+	}
+
+	/* the last write to a control wins */
+	for (i = 0; i < g->ctrls->len; i++) {
+		struct v4l2_ext_control *c =
+			&g_array_index(g->ctrls, struct v4l2_ext_control, i);
+
+		if (c->id == (__u32)id) {
+			c->value = value;
+			return VLIB_SUCCESS;
+		}
+	}
+
+	memset(&ctrl, 0, sizeof(ctrl));
+	ctrl.id = id;
+	ctrl.value = value;
+	g_array_append_val(g->ctrls, ctrl);
+
+	return VLIB_SUCCESS;
+}
+
+static void v4l2_ctrl_group_commit(struct v4l2_ctrl_group *g)
+{
+	struct v4l2_ext_controls ctrls;
+	struct v4l2_ext_control *c;
+	struct v4l2_control ctrl;
+	struct v4l2_queryctrl *query;
+	GArray *set;
+	guint i;
+	int ret;
+
+	set = g_array_sized_new(FALSE, FALSE, sizeof(struct v4l2_ext_control),
+				g->ctrls->len);
+	for (i = 0; i < g->ctrls->len; i++) {
+		c = &g_array_index(g->ctrls, struct v4l2_ext_control, i);
+		query = v4l2_subdev_query_ctrl(g->h, c->id);
+		if (query->flags & V4L2_CTRL_FLAG_DISABLED) {
+			vlib_info("V4L2_CID_%d is disabled\n", c->id);
+			continue;
+		}
+		g_array_append_val(set, *c);
+	}
+
+	if (!set->len)
+		goto out;
+
+	/* ctrl_class 0 (V4L2_CTRL_WHICH_CUR_VAL) allows mixing classes */
+	memset(&ctrls, 0, sizeof(ctrls));
+	ctrls.count = set->len;
+	ctrls.controls = (struct v4l2_ext_control *)set->data;
+	ret = ioctl(g->h->fd, VIDIOC_S_EXT_CTRLS, &ctrls);
+	if (!ret)
+		goto out;
+
+	/* drivers without extended control support get one write each */
+	vlib_dbg("VIDIOC_S_EXT_CTRLS on '%s' failed: %s, using VIDIOC_S_CTRL\n",
+		 g->name, ERRSTR);
+	for (i = 0; i < set->len; i++) {
+		c = &g_array_index(set, struct v4l2_ext_control, i);
+		memset(&ctrl, 0, sizeof(ctrl));
+		ctrl.id = c->id;
+		ctrl.value = c->value;
+		ret = ioctl(g->h->fd, VIDIOC_S_CTRL, &ctrl);
 		ASSERT2(ret >= 0, "VIDIOC_S_CTRL failed: %s\n", ERRSTR);
 	}
 
-	close(fd);
+out:
+	g_array_free(set, TRUE);
+}
+
+int v4l2_ctrl_txn_commit(struct v4l2_ctrl_txn *txn)
+{
+	guint i;
+
+	if (!txn) {
+		return VLIB_ERROR_INVALID_PARAM;
+	}
+
+	for (i = 0; i < txn->groups->len; i++)
+		v4l2_ctrl_group_commit(g_ptr_array_index(txn->groups, i));
+
+	g_ptr_array_free(txn->groups, TRUE);
+	g_free(txn);
+
+	return VLIB_SUCCESS;
+}
+
+/*
+ * Format plans replace media-ctl format strings on mode changes. A plan is
+ * compiled once per source and configuration: entity names are resolved to
+ * pooled subdevice fds and formats to struct v4l2_subdev_format, so applying
+ * it is one VIDIOC_SUBDEV_S_FMT per pad. Like media-ctl, a format set on a
+ * source pad is propagated to the subdevice sinks of its enabled links.
+ */
+struct v4l2_fmt_step {
+	const char *name;	/* entity name, owned by libmediactl */
+	int fd;
+	int from;		/* step propagated to this pad, or -1 */
+	struct v4l2_subdev_format fmt;
+};
+
+struct v4l2_fmt_plan {
+	const struct vlib_vdev *vsrc;
+	GArray *steps;		/* struct v4l2_fmt_step */
+	uint64_t created_ns;
+	uint64_t compile_ns;
+	unsigned int applied;
+};
+
+static uint64_t v4l2_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void v4l2_fmt_plan_free(gpointer data)
+{
+	struct v4l2_fmt_plan *plan = data;
+
+	g_array_free(plan->steps, TRUE);
+	g_free(plan);
+}
+
+static gboolean v4l2_fmt_plan_match(gpointer key, gpointer value,
+				    gpointer vsrc)
+{
+	const struct v4l2_fmt_plan *plan = value;
+
+	return plan->vsrc == vsrc;
+}
+
+void v4l2_fmt_plans_free(const struct vlib_vdev *vsrc)
+{
+	g_mutex_lock(&subdev_pool_lock);
+	if (fmt_plans)
+		g_hash_table_foreach_remove(fmt_plans, v4l2_fmt_plan_match,
+					    (gpointer)vsrc);
+	g_mutex_unlock(&subdev_pool_lock);
+}
+
+struct v4l2_fmt_plan *v4l2_fmt_plan_get(const struct vlib_vdev *vsrc,
+					const struct v4l2_fmt_plan_key *key,
+					int *compile)
+{
+	struct v4l2_fmt_plan *plan;
+	char *name;
+
+	if (!vsrc || !key || !compile) {
+		return NULL;
+	}
+
+	name = g_strdup_printf("%p:%zux%zu:%zux%zu:%08x:%04x", (void *)vsrc,
+			       key->in_width, key->in_height, key->width,
+			       key->height, key->fourcc, key->in_code);
+
+	g_mutex_lock(&subdev_pool_lock);
+	if (!fmt_plans)
+		fmt_plans = g_hash_table_new_full(g_str_hash, g_str_equal,
+						  g_free, v4l2_fmt_plan_free);
+
+	plan = g_hash_table_lookup(fmt_plans, name);
+	*compile = !plan;
+	if (!plan) {
+		plan = g_new0(struct v4l2_fmt_plan, 1);
+		plan->vsrc = vsrc;
+		plan->steps = g_array_new(FALSE, FALSE,
+					  sizeof(struct v4l2_fmt_step));
+		plan->created_ns = v4l2_now_ns();
+		g_hash_table_insert(fmt_plans, name, plan);
+		name = NULL;
+	}
+	g_mutex_unlock(&subdev_pool_lock);
+	g_free(name);
+
+	return plan;
+}
+
+static void v4l2_fmt_plan_add_step(struct v4l2_fmt_plan *plan, const char *name,
+				   unsigned int pad, int from)
+{
+	struct v4l2_fmt_step step;
+
+	memset(&step, 0, sizeof(step));
+	step.name = name;
+	step.fd = v4l2_subdev_fd(plan->vsrc, name);
+	step.from = from;
+	step.fmt.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+	step.fmt.pad = pad;
+
+	/* keep colorspace and friends, as media-ctl does */
+	if (ioctl(step.fd, VIDIOC_SUBDEV_G_FMT, &step.fmt) < 0)
+		vlib_dbg("VIDIOC_SUBDEV_G_FMT on '%s':%u failed: %s\n", name,
+			 pad, ERRSTR);
+	step.fmt.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+	step.fmt.pad = pad;
+
+	g_array_append_val(plan->steps, step);
+}
+
+int v4l2_fmt_plan_add(struct v4l2_fmt_plan *plan, const char *name,
+		      unsigned int pad, const char *fmt, unsigned int width,
+		      unsigned int height)
+{
+	struct media_device *media;
+	struct media_pad *mpad;
+	struct v4l2_fmt_step *step;
+	enum v4l2_mbus_pixelcode code;
+	unsigned int i, n;
+	int idx;
+
+	if (!plan || !name || !fmt) {
+		return VLIB_ERROR_INVALID_PARAM;
+	}
+
+	media = vlib_vdev_get_mdev(plan->vsrc);
+	mpad = media_cache_get_pad(media, name, pad);
+	ASSERT2(mpad, "Pad '%s':%u not found\n", name, pad);
+
+	code = v4l2_subdev_string_to_pixelcode(fmt);
+	ASSERT2(code != (enum v4l2_mbus_pixelcode)-1,
+		"Unknown media bus format '%s'\n", fmt);
+
+	idx = plan->steps->len;
+	v4l2_fmt_plan_add_step(plan, media_entity_get_info(mpad->entity)->name,
+			       pad, -1);
+	step = &g_array_index(plan->steps, struct v4l2_fmt_step, idx);
+	step->fmt.format.code = code;
+	step->fmt.format.width = width;
+	step->fmt.format.height = height;
+	step->fmt.format.field = V4L2_FIELD_NONE;
+
+	if (!(mpad->flags & MEDIA_PAD_FL_SOURCE))
+		return VLIB_SUCCESS;
+
+	n = media_entity_get_links_count(mpad->entity);
+	for (i = 0; i < n; i++) {
+		const struct media_link *link =
+			media_entity_get_link(mpad->entity, i);
+
+		if (link->source != mpad ||
+		    !(link->flags & MEDIA_LNK_FL_ENABLED) ||
+		    media_entity_type(link->sink->entity) !=
+		    MEDIA_ENT_T_V4L2_SUBDEV)
+			continue;
+
+		v4l2_fmt_plan_add_step(plan,
+				       media_entity_get_info(link->sink->entity)->name,
+				       link->sink->index, idx);
+	}
+
+	return VLIB_SUCCESS;
+}
+
+int v4l2_fmt_plan_apply(struct v4l2_fmt_plan *plan)
+{
+	struct v4l2_fmt_step *step, *from;
+	uint64_t start;
+	unsigned int i;
+	int ret;
+
+	if (!plan) {
+		return VLIB_ERROR_INVALID_PARAM;
+	}
+
+	start = v4l2_now_ns();
+	if (!plan->applied)
+		plan->compile_ns = start - plan->created_ns;
+
+	vlib_trace_begin("v4l2_fmt_plan_apply");
+	for (i = 0; i < plan->steps->len; i++) {
+		step = &g_array_index(plan->steps, struct v4l2_fmt_step, i);
+		if (step->from >= 0) {
+			/* propagate what the driver accepted upstream */
+			from = &g_array_index(plan->steps,
+					      struct v4l2_fmt_step, step->from);
+			step->fmt.format = from->fmt.format;
+		}
+
+		ret = ioctl(step->fd, VIDIOC_SUBDEV_S_FMT, &step->fmt);
+		if (ret < 0) {
+			ret = -errno;
+			vlib_trace_end("v4l2_fmt_plan_apply");
+			VLIB_REPORT_ERR("VIDIOC_SUBDEV_S_FMT on '%s':%u failed: %s",
+					step->name, step->fmt.pad,
+					strerror(-ret));
+			return ret;
+		}
+	}
+	vlib_trace_end("v4l2_fmt_plan_apply");
+
+	plan->applied++;
+	vlib_dbg("format plan: %u pads in %llu us (compiled in %llu us, %u uses)\n",
+		 plan->steps->len,
+		 (unsigned long long)(v4l2_now_ns() - start) / 1000,
+		 (unsigned long long)plan->compile_ns / 1000, plan->applied);
+
 	return VLIB_SUCCESS;
 }
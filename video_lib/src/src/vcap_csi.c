@@ -75,17 +75,6 @@
 
 static unsigned int act_lanes = CSI_ACT_LANES;
 
-static int v4l2_csi_set_ctrl(const struct vlib_vdev *vd, int id, int value)
-{
-	return v4l2_set_ctrl(vd, MEDIA_CSI_ENTITY, id, value);
-}
-
-static void csi_set_act_lanes(const struct vlib_vdev *vd, unsigned int lanes)
-{
-	v4l2_csi_set_ctrl(vd, V4L2_CID_XILINX_MIPICSISS_ACT_LANES, lanes);
-	act_lanes = lanes;
-}
-
 #define GAMMA_BLUE_COR	10 /* 10 equals passthrough */
 #define GAMMA_GREEN_COR	10 /* 10 equals passthrough */
 #define GAMMA_RED_COR	10 /* 10 equals passthrough */
@@ -317,13 +306,14 @@ static void vcap_csi_find_sensor_res(size_t *width, size_t *height)
 static int vcap_csi_ops_set_media_ctrl(struct video_pipeline *video_setup,
 				       const struct vlib_vdev *vdev)
 {
-	int ret;
-	char media_formats[100];
+	int ret, compile;
+	struct v4l2_fmt_plan_key key;
+	struct v4l2_fmt_plan *plan;
 	struct media_device *media = vlib_vdev_get_mdev(vdev);
 
-	/* Enumerate entities, pads and links */
-	ret = media_device_enumerate(media);
-	ASSERT2(ret >= 0, "failed to enumerate %s\n", vdev->display_text);
+	/* Entities, pads and links are cached, refresh if the graph changed */
+	ret = media_cache_validate(media);
+	ASSERT2(!ret, "failed to enumerate %s\n", vdev->display_text);
 
 #ifdef VLIB_LOG_LEVEL_DEBUG
 	const struct media_device_info *info = media_get_info(media);
@@ -335,84 +325,59 @@ static int vcap_csi_ops_set_media_ctrl(struct video_pipeline *video_setup,
 
 	vcap_csi_find_sensor_res(&sensor_width, &sensor_height);
 
-	/* Set image sensor format */
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_SENSOR_ENTITY, 0,
-			  MEDIA_SENSOR_FMT_OUT,
-			  sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats: %s (%d)\n", strerror(-ret),
-		-ret);
-
-	/* Set MIPI CSI2 Rx format */
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_CSI_ENTITY, 0, MEDIA_CSI_FMT_IN,
-			  sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats: %s (%d)\n", strerror(-ret),
-		-ret);
-
-	/* Set Demosaic format */
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_DMSC_ENTITY, 0,
-			  MEDIA_DMSC_FMT_IN,
-			  sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats: %s (%d)\n", strerror(-ret),
-		-ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_DMSC_ENTITY, 1,
-			  MEDIA_DMSC_FMT_OUT,
-			  sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats: %s (%d)\n", strerror(-ret),
-		-ret);
-
-	/* Set Gamma format */
-	memset (media_formats, 0, sizeof (media_formats));
-	media_set_fmt_str(media_formats, MEDIA_GAMMA_ENTITY, 0,
-			  MEDIA_GAMMA_FMT_IN,
-			  sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats: %s (%d)\n", strerror(-ret),
-		-ret);
-	memset (media_formats, 0, sizeof (media_formats));
-	media_set_fmt_str(media_formats, MEDIA_GAMMA_ENTITY, 1,
-			  MEDIA_GAMMA_FMT_OUT,
-			  sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats: %s (%d)\n", strerror(-ret),
-		-ret);
-
-	/* Set CSC format */
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_CSC_ENTITY, 0,
-			  MEDIA_CSC_FMT_IN,
-			  sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats: %s (%d)\n", strerror(-ret),
-		-ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_CSC_ENTITY, 1,
-			  MEDIA_CSC_FMT_OUT,
-			  sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats: %s (%d)\n", strerror(-ret),
-		-ret);
+	memset(&key, 0, sizeof(key));
+	key.in_width = sensor_width;
+	key.in_height = sensor_height;
+	key.width = video_setup->w;
+	key.height = video_setup->h;
+	key.fourcc = video_setup->in_fourcc;
+	plan = v4l2_fmt_plan_get(vdev, &key, &compile);
+	ASSERT2(plan, "failed to get format plan for %s\n", vdev->display_text);
+
+	if (compile) {
+		/* Set image sensor format */
+		v4l2_fmt_plan_add(plan, MEDIA_SENSOR_ENTITY, 0,
+				  MEDIA_SENSOR_FMT_OUT,
+				  sensor_width, sensor_height);
+
+		/* Set MIPI CSI2 Rx format */
+		v4l2_fmt_plan_add(plan, MEDIA_CSI_ENTITY, 0, MEDIA_CSI_FMT_IN,
+				  sensor_width, sensor_height);
+
+		/* Set Demosaic format */
+		v4l2_fmt_plan_add(plan, MEDIA_DMSC_ENTITY, 0,
+				  MEDIA_DMSC_FMT_IN,
+				  sensor_width, sensor_height);
+		v4l2_fmt_plan_add(plan, MEDIA_DMSC_ENTITY, 1,
+				  MEDIA_DMSC_FMT_OUT,
+				  sensor_width, sensor_height);
+
+		/* Set Gamma format */
+		v4l2_fmt_plan_add(plan, MEDIA_GAMMA_ENTITY, 0,
+				  MEDIA_GAMMA_FMT_IN,
+				  sensor_width, sensor_height);
+		v4l2_fmt_plan_add(plan, MEDIA_GAMMA_ENTITY, 1,
+				  MEDIA_GAMMA_FMT_OUT,
+				  sensor_width, sensor_height);
+
+		/* Set CSC format */
+		v4l2_fmt_plan_add(plan, MEDIA_CSC_ENTITY, 0,
+				  MEDIA_CSC_FMT_IN,
+				  sensor_width, sensor_height);
+		v4l2_fmt_plan_add(plan, MEDIA_CSC_ENTITY, 1,
+				  MEDIA_CSC_FMT_OUT,
+				  sensor_width, sensor_height);
+
+		/* Set Scaler format */
+		v4l2_fmt_plan_add(plan, MEDIA_SCALER_ENTITY, 0,
+				  MEDIA_SCALER_FMT_IN,
+				  sensor_width, sensor_height);
+		v4l2_fmt_plan_add(plan, MEDIA_SCALER_ENTITY, 1,
+				  vlib_fourcc2mbus(video_setup->in_fourcc),
+				  video_setup->w, video_setup->h);
+	}
 
-	/* Set Scaler format */
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_SCALER_ENTITY, 0,
-			  MEDIA_SCALER_FMT_IN,
-			  sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats: %s (%d)\n", strerror(-ret),
-		-ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_SCALER_ENTITY, 1,
-			  vlib_fourcc2mbus(video_setup->in_fourcc),
-			  video_setup->w, video_setup->h);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
+	ret = v4l2_fmt_plan_apply(plan);
 	ASSERT2(!ret, "Unable to setup formats: %s (%d)\n", strerror(-ret),
 		-ret);
 
@@ -460,6 +425,7 @@ static const struct vsrc_ops vcap_csi_ops = {
 
 struct vlib_vdev *vcap_csi_init(const struct matchtable *mte, void *media)
 {
+	struct v4l2_ctrl_txn *txn;
 	struct vlib_vdev *vd = calloc(1, sizeof(*vd));
 	if (!vd) {
 		return NULL;
@@ -478,26 +444,42 @@ struct vlib_vdev *vcap_csi_init(const struct matchtable *mte, void *media)
 		return NULL;
 	}
 
+	/* All defaults go out as one VIDIOC_S_EXT_CTRLS per subdevice */
+	txn = v4l2_ctrl_txn_begin(vd);
+
 	/* Set active number of lanes */
-	csi_set_act_lanes(vd, act_lanes);
+	v4l2_ctrl_txn_set(txn, MEDIA_CSI_ENTITY,
+			  V4L2_CID_XILINX_MIPICSISS_ACT_LANES, act_lanes);
 
 	/* Set gamma correction */
-	gamma_set_blue_correction(vd, blue_cor);
-	gamma_set_green_correction(vd, green_cor);
-	gamma_set_red_correction(vd, red_cor);
+	v4l2_ctrl_txn_set(txn, MEDIA_GAMMA_ENTITY,
+			  V4L2_CID_XILINX_GAMMA_CORR_BLUE_GAMMA, blue_cor);
+	v4l2_ctrl_txn_set(txn, MEDIA_GAMMA_ENTITY,
+			  V4L2_CID_XILINX_GAMMA_CORR_GREEN_GAMMA, green_cor);
+	v4l2_ctrl_txn_set(txn, MEDIA_GAMMA_ENTITY,
+			  V4L2_CID_XILINX_GAMMA_CORR_RED_GAMMA, red_cor);
 
 	/* Set CSC defaults */
-	csc_set_brightness(vd, brightness);
-	csc_set_contrast(vd, contrast);
-	csc_set_blue_gain(vd, blue_gain);
-	csc_set_green_gain(vd, green_gain);
-	csc_set_red_gain(vd, red_gain);
+	v4l2_ctrl_txn_set(txn, MEDIA_CSC_ENTITY, V4L2_CID_XILINX_CSC_BRIGHTNESS,
+			  brightness);
+	v4l2_ctrl_txn_set(txn, MEDIA_CSC_ENTITY, V4L2_CID_XILINX_CSC_CONTRAST,
+			  contrast);
+	v4l2_ctrl_txn_set(txn, MEDIA_CSC_ENTITY, V4L2_CID_XILINX_CSC_BLUE_GAIN,
+			  blue_gain);
+	v4l2_ctrl_txn_set(txn, MEDIA_CSC_ENTITY, V4L2_CID_XILINX_CSC_GREEN_GAIN,
+			  green_gain);
+	v4l2_ctrl_txn_set(txn, MEDIA_CSC_ENTITY, V4L2_CID_XILINX_CSC_RED_GAIN,
+			  red_gain);
 
 	/* Set sensor controls */
-	imx274_set_test_pattern(vd, test_pattern);
-	imx274_set_vertical_flip(vd, vertical_flip);
-	imx274_set_exposure(vd, exposure);
-	imx274_set_gain(vd, gain);
+	v4l2_ctrl_txn_set(txn, MEDIA_SENSOR_ENTITY, V4L2_CID_TEST_PATTERN,
+			  test_pattern);
+	v4l2_ctrl_txn_set(txn, MEDIA_SENSOR_ENTITY, V4L2_CID_VFLIP,
+			  vertical_flip);
+	v4l2_ctrl_txn_set(txn, MEDIA_SENSOR_ENTITY, V4L2_CID_EXPOSURE, exposure);
+	v4l2_ctrl_txn_set(txn, MEDIA_SENSOR_ENTITY, V4L2_CID_GAIN, gain);
+	v4l2_ctrl_txn_commit(txn);
+
 	imx274_init_test_pattern_names(vd);
 
 	return vd;
@@ -97,21 +97,28 @@
 #define MEDIA_SCALER3_ENTITY	"b3080000.scaler"
 #define MEDIA_SCALER3_FMT_IN	MEDIA_DMSC3_FMT_OUT
 
+/* Per sensor processing chain behind the AXI4-Stream switch */
+static const struct {
+	const char *dmsc;
+	const char *dmsc_fmt_in;
+	const char *dmsc_fmt_out;
+	const char *scaler;
+	const char *scaler_fmt_in;
+} gmsl_chain[] = {
+	{ MEDIA_DMSC0_ENTITY, MEDIA_DMSC0_FMT_IN, MEDIA_DMSC0_FMT_OUT,
+	  MEDIA_SCALER0_ENTITY, MEDIA_SCALER0_FMT_IN },
+	{ MEDIA_DMSC1_ENTITY, MEDIA_DMSC1_FMT_IN, MEDIA_DMSC1_FMT_OUT,
+	  MEDIA_SCALER1_ENTITY, MEDIA_SCALER1_FMT_IN },
+	{ MEDIA_DMSC2_ENTITY, MEDIA_DMSC2_FMT_IN, MEDIA_DMSC2_FMT_OUT,
+	  MEDIA_SCALER2_ENTITY, MEDIA_SCALER2_FMT_IN },
+	{ MEDIA_DMSC3_ENTITY, MEDIA_DMSC3_FMT_IN, MEDIA_DMSC3_FMT_OUT,
+	  MEDIA_SCALER3_ENTITY, MEDIA_SCALER3_FMT_IN },
+};
+
 #define GMSL_ACT_LANES		4
 
 static unsigned int act_lanes = GMSL_ACT_LANES;
 
-static int v4l2_gmsl_set_ctrl(const struct vlib_vdev *vd, int id, int value)
-{
-	return v4l2_set_ctrl(vd, MEDIA_GMSL_ENTITY, id, value);
-}
-
-static void gmsl_set_act_lanes(const struct vlib_vdev *vd, unsigned int lanes)
-{
-	v4l2_gmsl_set_ctrl(vd, V4L2_CID_XILINX_MIPICSISS_ACT_LANES, lanes);
-	act_lanes = lanes;
-}
-
 #define AR0231AT_VERTICAL_FLIP		0
 #define AR0231AT_HORIZONTAL_FLIP	0
 #define AR0231AT_TEST_PATTERN		0
@@ -323,13 +330,15 @@ static void vcap_gmsl_find_sensor_res(size_t *width, size_t *height)
 static int vcap_gmsl_ops_set_media_ctrl(struct video_pipeline *video_setup,
 				       const struct vlib_vdev *vdev)
 {
-	int ret;
-	char media_formats[100];
+	int ret, compile;
+	unsigned int i;
+	struct v4l2_fmt_plan_key key;
+	struct v4l2_fmt_plan *plan;
 	struct media_device *media = vlib_vdev_get_mdev(vdev);
 
-	/* Enumerate entities, pads and links */
-	ret = media_device_enumerate(media);
-	ASSERT2(ret >= 0, "failed to enumerate %s\n", vdev->display_text);
+	/* Entities, pads and links are cached, refresh if the graph changed */
+	ret = media_cache_validate(media);
+	ASSERT2(!ret, "failed to enumerate %s\n", vdev->display_text);
 
 #ifdef VLIB_LOG_LEVEL_DEBUG
 	const struct media_device_info *info = media_get_info(media);
@@ -341,232 +350,74 @@ static int vcap_gmsl_ops_set_media_ctrl(struct video_pipeline *video_setup,
 
 	vcap_gmsl_find_sensor_res(&sensor_width, &sensor_height);
 
-	/* Set image sensor format */
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, sensor_entity[0], 0,
-			  MEDIA_SENSOR_FMT_OUT, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		sensor_entity[0], 0, strerror(-ret), -ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, sensor_entity[1], 0,
-			  MEDIA_SENSOR_FMT_OUT, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		sensor_entity[1], 0, strerror(-ret), -ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, sensor_entity[2], 0,
-			  MEDIA_SENSOR_FMT_OUT, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		sensor_entity[2], 0, strerror(-ret), -ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, sensor_entity[3], 0,
-			  MEDIA_SENSOR_FMT_OUT, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		sensor_entity[3], 0, strerror(-ret), -ret);
-
-	/* Set MAX9286-SERDES format */
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, serdes_entity, 0,
-			  MEDIA_SERDES_FMT_IN, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		serdes_entity, 0, strerror(-ret), -ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, serdes_entity, 1,
-			  MEDIA_SERDES_FMT_OUT, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		serdes_entity, 1, strerror(-ret), -ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, serdes_entity, 2,
-			  MEDIA_SERDES_FMT_OUT, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		serdes_entity, 2, strerror(-ret), -ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, serdes_entity, 3,
-			  MEDIA_SERDES_FMT_OUT, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		serdes_entity, 3, strerror(-ret), -ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, serdes_entity, 4,
-			  MEDIA_SERDES_FMT_OUT, sensor_width,
-			  (GMSL_NUM_SENSORS*sensor_height));
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		serdes_entity, 4, strerror(-ret), -ret);
-
-	/* Set MIPI CSI2 Rx format */
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_GMSL_ENTITY, 0,
-			  MEDIA_GMSL_FMT_IN, sensor_width,
-			  (GMSL_NUM_SENSORS*sensor_height));
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		MEDIA_GMSL_ENTITY, 0, strerror(-ret), -ret);
-
-	/* Set AXI4-Stream Switch format */
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_AXI4SS_ENTITY, 0,
-			  MEDIA_AXI4SS_FMT_IN, sensor_width,
-			  (GMSL_NUM_SENSORS*sensor_height));
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		MEDIA_AXI4SS_ENTITY, 0, strerror(-ret), -ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_AXI4SS_ENTITY, 1,
-			  MEDIA_AXI4SS_FMT_OUT, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		MEDIA_AXI4SS_ENTITY, 1, strerror(-ret), -ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_AXI4SS_ENTITY, 2,
-			  MEDIA_AXI4SS_FMT_OUT, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		MEDIA_AXI4SS_ENTITY, 2, strerror(-ret), -ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_AXI4SS_ENTITY, 3,
-			  MEDIA_AXI4SS_FMT_OUT, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		MEDIA_AXI4SS_ENTITY, 3, strerror(-ret), -ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_AXI4SS_ENTITY, 4,
-			  MEDIA_AXI4SS_FMT_OUT, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		MEDIA_AXI4SS_ENTITY, 4, strerror(-ret), -ret);
-
-	/* Set Demosaic format */
-	/* demosaic_0 */
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_DMSC0_ENTITY, 0,
-			  MEDIA_DMSC0_FMT_IN, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		MEDIA_DMSC0_ENTITY, 0, strerror(-ret), -ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_DMSC0_ENTITY, 1,
-			  MEDIA_DMSC0_FMT_OUT, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		MEDIA_DMSC0_ENTITY, 1, strerror(-ret), -ret);
-	/* demosaic_1 */
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_DMSC1_ENTITY, 0,
-			  MEDIA_DMSC1_FMT_IN, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		MEDIA_DMSC1_ENTITY, 0, strerror(-ret), -ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_DMSC1_ENTITY, 1,
-			  MEDIA_DMSC1_FMT_OUT, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		MEDIA_DMSC1_ENTITY, 1, strerror(-ret), -ret);
-	/* demosaic_2 */
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_DMSC2_ENTITY, 0,
-			  MEDIA_DMSC2_FMT_IN, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		MEDIA_DMSC2_ENTITY, 0, strerror(-ret), -ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_DMSC2_ENTITY, 1,
-			  MEDIA_DMSC2_FMT_OUT, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		MEDIA_DMSC2_ENTITY, 1, strerror(-ret), -ret);
-	/* demosaic_3 */
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_DMSC3_ENTITY, 0,
-			  MEDIA_DMSC3_FMT_IN, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		MEDIA_DMSC3_ENTITY, 0, strerror(-ret), -ret);
-	memset(media_formats, 0, sizeof(media_formats));
-	media_set_fmt_str(media_formats, MEDIA_DMSC3_ENTITY, 1,
-			  MEDIA_DMSC3_FMT_OUT, sensor_width, sensor_height);
-	ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-	ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-		MEDIA_DMSC3_ENTITY, 1, strerror(-ret), -ret);
-
 	/* Set Scaler format based on selected video node */
 	unsigned int n = *(unsigned int *)vdev->priv;
 	ASSERT2(n < GMSL_NUM_SENSORS, "Sensor index out of bounds\r");
 
-	switch (n) {
-	case 0:
-		/* scaler_0 */
-		memset(media_formats, 0, sizeof(media_formats));
-		media_set_fmt_str(media_formats, MEDIA_SCALER0_ENTITY, 0,
-				  MEDIA_SCALER0_FMT_IN, sensor_width, sensor_height);
-		ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-		ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-			MEDIA_SCALER0_ENTITY, 0, strerror(-ret), -ret);
-		memset(media_formats, 0, sizeof(media_formats));
-		media_set_fmt_str(media_formats, MEDIA_SCALER0_ENTITY, 1,
-				  vlib_fourcc2mbus(video_setup->in_fourcc),
-				  video_setup->w, video_setup->h);
-		ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-		ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-			MEDIA_SCALER0_ENTITY, 1, strerror(-ret), -ret);
-		break;
-	case 1:
-		/* scaler_1 */
-		memset(media_formats, 0, sizeof(media_formats));
-		media_set_fmt_str(media_formats, MEDIA_SCALER1_ENTITY, 0,
-				  MEDIA_SCALER1_FMT_IN, sensor_width, sensor_height);
-		ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-		ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-			MEDIA_SCALER1_ENTITY, 0, strerror(-ret), -ret);
-		memset(media_formats, 0, sizeof(media_formats));
-		media_set_fmt_str(media_formats, MEDIA_SCALER1_ENTITY, 1,
-				  vlib_fourcc2mbus(video_setup->in_fourcc),
-				  video_setup->w, video_setup->h);
-		ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-		ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-			MEDIA_SCALER1_ENTITY, 1, strerror(-ret), -ret);
-		break;
-	case 2:
-		/* scaler_2 */
-		memset(media_formats, 0, sizeof(media_formats));
-		media_set_fmt_str(media_formats, MEDIA_SCALER2_ENTITY, 0,
-				  MEDIA_SCALER2_FMT_IN, sensor_width, sensor_height);
-		ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-		ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-			MEDIA_SCALER2_ENTITY, 0, strerror(-ret), -ret);
-		memset(media_formats, 0, sizeof(media_formats));
-		media_set_fmt_str(media_formats, MEDIA_SCALER2_ENTITY, 1,
+	memset(&key, 0, sizeof(key));
+	key.in_width = sensor_width;
+	key.in_height = sensor_height;
+	key.width = video_setup->w;
+	key.height = video_setup->h;
+	key.fourcc = video_setup->in_fourcc;
+	plan = v4l2_fmt_plan_get(vdev, &key, &compile);
+	ASSERT2(plan, "failed to get format plan for %s\n", vdev->display_text);
+
+	if (compile) {
+		/* Set image sensor format */
+		for (i = 0; i < GMSL_NUM_SENSORS; i++)
+			v4l2_fmt_plan_add(plan, sensor_entity[i], 0,
+					  MEDIA_SENSOR_FMT_OUT, sensor_width,
+					  sensor_height);
+
+		/* Set MAX9286-SERDES format */
+		v4l2_fmt_plan_add(plan, serdes_entity, 0, MEDIA_SERDES_FMT_IN,
+				  sensor_width, sensor_height);
+		for (i = 1; i < GMSL_NUM_SENSORS; i++)
+			v4l2_fmt_plan_add(plan, serdes_entity, i,
+					  MEDIA_SERDES_FMT_OUT, sensor_width,
+					  sensor_height);
+		v4l2_fmt_plan_add(plan, serdes_entity, GMSL_NUM_SENSORS,
+				  MEDIA_SERDES_FMT_OUT, sensor_width,
+				  (GMSL_NUM_SENSORS*sensor_height));
+
+		/* Set MIPI CSI2 Rx format */
+		v4l2_fmt_plan_add(plan, MEDIA_GMSL_ENTITY, 0, MEDIA_GMSL_FMT_IN,
+				  sensor_width,
+				  (GMSL_NUM_SENSORS*sensor_height));
+
+		/* Set AXI4-Stream Switch format */
+		v4l2_fmt_plan_add(plan, MEDIA_AXI4SS_ENTITY, 0,
+				  MEDIA_AXI4SS_FMT_IN, sensor_width,
+				  (GMSL_NUM_SENSORS*sensor_height));
+		for (i = 1; i <= GMSL_NUM_SENSORS; i++)
+			v4l2_fmt_plan_add(plan, MEDIA_AXI4SS_ENTITY, i,
+					  MEDIA_AXI4SS_FMT_OUT, sensor_width,
+					  sensor_height);
+
+		/* Set Demosaic format */
+		for (i = 0; i < GMSL_NUM_SENSORS; i++) {
+			v4l2_fmt_plan_add(plan, gmsl_chain[i].dmsc, 0,
+					  gmsl_chain[i].dmsc_fmt_in,
+					  sensor_width, sensor_height);
+			v4l2_fmt_plan_add(plan, gmsl_chain[i].dmsc, 1,
+					  gmsl_chain[i].dmsc_fmt_out,
+					  sensor_width, sensor_height);
+		}
+
+		/* Only the scaler of this video node is configured */
+		v4l2_fmt_plan_add(plan, gmsl_chain[n].scaler, 0,
+				  gmsl_chain[n].scaler_fmt_in,
+				  sensor_width, sensor_height);
+		v4l2_fmt_plan_add(plan, gmsl_chain[n].scaler, 1,
 				  vlib_fourcc2mbus(video_setup->in_fourcc),
 				  video_setup->w, video_setup->h);
-		ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-		ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-			MEDIA_SCALER2_ENTITY, 1, strerror(-ret), -ret);
-		break;
-	case 3:
-		/* scaler_3 */
-		memset(media_formats, 0, sizeof(media_formats));
-		media_set_fmt_str(media_formats, MEDIA_SCALER3_ENTITY, 0,
-				  MEDIA_SCALER3_FMT_IN, sensor_width, sensor_height);
-		ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-		ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-			MEDIA_SCALER3_ENTITY, 0, strerror(-ret), -ret);
-		memset(media_formats, 0, sizeof(media_formats));
-		media_set_fmt_str(media_formats, MEDIA_SCALER3_ENTITY, 1,
-				  vlib_fourcc2mbus(video_setup->in_fourcc),
-				  video_setup->w, video_setup->h);
-		ret = v4l2_subdev_parse_setup_formats(media, media_formats);
-		ASSERT2(!ret, "Unable to setup formats for %s pad%d: %s (%d)\n",
-			MEDIA_SCALER3_ENTITY, 1, strerror(-ret), -ret);
-		break;
 	}
 
+	ret = v4l2_fmt_plan_apply(plan);
+	ASSERT2(!ret, "Unable to setup formats: %s (%d)\n", strerror(-ret),
+		-ret);
+
 	return ret;
 }
 
@@ -606,6 +457,7 @@ struct vlib_vdev *vcap_gmsl_init(const struct matchtable *mte, void *media)
 {
 	unsigned int i, i2cbus;
 	int ret;
+	struct v4l2_ctrl_txn *txn;
 
 	struct vlib_vdev *vd = calloc(1, sizeof(*vd));
 	if (!vd) {
@@ -634,9 +486,6 @@ struct vlib_vdev *vcap_gmsl_init(const struct matchtable *mte, void *media)
 		return NULL;
 	}
 
-	/* Set active number of lanes */
-	gmsl_set_act_lanes(vd, act_lanes);
-
 	/* Get sensor i2c bus */
 	ret = ar0231at_get_i2cbus(&i2cbus);
 	ASSERT2(ret >= 0, "Failed to detect AR0231 i2c bus.\n");
@@ -646,18 +495,45 @@ struct vlib_vdev *vcap_gmsl_init(const struct matchtable *mte, void *media)
 	snprintf(sensor_entity[3], sizeof(sensor_entity[3]), MEDIA_SENSOR4_ENTITY, i2cbus);
 	snprintf(serdes_entity, sizeof(serdes_entity), MEDIA_SERDES_ENTITY, i2cbus);
 
-	/* Set sensor controls */
+	/* All defaults go out as one VIDIOC_S_EXT_CTRLS per subdevice */
+	txn = v4l2_ctrl_txn_begin(vd);
+
+	/* Set active number of lanes */
+	v4l2_ctrl_txn_set(txn, MEDIA_GMSL_ENTITY,
+			  V4L2_CID_XILINX_MIPICSISS_ACT_LANES, act_lanes);
+
+	/* Set sensor controls, every sensor starts from sensor 0 defaults */
 	for (i = 0; i < GMSL_NUM_SENSORS; i++) {
-		ar0231at_set_test_pattern(vd, i, test_pattern[0]);
-		ar0231at_set_exposure(vd, i, exposure[0]);
-		ar0231at_set_analog_gain(vd, i, analog_gain[0]);
-		ar0231at_set_digital_gain(vd, i, digital_gain[0]);
-		ar0231at_set_vertical_flip(vd, i, vertical_flip[0]);
-		ar0231at_set_horizontal_flip(vd, i, horizontal_flip[0]);
-		ar0231at_set_color_gain_red(vd, i, color_gain_red[0]);
-		ar0231at_set_color_gain_green(vd, i, color_gain_green[0]);
-		ar0231at_set_color_gain_blue(vd, i, color_gain_blue[0]);
+		test_pattern[i] = test_pattern[0];
+		exposure[i] = exposure[0];
+		analog_gain[i] = analog_gain[0];
+		digital_gain[i] = digital_gain[0];
+		vertical_flip[i] = vertical_flip[0];
+		horizontal_flip[i] = horizontal_flip[0];
+		color_gain_red[i] = color_gain_red[0];
+		color_gain_green[i] = color_gain_green[0];
+		color_gain_blue[i] = color_gain_blue[0];
+
+		v4l2_ctrl_txn_set(txn, sensor_entity[i], V4L2_CID_TEST_PATTERN,
+				  test_pattern[i]);
+		v4l2_ctrl_txn_set(txn, sensor_entity[i], V4L2_CID_EXPOSURE,
+				  exposure[i]);
+		v4l2_ctrl_txn_set(txn, sensor_entity[i], V4L2_CID_ANALOGUE_GAIN,
+				  analog_gain[i]);
+		v4l2_ctrl_txn_set(txn, sensor_entity[i], V4L2_CID_GAIN,
+				  digital_gain[i]);
+		v4l2_ctrl_txn_set(txn, sensor_entity[i], V4L2_CID_VFLIP,
+				  vertical_flip[i]);
+		v4l2_ctrl_txn_set(txn, sensor_entity[i], V4L2_CID_HFLIP,
+				  horizontal_flip[i]);
+		v4l2_ctrl_txn_set(txn, sensor_entity[i], V4L2_CID_RED_BALANCE,
+				  color_gain_red[i]);
+		v4l2_ctrl_txn_set(txn, sensor_entity[i], V4L2_CID_CHROMA_GAIN,
+				  color_gain_green[i]);
+		v4l2_ctrl_txn_set(txn, sensor_entity[i], V4L2_CID_BLUE_BALANCE,
+				  color_gain_blue[i]);
 	}
+	v4l2_ctrl_txn_commit(txn);
 	ar0231at_init_test_pattern_names(vd);
 
 	return vd;
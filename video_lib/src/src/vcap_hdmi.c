@@ -37,7 +37,11 @@
  * AT ALL TIMES.
  *******************************************************************************/
 #include <fcntl.h>
+#include <glib.h>
+#include <poll.h>
 #include <stdlib.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <mediactl/mediactl.h>
@@ -52,6 +56,16 @@
 #define MEDIA_G_DVTIMINGS_RETRY_CNT 10
 #define MEDIA_G_DVTIMINGS_RETRY_DLY_USEC 100000
 
+/*
+ * With V4L2_EVENT_SOURCE_CHANGE support the timings are re-queried every
+ * VCAP_HDMI_SETTLE_MS after an event until two reads agree, giving up after
+ * the same overall time the retry loop allows.
+ */
+#define VCAP_HDMI_SETTLE_MS	20
+#define VCAP_HDMI_LOCK_TIMEOUT_MS \
+	(MEDIA_G_DVTIMINGS_RETRY_CNT * MEDIA_G_DVTIMINGS_RETRY_DLY_USEC / 1000)
+#define VCAP_HDMI_SETTLE_TRIES	(VCAP_HDMI_LOCK_TIMEOUT_MS / VCAP_HDMI_SETTLE_MS)
+
 #if defined(PLATFORM_ZCU102)
 #define MEDIA_ADV7611_ENTITY	"adv7611 25-004c"
 #define MEDIA_HDMI_RXSS_ENTITY	"a1000000.hdmi_rxss"
@@ -81,6 +95,15 @@ struct vcap_hdmi_data {
 	size_t in_width;
 	size_t in_height;
 	unsigned int flags;
+
+	/* source change watcher, NULL if the receiver has no events */
+	GThread *watcher;
+	int watch_fd;		/* own reference, the subdev pool may be flushed */
+	int stop_fd;
+	GMutex lock;
+	GCond cond;
+	int locked;
+	struct v4l2_dv_timings timings;
 };
 #define VCAP_HDMI_FLAG_HAS_SCALER	BIT(0)
 
@@ -92,6 +115,183 @@ static int vcap_hdmi_has_scaler(const struct vlib_vdev *vd)
 	return !!(data->flags & VCAP_HDMI_HAS_SCALER);
 }
 
+static int vcap_hdmi_timings_equal(const struct v4l2_dv_timings *a,
+				   const struct v4l2_dv_timings *b)
+{
+	return a->bt.width == b->bt.width && a->bt.height == b->bt.height &&
+	       a->bt.interlaced == b->bt.interlaced &&
+	       a->bt.pixelclock == b->bt.pixelclock;
+}
+
+static gpointer vcap_hdmi_watch(gpointer arg)
+{
+	struct vlib_vdev *vd = arg;
+	struct vcap_hdmi_data *data = vd->priv;
+	int fd = data->watch_fd;
+	struct pollfd pfd[2] = {
+		{ .fd = fd, .events = POLLPRI },
+		{ .fd = data->stop_fd, .events = POLLIN },
+	};
+	struct v4l2_dv_timings cur, prev;
+	struct v4l2_event ev;
+	int have_prev = 0;
+	int tries = VCAP_HDMI_SETTLE_TRIES;	/* settle the initial state */
+	size_t width = 0, height = 0;
+	int ret;
+
+	for (;;) {
+		/* first read right away, then one per settle period */
+		ret = poll(pfd, 2, !tries ? -1 :
+			   tries == VCAP_HDMI_SETTLE_TRIES ? 0 :
+			   VCAP_HDMI_SETTLE_MS);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			VLIB_REPORT_ERR("HDMI Rx watcher poll failed: %s",
+					strerror(errno));
+			break;
+		}
+
+		if (pfd[1].revents || (pfd[0].revents & (POLLERR | POLLNVAL)))
+			break;
+
+		if (pfd[0].revents & POLLPRI) {
+			do {
+				memset(&ev, 0, sizeof(ev));
+				if (ioctl(fd, VIDIOC_DQEVENT, &ev) < 0)
+					break;
+			} while (ev.pending);
+
+			g_mutex_lock(&data->lock);
+			data->locked = 0;
+			g_mutex_unlock(&data->lock);
+
+			vlib_dbg("HDMI Rx source change\n");
+			have_prev = 0;
+			tries = VCAP_HDMI_SETTLE_TRIES;
+			continue;
+		}
+
+		if (ret || !tries)
+			continue;
+
+		tries--;
+		memset(&cur, 0, sizeof(cur));
+		if (ioctl(fd, VIDIOC_SUBDEV_QUERY_DV_TIMINGS, &cur) < 0) {
+			/* no signal, the next source change brings it back */
+			have_prev = 0;
+			continue;
+		}
+
+		if (!have_prev || !vcap_hdmi_timings_equal(&cur, &prev)) {
+			prev = cur;
+			have_prev = 1;
+			continue;
+		}
+
+		g_mutex_lock(&data->lock);
+		data->timings = cur;
+		data->locked = 1;
+		g_cond_broadcast(&data->cond);
+		g_mutex_unlock(&data->lock);
+
+		vlib_dbg("HDMI Rx locked to %ux%u after %d reads\n",
+			 cur.bt.width, cur.bt.height,
+			 VCAP_HDMI_SETTLE_TRIES - tries);
+		tries = 0;
+
+		if (width && (width != cur.bt.width || height != cur.bt.height))
+			vlib_video_src_notify_change(vd, cur.bt.width,
+						     cur.bt.height);
+		width = cur.bt.width;
+		height = cur.bt.height;
+	}
+
+	return NULL;
+}
+
+static void vcap_hdmi_watch_start(struct vlib_vdev *vd)
+{
+	struct vcap_hdmi_data *data = vd->priv;
+	struct v4l2_event_subscription sub;
+	int fd;
+
+	if (!media_cache_get_entity(vlib_vdev_get_mdev(vd), MEDIA_HDMI_ENTITY))
+		return;
+
+	fd = v4l2_subdev_fd(vd, MEDIA_HDMI_ENTITY);
+
+	memset(&sub, 0, sizeof(sub));
+	sub.type = V4L2_EVENT_SOURCE_CHANGE;
+	sub.id = MEDIA_HDMI_PAD;
+	if (ioctl(fd, VIDIOC_SUBSCRIBE_EVENT, &sub) < 0) {
+		vlib_dbg("HDMI Rx has no source change events: %s\n", ERRSTR);
+		return;
+	}
+
+	/* the subscription belongs to the open file, the duplicate shares it */
+	data->watch_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+	if (data->watch_fd < 0) {
+		VLIB_REPORT_ERR("failed to duplicate HDMI Rx fd: %s", ERRSTR);
+		return;
+	}
+
+	data->stop_fd = eventfd(0, EFD_CLOEXEC);
+	if (data->stop_fd < 0) {
+		VLIB_REPORT_ERR("eventfd failed: %s", strerror(errno));
+		close(data->watch_fd);
+		return;
+	}
+
+	g_mutex_init(&data->lock);
+	g_cond_init(&data->cond);
+	data->locked = 0;
+	data->watcher = g_thread_new("vcap-hdmi-watch", vcap_hdmi_watch, vd);
+}
+
+static void vcap_hdmi_ops_release(struct vlib_vdev *vd)
+{
+	struct vcap_hdmi_data *data = vd->priv;
+
+	if (!data || !data->watcher)
+		return;
+
+	eventfd_write(data->stop_fd, 1);
+	g_thread_join(data->watcher);
+	data->watcher = NULL;
+	close(data->watch_fd);
+	close(data->stop_fd);
+	g_cond_clear(&data->cond);
+	g_mutex_clear(&data->lock);
+}
+
+/*
+ * Wait until the watcher reports stable timings, matching @width x @height
+ * unless both are 0. Returns the last locked timings, -ETIMEDOUT if the
+ * receiver did not lock in time.
+ */
+static int vcap_hdmi_wait_timings(struct vcap_hdmi_data *data,
+				  struct v4l2_dv_timings *timings,
+				  size_t width, size_t height)
+{
+	gint64 end = g_get_monotonic_time() +
+		     VCAP_HDMI_LOCK_TIMEOUT_MS * G_TIME_SPAN_MILLISECOND;
+	int locked;
+
+	g_mutex_lock(&data->lock);
+	while (!data->locked || (width &&
+	       (data->timings.bt.width != width ||
+		data->timings.bt.height != height))) {
+		if (!g_cond_wait_until(&data->cond, &data->lock, end))
+			break;
+	}
+	locked = data->locked;
+	*timings = data->timings;
+	g_mutex_unlock(&data->lock);
+
+	return locked ? 0 : -ETIMEDOUT;
+}
+
 static int vcap_hdmi_ops_set_media_ctrl(struct video_pipeline *video_setup,
 					const struct vlib_vdev *vdev)
 {
@@ -99,7 +299,9 @@ static int vcap_hdmi_ops_set_media_ctrl(struct video_pipeline *video_setup,
 	struct media_pad *pad;
 	struct v4l2_dv_timings timings;
 	int retry_cnt = MEDIA_G_DVTIMINGS_RETRY_CNT;
-	char fmt_str[100];
+	int compile;
+	struct v4l2_fmt_plan_key key;
+	struct v4l2_fmt_plan *plan;
 	struct media_device *media = vlib_vdev_get_mdev(vdev);
 	struct v4l2_mbus_framefmt format;
 	const char* fmt_code;
@@ -107,9 +309,9 @@ static int vcap_hdmi_ops_set_media_ctrl(struct video_pipeline *video_setup,
 
 	ASSERT2(data, "no private data found\n");
 
-	/* Enumerate entities, pads and links */
-	ret = media_device_enumerate(media);
-	ASSERT2(ret >= 0, "failed to enumerate %s\n", vdev->display_text);
+	/* Entities, pads and links are cached, refresh if the graph changed */
+	ret = media_cache_validate(media);
+	ASSERT2(!ret, "failed to enumerate %s\n", vdev->display_text);
 
 #ifdef VLIB_LOG_LEVEL_DEBUG
 	const struct media_device_info *info = media_get_info(media);
@@ -117,29 +319,40 @@ static int vcap_hdmi_ops_set_media_ctrl(struct video_pipeline *video_setup,
 #endif
 
 	/* Get HDMI Rx pad */
-	memset(fmt_str, 0, sizeof(fmt_str));
-	media_set_pad_str(fmt_str, MEDIA_HDMI_ENTITY, MEDIA_HDMI_PAD);
-	pad = media_parse_pad(media, fmt_str, NULL);
-	ASSERT2(pad, "Pad '%s' not found\n", fmt_str);
-
-	/* Repeat query dv_timings as occasionally the reported timings are incorrect */
-	do {
-		retry_query_timing:
-		ret = v4l2_subdev_query_dv_timings(pad->entity, &timings);
-		if (ret < 0 && retry_cnt--) {
-			/* Delay dv_timings query in-case of failure */
-			usleep(MEDIA_G_DVTIMINGS_RETRY_DLY_USEC);
-			goto retry_query_timing;
-		}
-	} while (!vcap_hdmi_has_scaler(vdev) &&
-		 (timings.bt.width != video_setup->w ||
-		 timings.bt.height != video_setup->h || !retry_cnt--));
-	ASSERT2(!(ret), "Failed to query DV timings: %s\n", strerror(-ret));
-	ASSERT2(!(retry_cnt < 0), "Incorrect HDMI Rx DV timings: %dx%d\n",
-		timings.bt.width, timings.bt.height);
-
-	if (retry_cnt < MEDIA_G_DVTIMINGS_RETRY_CNT)
-		vlib_dbg("Link to HDMI source recovered (required retries: %d)\n", MEDIA_G_DVTIMINGS_RETRY_CNT-retry_cnt);
+	pad = media_cache_get_pad(media, MEDIA_HDMI_ENTITY, MEDIA_HDMI_PAD);
+	ASSERT2(pad, "Pad '%s':%d not found\n", MEDIA_HDMI_ENTITY, MEDIA_HDMI_PAD);
+
+	if (data->watcher) {
+		/* Timings are reported as soon as the link is stable */
+		ret = vcap_hdmi_wait_timings(data, &timings,
+					     vcap_hdmi_has_scaler(vdev) ? 0 : video_setup->w,
+					     vcap_hdmi_has_scaler(vdev) ? 0 : video_setup->h);
+		ASSERT2(!(ret), "Failed to query DV timings: %s\n", strerror(-ret));
+		ASSERT2(vcap_hdmi_has_scaler(vdev) ||
+			(timings.bt.width == video_setup->w &&
+			 timings.bt.height == video_setup->h),
+			"Incorrect HDMI Rx DV timings: %dx%d\n",
+			timings.bt.width, timings.bt.height);
+	} else {
+		/* Repeat query dv_timings as occasionally the reported timings are incorrect */
+		do {
+			retry_query_timing:
+			ret = v4l2_subdev_query_dv_timings(pad->entity, &timings);
+			if (ret < 0 && retry_cnt--) {
+				/* Delay dv_timings query in-case of failure */
+				usleep(MEDIA_G_DVTIMINGS_RETRY_DLY_USEC);
+				goto retry_query_timing;
+			}
+		} while (!vcap_hdmi_has_scaler(vdev) &&
+			 (timings.bt.width != video_setup->w ||
+			 timings.bt.height != video_setup->h || !retry_cnt--));
+		ASSERT2(!(ret), "Failed to query DV timings: %s\n", strerror(-ret));
+		ASSERT2(!(retry_cnt < 0), "Incorrect HDMI Rx DV timings: %dx%d\n",
+			timings.bt.width, timings.bt.height);
+
+		if (retry_cnt < MEDIA_G_DVTIMINGS_RETRY_CNT)
+			vlib_dbg("Link to HDMI source recovered (required retries: %d)\n", MEDIA_G_DVTIMINGS_RETRY_CNT-retry_cnt);
+	}
 
 #ifdef HDMI_ADV7611
 	/* Set HDMI Rx DV timing */
@@ -147,10 +360,16 @@ static int vcap_hdmi_ops_set_media_ctrl(struct video_pipeline *video_setup,
 	ASSERT2(!(ret < 0), "Failed to set DV timings: %s\n", strerror(-ret));
 
 	/* Set HDMI Rx resolution */
-	memset(fmt_str, 0, sizeof(fmt_str));
-	media_set_fmt_str(fmt_str, MEDIA_HDMI_ENTITY, 1, MEDIA_HDMI_FMT_OUT,
-			  data->in_width, data->in_height);
-	ret = v4l2_subdev_parse_setup_formats(media, fmt_str);
+	memset(&key, 0, sizeof(key));
+	key.in_width = data->in_width;
+	key.in_height = data->in_height;
+	plan = v4l2_fmt_plan_get(vdev, &key, &compile);
+	ASSERT2(plan, "failed to get format plan for %s\n", vdev->display_text);
+	if (compile)
+		v4l2_fmt_plan_add(plan, MEDIA_HDMI_ENTITY, 1,
+				  MEDIA_HDMI_FMT_OUT, data->in_width,
+				  data->in_height);
+	ret = v4l2_fmt_plan_apply(plan);
 	ASSERT2(!(ret), "Unable to setup formats: %s (%d)\n", strerror(-ret),
 		-ret);
 #endif
@@ -166,18 +385,27 @@ static int vcap_hdmi_ops_set_media_ctrl(struct video_pipeline *video_setup,
 
 	/* Set Scaler resolution */
 	if (vcap_hdmi_has_scaler(vdev)) {
-		memset(fmt_str, 0, sizeof(fmt_str));
-		media_set_fmt_str(fmt_str, MEDIA_SCALER_ENTITY, 0, fmt_code,
-				  data->in_width, data->in_height);
-		ret = v4l2_subdev_parse_setup_formats(media, fmt_str);
-		ASSERT2(!(ret), "Unable to setup formats: %s (%d)\n",
-			strerror(-ret), -ret);
+		memset(&key, 0, sizeof(key));
+		key.in_width = data->in_width;
+		key.in_height = data->in_height;
+		key.width = video_setup->w;
+		key.height = video_setup->h;
+		key.fourcc = video_setup->in_fourcc;
+		key.in_code = format.code;
+		plan = v4l2_fmt_plan_get(vdev, &key, &compile);
+		ASSERT2(plan, "failed to get format plan for %s\n",
+			vdev->display_text);
+
+		if (compile) {
+			v4l2_fmt_plan_add(plan, MEDIA_SCALER_ENTITY, 0,
+					  fmt_code, data->in_width,
+					  data->in_height);
+			v4l2_fmt_plan_add(plan, MEDIA_SCALER_ENTITY, 1,
+					  vlib_fourcc2mbus(video_setup->in_fourcc),
+					  video_setup->w, video_setup->h);
+		}
 
-		memset(fmt_str, 0, sizeof(fmt_str));
-		media_set_fmt_str(fmt_str, MEDIA_SCALER_ENTITY, 1,
-				  vlib_fourcc2mbus(video_setup->in_fourcc),
-				  video_setup->w, video_setup->h);
-		ret = v4l2_subdev_parse_setup_formats(media, fmt_str);
+		ret = v4l2_fmt_plan_apply(plan);
 		ASSERT2(!(ret), "Unable to setup formats: %s (%d)\n",
 			strerror(-ret), -ret);
 	}
@@ -197,11 +425,14 @@ static int vcap_hdmi_ops_change_mode(struct video_pipeline *video_setup,
 	ASSERT2(data, "no private data found\n");
 
 	/* Query input resolution */
-	ret = query_entity_dv_timings(vdev, MEDIA_HDMI_ENTITY, MEDIA_HDMI_PAD,
-				      &dv_timings);
+	if (data->watcher)
+		ret = vcap_hdmi_wait_timings(data, &dv_timings, 0, 0);
+	else
+		ret = query_entity_dv_timings(vdev, MEDIA_HDMI_ENTITY,
+					      MEDIA_HDMI_PAD, &dv_timings);
 	if (ret) {
 		VLIB_REPORT_ERR("Query DV timings failed: %s",
-				strerror(errno));
+				strerror(-ret));
 		return VLIB_ERROR_CAPTURE;
 	}
 
@@ -223,6 +454,8 @@ static int vcap_hdmi_ops_change_mode(struct video_pipeline *video_setup,
 static const struct vsrc_ops vcap_hdmi_ops = {
 	.change_mode = vcap_hdmi_ops_change_mode,
 	.set_media_ctrl = vcap_hdmi_ops_set_media_ctrl,
+	.release = vcap_hdmi_ops_release,
+	.reopen = vcap_hdmi_watch_start,
 };
 
 struct vlib_vdev *vcap_hdmi_init(const struct matchtable *mte, void *media)
@@ -240,6 +473,8 @@ struct vlib_vdev *vcap_hdmi_init(const struct matchtable *mte, void *media)
 
 	if (VCAP_HDMI_HAS_SCALER) {
 		data->flags |= VCAP_HDMI_FLAG_HAS_SCALER;
+	} else {
+		vd->flags |= VDEV_FIXED_INPUT;
 	}
 
 	vd->vsrc_type = VSRC_TYPE_MEDIA;
@@ -258,5 +493,7 @@ struct vlib_vdev *vcap_hdmi_init(const struct matchtable *mte, void *media)
 		return NULL;
 	}
 
+	vcap_hdmi_watch_start(vd);
+
 	return vd;
 }
@@ -198,30 +198,45 @@ void tpg_set_zplate_ver_cntl_delta(const struct vlib_vdev *vd, unsigned int vspe
 
 static void tpg_set_cur_config(const struct vlib_vdev *vd)
 {
-	/* Set current TPG config */
-	tpg_set_bg_pattern(vd, bg_pattern);
-	tpg_set_fg_pattern(vd, fg_pattern);
-	tpg_set_box_size(vd, box_size);
-	tpg_set_box_color(vd, box_color);
-	tpg_set_box_speed(vd, box_speed);
-	tpg_set_cross_hair_num_rows(vd, cross_hair_row);
-	tpg_set_cross_hair_num_columns(vd, cross_hair_column);
-	tpg_set_zplate_hor_cntl_start(vd, zplate_hor_start);
-	tpg_set_zplate_hor_cntl_delta(vd, zplate_hor_speed);
-	tpg_set_zplate_ver_cntl_start(vd, zplate_ver_start);
-	tpg_set_zplate_ver_cntl_delta(vd, zplate_ver_speed);
+	struct v4l2_ctrl_txn *txn = v4l2_ctrl_txn_begin(vd);
+
+	/* Set current TPG config in one VIDIOC_S_EXT_CTRLS */
+	v4l2_ctrl_txn_set(txn, MEDIA_TPG_ENTITY, V4L2_CID_TEST_PATTERN,
+			  bg_pattern);
+	v4l2_ctrl_txn_set(txn, MEDIA_TPG_ENTITY,
+			  V4L2_CID_XILINX_TPG_HLS_FG_PATTERN, fg_pattern);
+	v4l2_ctrl_txn_set(txn, MEDIA_TPG_ENTITY, V4L2_CID_XILINX_TPG_BOX_SIZE,
+			  box_size);
+	v4l2_ctrl_txn_set(txn, MEDIA_TPG_ENTITY, V4L2_CID_XILINX_TPG_BOX_COLOR,
+			  box_color);
+	v4l2_ctrl_txn_set(txn, MEDIA_TPG_ENTITY,
+			  V4L2_CID_XILINX_TPG_MOTION_SPEED, box_speed);
+	v4l2_ctrl_txn_set(txn, MEDIA_TPG_ENTITY,
+			  V4L2_CID_XILINX_TPG_CROSS_HAIR_COLUMN, cross_hair_row);
+	v4l2_ctrl_txn_set(txn, MEDIA_TPG_ENTITY,
+			  V4L2_CID_XILINX_TPG_CROSS_HAIR_ROW, cross_hair_column);
+	v4l2_ctrl_txn_set(txn, MEDIA_TPG_ENTITY,
+			  V4L2_CID_XILINX_TPG_ZPLATE_HOR_START, zplate_hor_start);
+	v4l2_ctrl_txn_set(txn, MEDIA_TPG_ENTITY,
+			  V4L2_CID_XILINX_TPG_ZPLATE_HOR_SPEED, zplate_hor_speed);
+	v4l2_ctrl_txn_set(txn, MEDIA_TPG_ENTITY,
+			  V4L2_CID_XILINX_TPG_ZPLATE_VER_START, zplate_ver_start);
+	v4l2_ctrl_txn_set(txn, MEDIA_TPG_ENTITY,
+			  V4L2_CID_XILINX_TPG_ZPLATE_VER_SPEED, zplate_ver_speed);
+	v4l2_ctrl_txn_commit(txn);
 }
 
 static int vcap_tpg_ops_set_media_ctrl(struct video_pipeline *video_setup,
 				       const struct vlib_vdev *vdev)
 {
-	int ret;
-	char fmt_str[100];
+	int ret, compile;
+	struct v4l2_fmt_plan_key key;
+	struct v4l2_fmt_plan *plan;
 	struct media_device *media = vlib_vdev_get_mdev(vdev);
 
-	/* Enumerate entities, pads and links */
-	ret = media_device_enumerate(media);
-	ASSERT2(ret >= 0, "failed to enumerate %s\n", vdev->display_text);
+	/* Entities, pads and links are cached, refresh if the graph changed */
+	ret = media_cache_validate(media);
+	ASSERT2(!ret, "failed to enumerate %s\n", vdev->display_text);
 
 #ifdef VLIB_LOG_LEVEL_DEBUG
 	const struct media_device_info *info = media_get_info(media);
@@ -229,10 +244,15 @@ static int vcap_tpg_ops_set_media_ctrl(struct video_pipeline *video_setup,
 #endif
 
 	/* Set TPG input resolution */
-	memset(fmt_str, 0, sizeof (fmt_str));
-	media_set_fmt_str(fmt_str, MEDIA_TPG_ENTITY, 0, MEDIA_TPG_FMT_IN,
-			  video_setup->w, video_setup->h);
-	ret = v4l2_subdev_parse_setup_formats(media, fmt_str);
+	memset(&key, 0, sizeof(key));
+	key.width = video_setup->w;
+	key.height = video_setup->h;
+	plan = v4l2_fmt_plan_get(vdev, &key, &compile);
+	ASSERT2(plan, "failed to get format plan for %s\n", vdev->display_text);
+	if (compile)
+		v4l2_fmt_plan_add(plan, MEDIA_TPG_ENTITY, 0, MEDIA_TPG_FMT_IN,
+				  video_setup->w, video_setup->h);
+	ret = v4l2_fmt_plan_apply(plan);
 	ASSERT2(!ret, "Unable to setup formats: %s (%d)\n", strerror(-ret),
 		-ret);
 
@@ -252,17 +272,9 @@ static int vcap_tpg_ops_set_frame_rate(const struct vlib_vdev *vdev,
 				       size_t numerator, size_t denominator)
 {
 	int fd, ret;
-	char subdev_name[DEV_NAME_LEN];
 	struct v4l2_subdev_frame_interval ival;
 
-	get_entity_devname(vlib_vdev_get_mdev(vdev), MEDIA_TPG_ENTITY,
-			   subdev_name);
-
-	fd = open(subdev_name, O_RDWR);
-	if (fd <= 0) {
-		VLIB_REPORT_ERR("error opening device '%s'", subdev_name);
-		return VLIB_ERROR_FILE_IO;
-	}
+	fd = v4l2_subdev_fd(vdev, MEDIA_TPG_ENTITY);
 
 	memset(&ival, 0, sizeof(ival));
 	ival.interval.numerator = denominator;
@@ -270,15 +282,12 @@ static int vcap_tpg_ops_set_frame_rate(const struct vlib_vdev *vdev,
 	ret = ioctl(fd, VIDIOC_SUBDEV_S_FRAME_INTERVAL, &ival);
 	if (ret < 0) {
 		VLIB_REPORT_ERR("VIDIOC_SUBDEV_S_FRAME_INTERVAL failed");
-		goto err;
+		return ret;
 	}
 
 	vlib_info("frame rate set to: %u/%u fps\n", ival.interval.denominator,
 		  ival.interval.numerator);
 
-err:
-	close(fd);
-
 	return ret;
 }
 
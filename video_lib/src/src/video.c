@@ -50,6 +50,7 @@
 #include "gpio_utils.h"
 #include "video_int.h"
 #include "mediactl_helper.h"
+#include "video_trace.h"
 
 /* Maximum number of bytes in a log line */
 #define VLIB_LOG_SIZE 256
@@ -629,7 +630,7 @@ int vlib_uninit_gst(void)
 	return ret;
 }
 
-int vlib_change_mode_gst(struct vlib_config *config)
+static int change_mode_gst(struct vlib_config *config)
 {
 	int ret = VLIB_SUCCESS;
 
@@ -670,9 +671,17 @@ int vlib_change_mode_gst(struct vlib_config *config)
 		}
 	}
 
+	/* Pick up a changed media graph before configuring it */
+	ret = vlib_vdev_refresh(vdev);
+	if (ret) {
+		return ret;
+	}
+
 	/* Configure media pipeline */
 	if (vdev->ops && vdev->ops->set_media_ctrl) {
+		vlib_trace_begin("set_media_ctrl");
 		ret = vdev->ops->set_media_ctrl(video_setup, vdev);
+		vlib_trace_end("set_media_ctrl");
 		ASSERT2(!ret, "failed to configure media pipeline\n");
 	}
 
@@ -693,6 +702,17 @@ int vlib_change_mode_gst(struct vlib_config *config)
 	return ret;
 }
 
+int vlib_change_mode_gst(struct vlib_config *config)
+{
+	int ret;
+
+	vlib_trace_begin("vlib_change_mode");
+	ret = change_mode_gst(config);
+	vlib_trace_end("vlib_change_mode");
+
+	return ret;
+}
+
 int vlib_get_active_plane_id(void)
 {
 	if (video_setup->drm.overlay_plane.drm_plane)
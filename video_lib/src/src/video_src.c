@@ -42,13 +42,17 @@
 #include <mediactl/mediactl.h>
 #include <linux/videodev2.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <unistd.h>
 
 #include <common.h>
 #include <helper.h>
 #include <mediactl_helper.h>
+#include <v4l2_helper.h>
 #include <vcap_hdmi_int.h>
 #include <vcap_file_int.h>
 #include <vcap_tpg_int.h>
@@ -57,8 +61,24 @@
 #include <vcap_uvc_int.h>
 #include <vcap_vivid_int.h>
 #include <video_int.h>
+#include <video_trace.h>
 
 static GPtrArray *video_srcs;
+/* discovery cache did not match the sources, fail the next lookup */
+static int discovery_stale;
+static vlib_video_src_change_cb src_change_cb;
+static void *src_change_data;
+/* bumped by uninit, changes queued before belong to freed sources */
+static int src_generation;
+
+struct vlib_video_src_change {
+	const struct vlib_vdev *vsrc;
+	int generation;
+	size_t width;
+	size_t height;
+};
+
+static void vsrc_discovery_complete(void);
 
 const char *vlib_video_src_get_display_text(const struct vlib_vdev *vsrc)
 {
@@ -143,6 +163,11 @@ enum vlib_vsrc_class vlib_video_src_get_class(const struct vlib_vdev *vsrc)
 
 struct vlib_vdev *vlib_video_src_get(size_t id)
 {
+	vsrc_discovery_complete();
+	/* indices handed out from a stale cache may name another source */
+	if (g_atomic_int_compare_and_exchange(&discovery_stale, 1, 0))
+		return NULL;
+
 	if (id >= video_srcs->len) {
 		return NULL;
 	}
@@ -159,10 +184,70 @@ struct media_device *vlib_vdev_get_mdev(const struct vlib_vdev *vdev)
 	return vdev->data.media.mdev;
 }
 
+/*
+ * libmediactl cannot re-enumerate a device, so once the kernel graph has
+ * changed the media device is opened again and the source switches over to
+ * it. Everything that pointed into the old graph is dropped first.
+ */
+int vlib_vdev_refresh(struct vlib_vdev *vdev)
+{
+	struct media_device *old = vlib_vdev_get_mdev(vdev);
+	struct media_device *media;
+	int vnode, ret;
+
+	if (!old || !media_cache_validate(old))
+		return VLIB_SUCCESS;
+
+	media = media_device_new(media_get_devnode(old));
+	if (!media) {
+		VLIB_REPORT_ERR("failed to reopen '%s'", media_get_devnode(old));
+		return VLIB_ERROR_OTHER;
+	}
+
+	ret = media_cache_init(media);
+	if (ret) {
+		media_device_unref(media);
+		return ret;
+	}
+
+	vnode = open(vlib_video_src_mdev2vdev(media), O_RDWR);
+	if (vnode < 0) {
+		VLIB_REPORT_ERR("failed to open video node of '%s': %s",
+				media_get_devnode(media), ERRSTR);
+		media_cache_free(media);
+		media_device_unref(media);
+		return VLIB_ERROR_FILE_IO;
+	}
+
+	if (vdev->ops && vdev->ops->release)
+		vdev->ops->release(vdev);
+
+	v4l2_fmt_plans_free(vdev);
+	media_cache_free(old);
+	media_device_unref(old);
+	close(vdev->data.media.vnode);
+	vdev->data.media.mdev = media;
+	vdev->data.media.vnode = vnode;
+
+	if (vdev->ops && vdev->ops->reopen)
+		vdev->ops->reopen(vdev);
+
+	vlib_info("%s: media graph re-enumerated\n", vdev->display_text);
+
+	return VLIB_SUCCESS;
+}
+
 static void vlib_vsrc_vdev_free(struct vlib_vdev *vd)
 {
+	if (vd->ops && vd->ops->release) {
+		vd->ops->release(vd);
+	}
+
 	switch (vd->vsrc_type) {
 	case VSRC_TYPE_MEDIA:
+		/* plans point at entity names of this media device */
+		v4l2_fmt_plans_free(vd);
+		media_cache_free(vd->data.media.mdev);
 		media_device_unref(vd->data.media.mdev);
 		close(vd->data.media.vnode);
 		break;
@@ -191,6 +276,8 @@ static void vlib_video_src_disable(struct vlib_vdev *vsrc)
 
 void vlib_video_src_class_disable(enum vlib_vsrc_class class)
 {
+	vsrc_discovery_complete();
+
 	for (size_t i = video_srcs->len; i > 0; i--) {
 		struct vlib_vdev *vd = g_ptr_array_index(video_srcs, i - 1);
 
@@ -260,110 +347,408 @@ static const struct matchtable mt_drivers_v4l2[] = {
 #endif
 };
 
-int vlib_video_src_init(struct vlib_config_data *cfg)
+/*
+ * Source discovery is split in two: probing, which opens, enumerates and
+ * queries every /dev/media* and /dev/video* node and runs on a thread pool,
+ * and matching, which creates the video sources serially in node order.
+ *
+ * The outcome is kept in a discovery cache keyed by the device number and
+ * the sysfs mtime of each node. Nodes whose cached driver is not handled
+ * here are not opened again. When no node changed at all,
+ * vlib_video_src_init only checks the identities and defers probing until
+ * a source is first used, answering the source count and classes from the
+ * cache until then.
+ *
+ * The cache decides which nodes are opened, so it lives in /run, is
+ * rebuilt on every boot and is only trusted when it is a regular file
+ * owned by the effective user and not writable by anyone else.
+ */
+#define VLIB_DISCOVERY_CACHE_ENV	"VLIB_DISCOVERY_CACHE"
+#define VLIB_DISCOVERY_CACHE_FILE	"/run/vlib-discovery.cache"
+#define VLIB_DISCOVERY_GROUP		"sources"
+
+struct vsrc_probe {
+	const char *path;
+	int is_media;
+	char *id;			/* cache group, "c:major:minor" */
+	gint64 mtime;			/* sysfs node mtime, ns */
+	char driver[32];
+	int cached;			/* driver taken from the cache */
+	int skip;			/* handled by no matchtable entry */
+	/* probe results */
+	int ret;
+	struct media_device *media;
+	int fd;
+};
+
+static struct {
+	int pending;			/* probing deferred to first use */
+	struct vlib_config_data cfg;
+	size_t cnt;
+	gint *classes;
+	GKeyFile *cache;
+	char *cache_file;
+	glob_t media_glob;
+	glob_t video_glob;
+	struct vsrc_probe *probes;
+	size_t nprobes;
+} discovery;
+static GMutex discovery_lock;
+
+static int vsrc_driver_handled(const struct matchtable *mt, size_t n,
+			       const char *driver)
+{
+	for (size_t i = 0; i < n; i++) {
+		if (!strcmp(mt[i].s, driver))
+			return 1;
+	}
+
+	return 0;
+}
+
+static void vsrc_probe_identify(struct vsrc_probe *p)
+{
+	struct stat st;
+	char *sysfs, *driver;
+
+	p->fd = -1;
+	if (stat(p->path, &st) || !S_ISCHR(st.st_mode))
+		return;
+
+	p->id = g_strdup_printf("c:%u:%u", major(st.st_rdev),
+				minor(st.st_rdev));
+	sysfs = g_strdup_printf("/sys/dev/char/%u:%u/", major(st.st_rdev),
+				minor(st.st_rdev));
+	if (!stat(sysfs, &st))
+		p->mtime = (gint64)st.st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000) +
+			   st.st_mtim.tv_nsec;
+	g_free(sysfs);
+
+	if (!discovery.cache || !p->mtime ||
+	    g_key_file_get_int64(discovery.cache, p->id, "mtime", NULL) != p->mtime)
+		return;
+
+	driver = g_key_file_get_string(discovery.cache, p->id, "driver", NULL);
+	if (!driver)
+		return;
+
+	g_strlcpy(p->driver, driver, sizeof(p->driver));
+	g_free(driver);
+	p->cached = 1;
+	p->skip = p->is_media ?
+		  !vsrc_driver_handled(mt_drivers_media,
+				       ARRAY_SIZE(mt_drivers_media), p->driver) :
+		  !vsrc_driver_handled(mt_drivers_v4l2,
+				       ARRAY_SIZE(mt_drivers_v4l2), p->driver);
+}
+
+static void vsrc_probe_func(gpointer data, gpointer user_data)
+{
+	struct vsrc_probe *p = data;
+
+	UNUSED(user_data);
+
+	if (p->is_media) {
+		p->media = media_device_new(p->path);
+		if (!p->media) {
+			p->ret = VLIB_ERROR_OTHER;
+			return;
+		}
+
+		p->ret = media_device_enumerate(p->media);
+		if (p->ret < 0)
+			return;
+
+		g_strlcpy(p->driver, media_get_info(p->media)->driver,
+			  sizeof(p->driver));
+	} else {
+		struct v4l2_capability vcap;
+
+		p->fd = open(p->path, O_RDWR);
+		if (p->fd < 0) {
+			p->ret = VLIB_ERROR_OTHER;
+			return;
+		}
+
+		memset(&vcap, 0, sizeof(vcap));
+		p->ret = ioctl(p->fd, VIDIOC_QUERYCAP, &vcap);
+		if (p->ret)
+			return;
+
+		g_strlcpy(p->driver, (char *)vcap.driver, sizeof(p->driver));
+	}
+}
+
+static void vsrc_discovery_free(void)
+{
+	for (size_t i = 0; i < discovery.nprobes; i++)
+		g_free(discovery.probes[i].id);
+	g_free(discovery.probes);
+	discovery.probes = NULL;
+	discovery.nprobes = 0;
+
+	globfree(&discovery.media_glob);
+	globfree(&discovery.video_glob);
+	g_free(discovery.classes);
+	discovery.classes = NULL;
+	if (discovery.cache)
+		g_key_file_free(discovery.cache);
+	discovery.cache = NULL;
+	g_free(discovery.cache_file);
+	discovery.cache_file = NULL;
+}
+
+/* Load the discovery cache, NULL if it is missing or not trustworthy */
+static GKeyFile *vsrc_discovery_load(const char *file)
 {
+	GKeyFile *kf = NULL;
+	struct stat st;
+	char *data;
+	ssize_t len;
+	int fd;
+
+	fd = open(file, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) ||
+	    st.st_uid != geteuid() || (st.st_mode & (S_IWGRP | S_IWOTH))) {
+		vlib_warn("ignoring discovery cache '%s', not a private file\n",
+			  file);
+		close(fd);
+		return NULL;
+	}
+
+	data = g_malloc(st.st_size + 1);
+	len = read(fd, data, st.st_size);
+	close(fd);
+	if (len == st.st_size) {
+		kf = g_key_file_new();
+		if (!g_key_file_load_from_data(kf, data, len, G_KEY_FILE_NONE,
+					       NULL)) {
+			g_key_file_free(kf);
+			kf = NULL;
+		}
+	}
+	g_free(data);
+
+	return kf;
+}
+
+/* Glob all nodes and look their identities up in the discovery cache */
+static int vsrc_discovery_scan(void)
+{
+	const char *file = getenv(VLIB_DISCOVERY_CACHE_ENV);
 	int ret;
-	glob_t pglob;
 
-	video_srcs = g_ptr_array_new_with_free_func(vlib_vsrc_table_free_func);
-	if (!video_srcs) {
+	if (!file)
+		file = VLIB_DISCOVERY_CACHE_FILE;
+	if (*file) {
+		discovery.cache_file = g_strdup(file);
+		discovery.cache = vsrc_discovery_load(file);
+	}
+
+	ret = glob("/dev/media*", 0, NULL, &discovery.media_glob);
+	if (ret && ret != GLOB_NOMATCH)
 		return VLIB_ERROR_OTHER;
+
+	ret = glob("/dev/video*", 0, NULL, &discovery.video_glob);
+	if (ret && ret != GLOB_NOMATCH)
+		return VLIB_ERROR_OTHER;
+
+	discovery.nprobes = discovery.media_glob.gl_pathc +
+			    discovery.video_glob.gl_pathc;
+	discovery.probes = g_new0(struct vsrc_probe, discovery.nprobes);
+	for (size_t i = 0; i < discovery.nprobes; i++) {
+		struct vsrc_probe *p = &discovery.probes[i];
+
+		p->is_media = i < discovery.media_glob.gl_pathc;
+		p->path = p->is_media ? discovery.media_glob.gl_pathv[i] :
+			  discovery.video_glob.gl_pathv[i - discovery.media_glob.gl_pathc];
+		vsrc_probe_identify(p);
 	}
 
-	ret = glob("/dev/media*", 0, NULL, &pglob);
-	if (ret && ret != GLOB_NOMATCH) {
-		ret = VLIB_ERROR_OTHER;
-		goto error;
+	return VLIB_SUCCESS;
+}
+
+/* Whether the cached source list still describes this system */
+static int vsrc_discovery_cache_valid(const struct vlib_config_data *cfg)
+{
+	gsize len = 0;
+	int file = !!(cfg->flags & VLIB_CFG_FLAG_FILE_ENABLE);
+
+	if (!discovery.cache ||
+	    g_key_file_get_integer(discovery.cache, VLIB_DISCOVERY_GROUP,
+				   "nodes", NULL) != (gint)discovery.nprobes ||
+	    g_key_file_get_boolean(discovery.cache, VLIB_DISCOVERY_GROUP,
+				   "file", NULL) != file)
+		return 0;
+
+	for (size_t i = 0; i < discovery.nprobes; i++) {
+		if (!discovery.probes[i].cached)
+			return 0;
 	}
 
-	for (size_t i = 0; i < pglob.gl_pathc; i++) {
-		struct media_device *media = media_device_new(pglob.gl_pathv[i]);
+	discovery.classes = g_key_file_get_integer_list(discovery.cache,
+							VLIB_DISCOVERY_GROUP,
+							"classes", &len, NULL);
+	if (!discovery.classes &&
+	    !g_key_file_has_key(discovery.cache, VLIB_DISCOVERY_GROUP,
+				"classes", NULL))
+		return 0;
 
-		if (!media) {
-			vlib_warn("failed to create media device from '%s'\n",
-				  pglob.gl_pathv[i]);
-			continue;
-		}
+	discovery.cnt = len;
+	return 1;
+}
+
+static void vsrc_discovery_save(const struct vlib_config_data *cfg)
+{
+	GKeyFile *kf;
+	gint *classes;
+	GError *err = NULL;
+
+	if (!discovery.cache_file)
+		return;
+
+	kf = g_key_file_new();
+	for (size_t i = 0; i < discovery.nprobes; i++) {
+		const struct vsrc_probe *p = &discovery.probes[i];
 
-		ret = media_device_enumerate(media);
-		if (ret < 0) {
-			vlib_warn("failed to enumerate '%s'\n",
-				  pglob.gl_pathv[i]);
-			media_device_unref(media);
+		if (!p->id || !p->mtime || !p->driver[0])
 			continue;
-		}
 
-		const struct media_device_info *info = media_get_info(media);
+		g_key_file_set_string(kf, p->id, "path", p->path);
+		g_key_file_set_int64(kf, p->id, "mtime", p->mtime);
+		g_key_file_set_string(kf, p->id, "driver", p->driver);
+	}
+
+	classes = g_new0(gint, video_srcs->len + 1);
+	for (size_t i = 0; i < video_srcs->len; i++) {
+		const struct vlib_vdev *vd = g_ptr_array_index(video_srcs, i);
+
+		classes[i] = vd->vsrc_class;
+	}
+	g_key_file_set_integer(kf, VLIB_DISCOVERY_GROUP, "nodes",
+			       discovery.nprobes);
+	g_key_file_set_boolean(kf, VLIB_DISCOVERY_GROUP, "file",
+			       !!(cfg->flags & VLIB_CFG_FLAG_FILE_ENABLE));
+	g_key_file_set_integer_list(kf, VLIB_DISCOVERY_GROUP, "classes",
+				    classes, video_srcs->len);
+	g_free(classes);
+
+	if (!g_key_file_save_to_file(kf, discovery.cache_file, &err)) {
+		vlib_dbg("failed to write discovery cache '%s': %s\n",
+			 discovery.cache_file, err->message);
+		g_error_free(err);
+	}
+	g_key_file_free(kf);
+}
+
+/* Probe the nodes in parallel, then create the sources in node order */
+static int vsrc_discovery_probe(struct vlib_config_data *cfg)
+{
+	GThreadPool *pool;
+	int ret = VLIB_SUCCESS;
+	size_t i;
+
+	vlib_trace_begin("vlib_video_src_probe");
+	pool = g_thread_pool_new(vsrc_probe_func, NULL,
+				 g_get_num_processors(), TRUE, NULL);
+	for (i = 0; i < discovery.nprobes; i++) {
+		if (!discovery.probes[i].skip)
+			g_thread_pool_push(pool, &discovery.probes[i], NULL);
+	}
+	g_thread_pool_free(pool, FALSE, TRUE);
+	vlib_trace_end("vlib_video_src_probe");
 
+	for (i = 0; i < discovery.nprobes; i++) {
+		struct vsrc_probe *p = &discovery.probes[i];
 		size_t j;
-		for (j = 0; j < ARRAY_SIZE(mt_drivers_media); j++) {
-			if (strcmp(mt_drivers_media[j].s, info->driver)) {
+
+		if (p->skip)
+			continue;
+
+		if (p->is_media) {
+			if (!p->media) {
+				vlib_warn("failed to create media device from '%s'\n",
+					  p->path);
 				continue;
 			}
 
-			struct vlib_vdev *vd =
-				  mt_drivers_media[j].init(&mt_drivers_media[j],
-							   media);
-			if (vd) {
-				vlib_dbg("found video source '%s (%s)'\n",
-					 vd->display_text, pglob.gl_pathv[i]);
-				g_ptr_array_add(video_srcs, vd);
-				break;
+			if (p->ret < 0) {
+				vlib_warn("failed to enumerate '%s'\n", p->path);
+				media_device_unref(p->media);
+				continue;
 			}
-		}
-
-		if (j == ARRAY_SIZE(mt_drivers_media)) {
-			media_device_unref(media);
-		}
-	}
-
-	globfree(&pglob);
 
-	ret = glob("/dev/video*", 0, NULL, &pglob);
-	if (ret && ret != GLOB_NOMATCH) {
-		ret = VLIB_ERROR_OTHER;
-		goto error;
-	}
+			for (j = 0; j < ARRAY_SIZE(mt_drivers_media); j++) {
+				if (strcmp(mt_drivers_media[j].s, p->driver)) {
+					continue;
+				}
+
+				struct vlib_vdev *vd =
+					  mt_drivers_media[j].init(&mt_drivers_media[j],
+								   p->media);
+				if (vd) {
+					vlib_dbg("found video source '%s (%s)'\n",
+						 vd->display_text, p->path);
+					media_cache_init(p->media);
+					g_ptr_array_add(video_srcs, vd);
+					break;
+				}
+			}
 
-	ret = VLIB_SUCCESS;
+			if (j == ARRAY_SIZE(mt_drivers_media)) {
+				media_device_unref(p->media);
+			}
+			continue;
+		}
 
-	for (size_t i = 0; i < pglob.gl_pathc; i++) {
-		int fd = open(pglob.gl_pathv[i], O_RDWR);
-		if (fd < 0) {
+		if (p->fd < 0) {
 			ret = VLIB_ERROR_OTHER;
-			goto error;
+			break;
 		}
 
-		struct v4l2_capability vcap;
-		ret = ioctl(fd, VIDIOC_QUERYCAP, &vcap);
-		if (ret) {
-			close(fd);
+		if (p->ret) {
+			close(p->fd);
 			continue;
 		}
 
-		size_t j;
 		for (j = 0; j < ARRAY_SIZE(mt_drivers_v4l2); j++) {
-			if (strcmp(mt_drivers_v4l2[j].s, (char *)vcap.driver)) {
+			if (strcmp(mt_drivers_v4l2[j].s, p->driver)) {
 				continue;
 			}
 
 			struct vlib_vdev *vd =
 				    mt_drivers_v4l2[j].init(&mt_drivers_v4l2[j],
-							    (void *)(uintptr_t)fd);
+							    (void *)(uintptr_t)p->fd);
 			if (vd) {
 				vlib_dbg("found video source '%s (%s)'\n",
-					 vd->display_text, pglob.gl_pathv[i]);
-				strcpy(vd->data.v4l2.vdev_name, pglob.gl_pathv[i]);
+					 vd->display_text, p->path);
+				strcpy(vd->data.v4l2.vdev_name, p->path);
 				g_ptr_array_add(video_srcs, vd);
 				break;
 			}
 		}
 
 		if (j == ARRAY_SIZE(mt_drivers_v4l2)) {
-			close(fd);
+			close(p->fd);
 		}
 	}
 
+	/* release what an early exit left behind */
+	for (i++; i < discovery.nprobes; i++) {
+		struct vsrc_probe *p = &discovery.probes[i];
+
+		if (p->media)
+			media_device_unref(p->media);
+		if (p->fd >= 0)
+			close(p->fd);
+	}
+
+	if (ret)
+		return ret;
+
 #ifdef ENABLE_VCAP_FILE
 	if (cfg->flags & VLIB_CFG_FLAG_FILE_ENABLE) {
 		struct vlib_vdev *vd = vcap_file_init(NULL, (void *)cfg->vcap_file_fn);
@@ -377,21 +762,204 @@ int vlib_video_src_init(struct vlib_config_data *cfg)
 	}
 #endif
 
+	if (!ret)
+		vsrc_discovery_save(cfg);
+
+	return ret;
+}
+
+/*
+ * Run the probing vlib_video_src_init deferred, before a source is used.
+ * If the sources found differ from the cached ones, the count and classes
+ * reported so far were wrong: the next vlib_video_src_get fails so the
+ * caller queries them again instead of using another source.
+ */
+static void vsrc_discovery_complete(void)
+{
+	if (!g_atomic_int_get(&discovery.pending))
+		return;
+
+	g_mutex_lock(&discovery_lock);
+	if (discovery.pending) {
+		int stale = 0;
+		int ret = vsrc_discovery_probe(&discovery.cfg);
+
+		if (ret) {
+			VLIB_REPORT_ERR("deferred video source probing failed");
+			stale = 1;
+		}
+
+		stale |= video_srcs->len != discovery.cnt;
+		for (size_t i = 0; !stale && i < video_srcs->len; i++) {
+			const struct vlib_vdev *vd = g_ptr_array_index(video_srcs, i);
+
+			stale = (gint)vd->vsrc_class != discovery.classes[i];
+		}
+
+		if (stale) {
+			VLIB_REPORT_ERR("video sources changed since discovery (%zu, cached %zu)",
+					(size_t)video_srcs->len, discovery.cnt);
+			/* a successful probe rewrote the cache, drop it otherwise */
+			if (ret && discovery.cache_file)
+				unlink(discovery.cache_file);
+			g_atomic_int_set(&discovery_stale, 1);
+		}
+
+		vsrc_discovery_free();
+		g_atomic_int_set(&discovery.pending, 0);
+	}
+	g_mutex_unlock(&discovery_lock);
+}
+
+int vlib_video_src_init(struct vlib_config_data *cfg)
+{
+	int ret;
+
+	video_srcs = g_ptr_array_new_with_free_func(vlib_vsrc_table_free_func);
+	if (!video_srcs) {
+		return VLIB_ERROR_OTHER;
+	}
+
+	ret = vsrc_discovery_scan();
+	if (ret)
+		goto error;
+
+	if (vsrc_discovery_cache_valid(cfg)) {
+		vlib_dbg("%zu video sources from discovery cache\n",
+			 discovery.cnt);
+		discovery.cfg = *cfg;
+		g_atomic_int_set(&discovery.pending, 1);
+		return VLIB_SUCCESS;
+	}
+
+	ret = vsrc_discovery_probe(cfg);
+
 error:
-	globfree(&pglob);
+	vsrc_discovery_free();
 	return ret;
 }
 
 void vlib_video_src_uninit(void)
 {
+	if (g_atomic_int_get(&discovery.pending)) {
+		vsrc_discovery_free();
+		discovery.pending = 0;
+	}
+	discovery_stale = 0;
+
 	g_ptr_array_free(video_srcs, TRUE);
+	video_srcs = NULL;
+	g_atomic_int_inc(&src_generation);
+	v4l2_subdev_pool_free();
+}
+
+void vlib_video_src_set_change_cb(vlib_video_src_change_cb cb, void *data)
+{
+	src_change_cb = cb;
+	src_change_data = data;
+}
+
+static gboolean vlib_video_src_change_dispatch(gpointer data)
+{
+	struct vlib_video_src_change *change = data;
+
+	/* sources freed since the event was queued, a new source may even
+	 * live at the same address */
+	if (change->generation != g_atomic_int_get(&src_generation)) {
+		g_free(change);
+		return G_SOURCE_REMOVE;
+	}
+
+	/* the source may have been disabled since the event was queued */
+	for (size_t i = 0; video_srcs && i < video_srcs->len; i++) {
+		if (g_ptr_array_index(video_srcs, i) != change->vsrc)
+			continue;
+
+		vlib_dbg("%s: input changed to %zux%zu\n",
+			 change->vsrc->display_text, change->width,
+			 change->height);
+		if (src_change_cb)
+			src_change_cb(i, change->width, change->height,
+				      src_change_data);
+		break;
+	}
+
+	g_free(change);
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * vlib_video_src_notify_change - report a new input resolution of a source
+ * @vsrc:	Pointer to video source struct
+ * @width:	Locked input width
+ * @height:	Locked input height
+ *
+ * Safe to call from any thread. The registered callback is always queued to
+ * the default main context, it never runs in the calling thread even when
+ * nobody owns that context.
+ */
+void vlib_video_src_notify_change(const struct vlib_vdev *vsrc, size_t width,
+				  size_t height)
+{
+	struct vlib_video_src_change *change;
+
+	change = g_new0(struct vlib_video_src_change, 1);
+	change->vsrc = vsrc;
+	change->generation = g_atomic_int_get(&src_generation);
+	change->width = width;
+	change->height = height;
+	g_idle_add(vlib_video_src_change_dispatch, change);
 }
 
 size_t vlib_video_src_cnt_get(void)
 {
+	if (g_atomic_int_get(&discovery.pending))
+		return discovery.cnt;
+
 	return video_srcs->len;
 }
 
+/*
+ * vlib_video_src_get_class_from_id - get video class of a source by index
+ * @id:		Index of the video source
+ *
+ * Unlike vlib_video_src_get, this does not force deferred probing.
+ *
+ * Return: The video class, or -1 for an invalid index.
+ */
+int vlib_video_src_get_class_from_id(size_t id)
+{
+	const struct vlib_vdev *vd;
+
+	if (g_atomic_int_get(&discovery.pending)) {
+		g_mutex_lock(&discovery_lock);
+		if (discovery.pending) {
+			int class = id < discovery.cnt ? discovery.classes[id] : -1;
+
+			g_mutex_unlock(&discovery_lock);
+			return class;
+		}
+		g_mutex_unlock(&discovery_lock);
+	}
+
+	vd = vlib_video_src_get(id);
+	return vd ? (int)vd->vsrc_class : -1;
+}
+
+/*
+ * vlib_video_src_can_scale - check whether a source follows input changes
+ * @id:		Index of the video source
+ *
+ * Return: 1 if any input resolution is scaled to the capture resolution of
+ * the mode, 0 if the input has to match it or the index is invalid.
+ */
+int vlib_video_src_can_scale(size_t id)
+{
+	const struct vlib_vdev *vd = vlib_video_src_get(id);
+
+	return vd && !(vd->flags & VDEV_FIXED_INPUT);
+}
+
 const char *vlib_video_src_mdev2vdev(struct media_device *media)
 {
 	struct media_entity *ent = media_get_entity(media, 0);
@@ -0,0 +1,334 @@
+/******************************************************************************
+ * (c) Copyright 2012-2018 Xilinx, Inc. All rights reserved.
+ *
+ * This file contains confidential and proprietary information of Xilinx, Inc.
+ * and is protected under U.S. and international copyright and other
+ * intellectual property laws.
+ *
+ * DISCLAIMER
+ * This disclaimer is not a license and does not grant any rights to the
+ * materials distributed herewith. Except as otherwise provided in a valid
+ * license issued to you by Xilinx, and to the maximum extent permitted by
+ * applicable law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND WITH ALL
+ * FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES AND CONDITIONS, EXPRESS,
+ * IMPLIED, OR STATUTORY, INCLUDING BUT NOT LIMITED TO WARRANTIES OF
+ * MERCHANTABILITY, NON-INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE;
+ * and (2) Xilinx shall not be liable (whether in contract or tort, including
+ * negligence, or under any other theory of liability) for any loss or damage
+ * of any kind or nature related to, arising under or in connection with these
+ * materials, including for any direct, or any indirect, special, incidental,
+ * or consequential loss or damage (including loss of data, profits, goodwill,
+ * or any type of loss or damage suffered as a result of any action brought by
+ * a third party) even if such damage or loss was reasonably foreseeable or
+ * Xilinx had been advised of the possibility of the same.
+ *
+ * CRITICAL APPLICATIONS
+ * Xilinx products are not designed or intended to be fail-safe, or for use in
+ * any application requiring fail-safe performance, such as life-support or
+ * safety devices or systems, Class III medical devices, nuclear facilities,
+ * applications related to the deployment of airbags, or any other applications
+ * that could lead to death, personal injury, or severe property or
+ * environmental damage (individually and collectively, "Critical
+ * Applications"). Customer assumes the sole risk and liability of any use of
+ * Xilinx products in Critical Applications, subject only to applicable laws
+ * and regulations governing limitations on product liability.
+ *
+ * THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS PART OF THIS FILE
+ * AT ALL TIMES.
+ *******************************************************************************/
+#include <glib.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "helper.h"
+#include "video_int.h"
+#include "video_trace.h"
+
+#define TRACE_RING_MASK (VLIB_TRACE_RING_SIZE - 1)
+
+/* rings of exited threads kept for late dumps before they are reused */
+#define TRACE_RETIRED_MAX 16
+
+#if (VLIB_TRACE_RING_SIZE & TRACE_RING_MASK)
+#error "VLIB_TRACE_RING_SIZE must be a power of two"
+#endif
+
+enum trace_phase {
+	TRACE_PHASE_BEGIN = 'B',
+	TRACE_PHASE_END = 'E',
+	TRACE_PHASE_INSTANT = 'i',
+	TRACE_PHASE_COUNTER = 'C',
+};
+
+struct trace_record {
+	uint64_t ts_ns;
+	const char *name;
+	uint64_t arg;
+	uint32_t phase;
+	uint32_t reserved;
+};
+
+/*
+ * One ring per thread. Only the owning thread writes records, head is
+ * published with release semantics so the dumper sees complete records for
+ * everything but the slot currently being overwritten.
+ *
+ * When its thread exits a ring is retired but stays on the list, so late
+ * dumps still see the events. Once TRACE_RETIRED_MAX rings are retired a
+ * new thread takes over the oldest one, memory stays bounded however many
+ * streaming threads come and go across mode changes.
+ */
+struct trace_ring {
+	struct trace_ring *next;
+	long tid;
+	uint64_t head;
+	uint64_t retired;	/* retire order, 0 while the thread runs */
+	struct trace_record rec[VLIB_TRACE_RING_SIZE];
+};
+
+static void trace_ring_retire(gpointer data);
+
+static int trace_on;
+static char *trace_path;
+static struct trace_ring *trace_rings;
+static unsigned int trace_rings_retired;
+static uint64_t trace_retire_seq;
+static GMutex trace_lock;
+static GPrivate trace_ring_key = G_PRIVATE_INIT(trace_ring_retire);
+
+static __thread struct trace_ring *thread_ring;
+static __thread int thread_ring_failed;
+
+static void trace_atexit(void)
+{
+	vlib_trace_dump(trace_path);
+}
+
+static void trace_init_once(void)
+{
+	static gsize init;
+	const char *path;
+
+	if (!g_once_init_enter(&init))
+		return;
+
+	path = getenv("VLIB_TRACE");
+	if (path && *path) {
+		trace_path = strdup(path);
+		if (trace_path && !atexit(trace_atexit))
+			__atomic_store_n(&trace_on, 1, __ATOMIC_RELAXED);
+	}
+
+	g_once_init_leave(&init, 1);
+}
+
+/* Runs at thread exit, the ring becomes available for reuse */
+static void trace_ring_retire(gpointer data)
+{
+	struct trace_ring *ring = data;
+
+	g_mutex_lock(&trace_lock);
+	ring->retired = ++trace_retire_seq;
+	trace_rings_retired++;
+	g_mutex_unlock(&trace_lock);
+}
+
+/* Oldest retired ring once enough have piled up, trace_lock held */
+static struct trace_ring *trace_ring_reuse(void)
+{
+	struct trace_ring *ring, *oldest = NULL;
+
+	if (trace_rings_retired < TRACE_RETIRED_MAX)
+		return NULL;
+
+	for (ring = trace_rings; ring; ring = ring->next) {
+		if (ring->retired &&
+		    (!oldest || ring->retired < oldest->retired))
+			oldest = ring;
+	}
+	if (oldest) {
+		oldest->retired = 0;
+		__atomic_store_n(&oldest->head, 0, __ATOMIC_RELEASE);
+		trace_rings_retired--;
+	}
+
+	return oldest;
+}
+
+static struct trace_ring *trace_ring_get(void)
+{
+	struct trace_ring *ring;
+
+	if (thread_ring || thread_ring_failed)
+		return thread_ring;
+
+	g_mutex_lock(&trace_lock);
+	ring = trace_ring_reuse();
+	if (!ring) {
+		ring = calloc(1, sizeof(*ring));
+		if (ring) {
+			ring->next = trace_rings;
+			trace_rings = ring;
+		}
+	}
+	if (ring)
+		ring->tid = syscall(SYS_gettid);
+	g_mutex_unlock(&trace_lock);
+
+	if (!ring) {
+		thread_ring_failed = 1;
+		return NULL;
+	}
+
+	g_private_set(&trace_ring_key, ring);
+	thread_ring = ring;
+
+	return ring;
+}
+
+static void trace_emit(const char *name, enum trace_phase phase, uint64_t arg)
+{
+	struct trace_ring *ring;
+	struct trace_record *rec;
+	struct timespec ts;
+	uint64_t head;
+
+	if (!vlib_trace_enabled())
+		return;
+
+	ring = trace_ring_get();
+	if (!ring)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	head = ring->head;
+	rec = &ring->rec[head & TRACE_RING_MASK];
+	rec->ts_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	rec->name = name;
+	rec->arg = arg;
+	rec->phase = phase;
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void vlib_trace_enable(int enable)
+{
+	trace_init_once();
+	__atomic_store_n(&trace_on, !!enable, __ATOMIC_RELAXED);
+}
+
+int vlib_trace_enabled(void)
+{
+	trace_init_once();
+	return __atomic_load_n(&trace_on, __ATOMIC_RELAXED);
+}
+
+void vlib_trace_begin(const char *name)
+{
+	trace_emit(name, TRACE_PHASE_BEGIN, 0);
+}
+
+void vlib_trace_end(const char *name)
+{
+	trace_emit(name, TRACE_PHASE_END, 0);
+}
+
+void vlib_trace_instant(const char *name, uint64_t arg)
+{
+	trace_emit(name, TRACE_PHASE_INSTANT, arg);
+}
+
+void vlib_trace_counter(const char *name, uint64_t value)
+{
+	trace_emit(name, TRACE_PHASE_COUNTER, value);
+}
+
+static void trace_write_name(FILE *fp, const char *name)
+{
+	fputc('"', fp);
+	for (; name && *name; name++) {
+		if (*name == '"' || *name == '\\')
+			fputc('\\', fp);
+		if ((unsigned char)*name >= 0x20)
+			fputc(*name, fp);
+	}
+	fputc('"', fp);
+}
+
+static void trace_write_record(FILE *fp, const struct trace_record *rec,
+			       long pid, long tid, int first)
+{
+	fprintf(fp, "%s\n{\"name\":", first ? "" : ",");
+	trace_write_name(fp, rec->name);
+	fprintf(fp, ",\"ph\":\"%c\",\"ts\":%" PRIu64 ".%03u,\"pid\":%ld,\"tid\":%ld",
+		(char)rec->phase, rec->ts_ns / 1000,
+		(unsigned int)(rec->ts_ns % 1000), pid, tid);
+
+	switch (rec->phase) {
+	case TRACE_PHASE_INSTANT:
+		fprintf(fp, ",\"s\":\"t\",\"args\":{\"arg\":%" PRIu64 "}",
+			rec->arg);
+		break;
+	case TRACE_PHASE_COUNTER:
+		fprintf(fp, ",\"args\":{\"value\":%" PRIu64 "}", rec->arg);
+		break;
+	default:
+		break;
+	}
+
+	fputc('}', fp);
+}
+
+/*
+ * Write all recorded events as Chrome trace JSON. Dumping while other
+ * threads keep tracing is allowed; records overwritten during the dump may
+ * show up torn and should be disregarded.
+ */
+int vlib_trace_dump(const char *path)
+{
+	struct trace_ring *ring;
+	long pid = getpid();
+	int first = 1;
+	FILE *fp;
+
+	if (!path) {
+		VLIB_REPORT_ERR("no trace output file");
+		return VLIB_ERROR_INVALID_PARAM;
+	}
+
+	fp = fopen(path, "w");
+	if (!fp) {
+		VLIB_REPORT_ERR("failed to open '%s': %s", path, ERRSTR);
+		return VLIB_ERROR_FILE_IO;
+	}
+
+	fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", fp);
+
+	g_mutex_lock(&trace_lock);
+	for (ring = trace_rings; ring; ring = ring->next) {
+		uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		uint64_t i = head > VLIB_TRACE_RING_SIZE ?
+			     head - VLIB_TRACE_RING_SIZE : 0;
+
+		for (; i < head; i++) {
+			trace_write_record(fp, &ring->rec[i & TRACE_RING_MASK],
+					   pid, ring->tid, first);
+			first = 0;
+		}
+	}
+	g_mutex_unlock(&trace_lock);
+
+	fputs("\n]}\n", fp);
+
+	if (fclose(fp)) {
+		VLIB_REPORT_ERR("failed to write '%s': %s", path, ERRSTR);
+		return VLIB_ERROR_FILE_IO;
+	}
+
+	return VLIB_SUCCESS;
+}